@@ -179,9 +179,9 @@ h264_parser_get_sps (H264NalParser * nalparser, uint8_t sps_id)
 {
   H264SPS *sps;
 
-  sps = &nalparser->sps[sps_id];
+  sps = nalparser->sps[sps_id];
 
-  if (sps->valid)
+  if (sps && sps->valid)
     return sps;
 
   return NULL;
@@ -192,14 +192,87 @@ h264_parser_get_pps (H264NalParser * nalparser, uint8_t pps_id)
 {
   H264PPS *pps;
 
-  pps = &nalparser->pps[pps_id];
+  pps = nalparser->pps[pps_id];
 
-  if (pps->valid)
+  if (pps && pps->valid)
     return pps;
 
   return NULL;
 }
 
+/* Payload of the NAL unit a stored parameter set was parsed from */
+struct _H264ParamSetRaw
+{
+  uint8_t nal_type;
+  uint32_t size;
+  uint8_t data[];
+};
+
+static H264ParamSetRaw *
+h264_param_set_raw_new (const H264NalUnit * nalu)
+{
+  H264ParamSetRaw *raw;
+  uint32_t size = nalu->size - nalu->header_bytes;
+
+  raw = g_malloc (sizeof (H264ParamSetRaw) + size);
+  if (!raw)
+    return NULL;
+
+  raw->nal_type = nalu->type;
+  raw->size = size;
+  memcpy (raw->data, nalu->data + nalu->offset + nalu->header_bytes, size);
+  return raw;
+}
+
+static bool
+h264_param_set_raw_equal (const H264ParamSetRaw * raw,
+    const H264NalUnit * nalu)
+{
+  uint32_t size = nalu->size - nalu->header_bytes;
+
+  return raw && raw->nal_type == nalu->type && raw->size == size &&
+      !memcmp (raw->data, nalu->data + nalu->offset + nalu->header_bytes,
+      size);
+}
+
+/* Returns the stored SPS if @nalu carries exactly the same payload */
+static H264SPS *
+h264_parser_find_repeated_sps (H264NalParser * nalparser, H264NalUnit * nalu)
+{
+  NalReader nr;
+  uint32_t sps_id;
+
+  nal_reader_init (&nr, nalu->data + nalu->offset + nalu->header_bytes,
+      nalu->size - nalu->header_bytes);
+
+  /* skip profile_idc, constraint flags and level_idc */
+  if (!nal_reader_skip (&nr, 24) || !nal_reader_get_ue (&nr, &sps_id)
+      || sps_id >= H264_MAX_SPS_COUNT)
+    return NULL;
+
+  if (!h264_param_set_raw_equal (nalparser->sps_raw[sps_id], nalu))
+    return NULL;
+  return h264_parser_get_sps (nalparser, sps_id);
+}
+
+/* Returns the stored PPS if @nalu carries exactly the same payload */
+static H264PPS *
+h264_parser_find_repeated_pps (H264NalParser * nalparser, H264NalUnit * nalu)
+{
+  NalReader nr;
+  uint32_t pps_id;
+
+  nal_reader_init (&nr, nalu->data + nalu->offset + nalu->header_bytes,
+      nalu->size - nalu->header_bytes);
+
+  if (!nal_reader_get_ue (&nr, &pps_id) || pps_id >= H264_MAX_PPS_COUNT)
+    return NULL;
+
+  if (!h264_param_set_raw_equal (nalparser->pps_raw[pps_id], nalu))
+    return NULL;
+  return h264_parser_get_pps (nalparser, pps_id);
+}
+
 static bool
 h264_parse_nalu_header (H264NalUnit * nalu)
 {
@@ -388,6 +461,62 @@ h264_sps_copy (H264SPS * dst_sps, const H264SPS * src_sps)
   return TRUE;
 }
 
+/* Copies @sps into the parser, remembering @nalu if not NULL */
+static bool
+h264_parser_store_sps (H264NalParser * nalparser, H264NalUnit * nalu,
+    const H264SPS * sps)
+{
+  H264SPS *stored = nalparser->sps[sps->id];
+  uint32_t i;
+
+  if (!stored) {
+    stored = g_new0 (H264SPS, 1);
+    if (!stored)
+      return FALSE;
+    nalparser->sps[sps->id] = stored;
+  }
+
+  if (!h264_sps_copy (stored, sps))
+    return FALSE;
+  nalparser->last_sps = stored;
+
+  g_free (nalparser->sps_raw[sps->id]);
+  nalparser->sps_raw[sps->id] = nalu ? h264_param_set_raw_new (nalu) : NULL;
+
+  /* a PPS inherits scaling lists and limits from its SPS, so one that
+   * refers to the new SPS must be parsed again even if repeated */
+  for (i = 0; i < H264_MAX_PPS_COUNT; i++) {
+    if (nalparser->pps_raw[i] && nalparser->pps[i]->sequence == stored) {
+      g_free (nalparser->pps_raw[i]);
+      nalparser->pps_raw[i] = NULL;
+    }
+  }
+  return TRUE;
+}
+
+/* Copies @pps into the parser and remembers @nalu */
+static bool
+h264_parser_store_pps (H264NalParser * nalparser, H264NalUnit * nalu,
+    const H264PPS * pps)
+{
+  H264PPS *stored = nalparser->pps[pps->id];
+
+  if (!stored) {
+    stored = g_new0 (H264PPS, 1);
+    if (!stored)
+      return FALSE;
+    nalparser->pps[pps->id] = stored;
+  }
+
+  if (!h264_pps_copy (stored, pps))
+    return FALSE;
+  nalparser->last_pps = stored;
+
+  g_free (nalparser->pps_raw[pps->id]);
+  nalparser->pps_raw[pps->id] = h264_param_set_raw_new (nalu);
+  return TRUE;
+}
+
 /****** Parsing functions *****/
 
 static bool
@@ -1261,10 +1390,20 @@ h264_nal_parser_free (H264NalParser * nalparser)
 {
   uint32_t i;
 
-  for (i = 0; i < H264_MAX_SPS_COUNT; i++)
-    h264_sps_clear (&nalparser->sps[i]);
-  for (i = 0; i < H264_MAX_PPS_COUNT; i++)
-    h264_pps_clear (&nalparser->pps[i]);
+  for (i = 0; i < H264_MAX_SPS_COUNT; i++) {
+    if (nalparser->sps[i]) {
+      h264_sps_clear (nalparser->sps[i]);
+      g_free (nalparser->sps[i]);
+    }
+    g_free (nalparser->sps_raw[i]);
+  }
+  for (i = 0; i < H264_MAX_PPS_COUNT; i++) {
+    if (nalparser->pps[i]) {
+      h264_pps_clear (nalparser->pps[i]);
+      g_free (nalparser->pps[i]);
+    }
+    g_free (nalparser->pps_raw[i]);
+  }
   g_slice_free (H264NalParser, nalparser);
 
   nalparser = NULL;
@@ -1484,20 +1623,34 @@ h264_parser_parse_nal (H264NalParser * nalparser, H264NalUnit * nalu)
  *
  * Parses @data, and fills the @sps structure.
  *
+ * If @nalu is byte-identical to the NAL unit the stored SPS with the
+ * same id was parsed from, @sps is filled from the stored one instead.
+ *
  * Returns: a #H264ParserResult
  */
 H264ParserResult
 h264_parser_parse_sps (H264NalParser * nalparser, H264NalUnit * nalu,
     H264SPS * sps, bool parse_vui_params)
 {
-  H264ParserResult res = h264_parse_sps (nalu, sps, parse_vui_params);
+  H264ParserResult res;
+  H264SPS *stored;
 
+  stored = h264_parser_find_repeated_sps (nalparser, nalu);
+  if (stored && stored->extension_type == H264_NAL_EXTENSION_NONE) {
+    DEBUG ("sequence parameter set with id: %d is unchanged", stored->id);
+    *sps = *stored;
+    nalparser->last_sps = stored;
+    return H264_PARSER_OK;
+  }
+
+  res = h264_parse_sps (nalu, sps, parse_vui_params);
   if (res == H264_PARSER_OK) {
     DEBUG ("adding sequence parameter set with id: %d to array", sps->id);
 
-    if (!h264_sps_copy (&nalparser->sps[sps->id], sps))
+    /* only fully parsed sets may stand in for a repeated one */
+    if (!h264_parser_store_sps (nalparser, parse_vui_params ? nalu : NULL,
+            sps))
       return H264_PARSER_ERROR;
-    nalparser->last_sps = &nalparser->sps[sps->id];
   }
   return res;
 }
@@ -1845,9 +1998,9 @@ h264_parser_parse_subset_sps (H264NalParser * nalparser,
   if (res == H264_PARSER_OK) {
     DEBUG ("adding sequence parameter set with id: %d to array", sps->id);
 
-    if (!h264_sps_copy (&nalparser->sps[sps->id], sps))
+    if (!h264_parser_store_sps (nalparser, parse_vui_params ? nalu : NULL,
+            sps))
       return H264_PARSER_ERROR;
-    nalparser->last_sps = &nalparser->sps[sps->id];
   }
   return res;
 }
@@ -2052,25 +2205,84 @@ error:
  * h264_pps_clear() function when it is no longer needed, or prior
  * to parsing a new PPS NAL unit.
  *
+ * If @nalu is byte-identical to the NAL unit the stored PPS with the
+ * same id was parsed from, @pps is filled from the stored one instead.
+ *
  * Returns: a #H264ParserResult
  */
 H264ParserResult
 h264_parser_parse_pps (H264NalParser * nalparser,
     H264NalUnit * nalu, H264PPS * pps)
 {
-  H264ParserResult res = h264_parse_pps (nalparser, nalu, pps);
+  H264ParserResult res;
+  H264PPS *stored;
+
+  stored = h264_parser_find_repeated_pps (nalparser, nalu);
+  if (stored) {
+    DEBUG ("picture parameter set with id: %d is unchanged", stored->id);
+    *pps = *stored;
+    if (stored->slice_group_id)
+      pps->slice_group_id = g_memdup (stored->slice_group_id,
+          stored->pic_size_in_map_units_minus1 + 1);
+    nalparser->last_pps = stored;
+    return H264_PARSER_OK;
+  }
 
+  res = h264_parse_pps (nalparser, nalu, pps);
   if (res == H264_PARSER_OK) {
     DEBUG ("adding picture parameter set with id: %d to array", pps->id);
 
-    if (!h264_pps_copy (&nalparser->pps[pps->id], pps))
+    if (!h264_parser_store_pps (nalparser, nalu, pps))
       return H264_PARSER_ERROR;
-    nalparser->last_pps = &nalparser->pps[pps->id];
   }
 
   return res;
 }
 
+/**
+ * h264_parser_is_repeated_sps:
+ * @nalparser: a #H264NalParser
+ * @nalu: The #H264_NAL_SPS or #H264_NAL_SUBSET_SPS #H264NalUnit to check
+ *
+ * Checks whether @nalu is byte-identical to the NAL unit the stored SPS
+ * with the same id was parsed from, without parsing it. If so, the
+ * stored SPS becomes the last seen one, as if @nalu had been parsed.
+ *
+ * Returns: %TRUE if @nalu repeats a stored SPS
+ */
+bool
+h264_parser_is_repeated_sps (H264NalParser * nalparser, H264NalUnit * nalu)
+{
+  H264SPS *stored = h264_parser_find_repeated_sps (nalparser, nalu);
+
+  if (!stored)
+    return FALSE;
+  nalparser->last_sps = stored;
+  return TRUE;
+}
+
+/**
+ * h264_parser_is_repeated_pps:
+ * @nalparser: a #H264NalParser
+ * @nalu: The #H264_NAL_PPS #H264NalUnit to check
+ *
+ * Checks whether @nalu is byte-identical to the NAL unit the stored PPS
+ * with the same id was parsed from, without parsing it. If so, the
+ * stored PPS becomes the last seen one, as if @nalu had been parsed.
+ *
+ * Returns: %TRUE if @nalu repeats a stored PPS
+ */
+bool
+h264_parser_is_repeated_pps (H264NalParser * nalparser, H264NalUnit * nalu)
+{
+  H264PPS *stored = h264_parser_find_repeated_pps (nalparser, nalu);
+
+  if (!stored)
+    return FALSE;
+  nalparser->last_pps = stored;
+  return TRUE;
+}
+
 /**
  * h264_pps_clear:
  * @pps: The #H264PPS to free
@@ -291,6 +291,7 @@ typedef enum
 } H264SliceType;
 
 typedef struct _H264NalParser              H264NalParser;
+typedef struct _H264ParamSetRaw            H264ParamSetRaw;
 
 typedef struct _H264NalUnit                H264NalUnit;
 typedef struct _H264NalUnitExtensionMVC    H264NalUnitExtensionMVC;
@@ -1001,12 +1002,19 @@ struct _H264SEIMessage
  * H264NalParser:
  *
  * H264 NAL Parser (opaque structure).
+ *
+ * Parameter sets are allocated on first use and never move afterwards,
+ * so pointers handed out (e.g. #H264PPS.sequence, #H264SliceHdr.pps)
+ * stay valid until the parser is freed. The raw payload of each stored
+ * set is kept to recognize repeated, byte-identical NAL units.
  */
 struct _H264NalParser
 {
   /*< private >*/
-  H264SPS sps[H264_MAX_SPS_COUNT];
-  H264PPS pps[H264_MAX_PPS_COUNT];
+  H264SPS *sps[H264_MAX_SPS_COUNT];
+  H264PPS *pps[H264_MAX_PPS_COUNT];
+  H264ParamSetRaw *sps_raw[H264_MAX_SPS_COUNT];
+  H264ParamSetRaw *pps_raw[H264_MAX_PPS_COUNT];
   H264SPS *last_sps;
   H264PPS *last_pps;
 };
@@ -1044,6 +1052,12 @@ H264ParserResult h264_parser_parse_pps         (H264NalParser *nalparser,
 H264ParserResult h264_parser_parse_sei         (H264NalParser *nalparser,
                                                        H264NalUnit *nalu, GArray ** messages);
 
+bool h264_parser_is_repeated_sps                 (H264NalParser *nalparser,
+                                                       H264NalUnit *nalu);
+
+bool h264_parser_is_repeated_pps                 (H264NalParser *nalparser,
+                                                       H264NalUnit *nalu);
+
 void h264_nal_parser_free                         (H264NalParser *nalparser);
 
 H264ParserResult h264_parse_subset_sps         (H264NalUnit *nalu,
@@ -149,6 +149,24 @@ static const uint8_t zigzag_8x8[64] = {
   53, 60, 61, 54, 47, 55, 62, 63
 };
 
+static const uint8_t uprightdiagonal_4x4[16] = {
+  0, 4, 1, 8,
+  5, 2, 12, 9,
+  6, 3, 13, 10,
+  7, 14, 11, 15
+};
+
+static const uint8_t uprightdiagonal_8x8[64] = {
+  0, 8, 1, 16, 9, 2, 24, 17,
+  10, 3, 32, 25, 18, 11, 4, 40,
+  33, 26, 19, 12, 5, 48, 41, 34,
+  27, 20, 13, 6, 56, 49, 42, 35,
+  28, 21, 14, 7, 57, 50, 43, 36,
+  29, 22, 15, 58, 51, 44, 37, 30,
+  23, 59, 52, 45, 38, 31, 60, 53,
+  46, 39, 61, 54, 47, 62, 55, 63
+};
+
 typedef struct
 {
   uint32_t par_n, par_d;
@@ -1991,6 +2009,7 @@ h265_parser_parse_slice_hdr (H265Parser * parser,
   slice->pic_output_flag = 1;
   slice->pic_order_cnt_lsb = 0;
   slice->short_term_ref_pic_set_idx = 0;
+  slice->short_term_ref_pic_set_size = 0;
   slice->num_long_term_sps = 0;
   slice->num_long_term_pics = 0;
   for (i = 0; i < 16; i++) {
@@ -2040,10 +2059,12 @@ h265_parser_parse_slice_hdr (H265Parser * parser,
 
       READ_UINT8 (&nr, slice->short_term_ref_pic_set_sps_flag, 1);
       if (!slice->short_term_ref_pic_set_sps_flag) {
+        uint32_t pos = nal_reader_get_pos (&nr);
         if (!h265_parser_parse_short_term_ref_pic_sets
             (&slice->short_term_ref_pic_sets, &nr,
                 sps->num_short_term_ref_pic_sets, sps))
           goto error;
+        slice->short_term_ref_pic_set_size = nal_reader_get_pos (&nr) - pos;
       } else if (sps->num_short_term_ref_pic_sets > 1) {
         const uint32_t n = ceil_log2 (sps->num_short_term_ref_pic_sets);
         READ_UINT8 (&nr, slice->short_term_ref_pic_set_idx, n);
@@ -2108,11 +2129,12 @@ h265_parser_parse_slice_hdr (H265Parser * parser,
       }
 
       /* calculate NumPocTotalCurr */
-      if (slice->short_term_ref_pic_set_sps_flag)
+      if (slice->short_term_ref_pic_set_sps_flag) {
         CurrRpsIdx = slice->short_term_ref_pic_set_idx;
-      else
-        CurrRpsIdx = sps->num_short_term_ref_pic_sets;
-      stRPS = &sps->short_term_ref_pic_set[CurrRpsIdx];
+        stRPS = &sps->short_term_ref_pic_set[CurrRpsIdx];
+      } else {
+        stRPS = &slice->short_term_ref_pic_sets;
+      }
       for (i = 0; i < stRPS->NumNegativePics; i++)
         if (stRPS->UsedByCurrPicS0[i])
           NumPocTotalCurr++;
@@ -2593,3 +2615,50 @@ h265_quant_matrix_8x8_get_raster_from_zigzag (uint8_t out_quant[64],
   for (i = 0; i < 64; i++)
     out_quant[zigzag_8x8[i]] = quant[i];
 }
+
+/**
+ * h265_quant_matrix_4x4_get_raster_from_uprightdiagonal:
+ * @out_quant: (out): The resulting quantization matrix
+ * @quant: The source quantization matrix
+ *
+ * Converts quantization matrix @quant from up-right diagonal scan order
+ * (the order scaling lists are coded in, 6.5.3) to raster scan order and
+ * store the resulting factors into @out_quant.
+ *
+ * Note: it is an error to pass the same table in both @quant and
+ * @out_quant arguments.
+ */
+void
+h265_quant_matrix_4x4_get_raster_from_uprightdiagonal (uint8_t out_quant[16],
+    const uint8_t quant[16])
+{
+  uint32_t i;
+
+  g_return_if_fail (out_quant != quant);
+
+  for (i = 0; i < 16; i++)
+    out_quant[uprightdiagonal_4x4[i]] = quant[i];
+}
+
+/**
+ * h265_quant_matrix_8x8_get_raster_from_uprightdiagonal:
+ * @out_quant: (out): The resulting quantization matrix
+ * @quant: The source quantization matrix
+ *
+ * Converts quantization matrix @quant from up-right diagonal scan order
+ * to raster scan order and store the resulting factors into @out_quant.
+ *
+ * Note: it is an error to pass the same table in both @quant and
+ * @out_quant arguments.
+ */
+void
+h265_quant_matrix_8x8_get_raster_from_uprightdiagonal (uint8_t out_quant[64],
+    const uint8_t quant[64])
+{
+  uint32_t i;
+
+  g_return_if_fail (out_quant != quant);
+
+  for (i = 0; i < 64; i++)
+    out_quant[uprightdiagonal_8x8[i]] = quant[i];
+}
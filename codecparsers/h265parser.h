@@ -877,6 +877,8 @@ struct _H265SliceHdr
   uint8_t  short_term_ref_pic_set_sps_flag;
   H265ShortTermRefPicSet short_term_ref_pic_sets;
   uint8_t short_term_ref_pic_set_idx;
+  /* size of short_term_ref_pic_sets in the slice header, in bits */
+  uint32_t short_term_ref_pic_set_size;
 
   uint8_t num_long_term_sps;
   uint8_t num_long_term_pics;
@@ -1075,6 +1077,12 @@ void    h265_quant_matrix_8x8_get_zigzag_from_raster (uint8_t out_quant[64],
 void    h265_quant_matrix_8x8_get_raster_from_zigzag (uint8_t out_quant[64],
                                                           const uint8_t quant[64]);
 
+void    h265_quant_matrix_4x4_get_raster_from_uprightdiagonal (uint8_t out_quant[16],
+                                                          const uint8_t quant[16]);
+
+void    h265_quant_matrix_8x8_get_raster_from_uprightdiagonal (uint8_t out_quant[64],
+                                                          const uint8_t quant[64]);
+
 #define h265_quant_matrix_16x16_get_zigzag_from_raster \
         h265_quant_matrix_8x8_get_zigzag_from_raster
 #define h265_quant_matrix_16x16_get_raster_from_zigzag \
@@ -1083,6 +1091,10 @@ void    h265_quant_matrix_8x8_get_raster_from_zigzag (uint8_t out_quant[64],
         h265_quant_matrix_8x8_get_zigzag_from_raster
 #define h265_quant_matrix_32x32_get_raster_from_zigzag \
         h265_quant_matrix_8x8_get_raster_from_zigzag
+#define h265_quant_matrix_16x16_get_raster_from_uprightdiagonal \
+        h265_quant_matrix_8x8_get_raster_from_uprightdiagonal
+#define h265_quant_matrix_32x32_get_raster_from_uprightdiagonal \
+        h265_quant_matrix_8x8_get_raster_from_uprightdiagonal
 
 G_END_DECLS
 #endif
@@ -63,6 +63,10 @@ ceil_log2 (uint32_t v)
 
 /****** Nal parser ******/
 
+/* raw bytes searched for 00 00 03 per scan, the reader never looks for
+ * emulation prevention bytes much further than it is about to load */
+#define NAL_READER_EPB_SCAN_WINDOW 128
+
 void
 nal_reader_init (NalReader * nr, const uint8_t * data, uint32_t size)
 {
@@ -72,45 +76,94 @@ nal_reader_init (NalReader * nr, const uint8_t * data, uint32_t size)
 
   nr->byte = 0;
   nr->bits_in_cache = 0;
-  /* fill with something other than 0 to detect emulation prevention bytes */
-  nr->first_byte = 0xff;
-  nr->cache = 0xff;
+  nr->cache = 0;
+
+  nr->epb_scanned = 0;
+  nr->next_epb = G_MAXUINT32;
 }
 
-inline bool
-nal_reader_read (NalReader * nr, uint32_t nbits)
+/* Returns the offset up to which raw bytes can be loaded without meeting an
+ * emulation_prevention_three_byte. This is either the offset of the next
+ * one, or a point at least 8 bytes ahead of the reader (or the data end). */
+static inline uint32_t
+nal_reader_scan_epb (NalReader * nr)
 {
-  if (G_UNLIKELY (nr->byte * 8 + (nbits - nr->bits_in_cache) > nr->size * 8)) {
-    DEBUG ("Can not read %u bits, bits in cache %u, Byte * 8 %u, size in "
-        "bits %u", nbits, nr->bits_in_cache, nr->byte * 8, nr->size * 8);
-    return FALSE;
+  while (nr->next_epb == G_MAXUINT32) {
+    uint32_t start = nr->epb_scanned;
+    uint32_t len;
+    int32_t off;
+
+    if (start + 3 > nr->size)
+      return nr->size;
+    if (start + 2 >= nr->byte + 8)
+      return start + 2;
+
+    len = MIN (nr->size - start, NAL_READER_EPB_SCAN_WINDOW + 2);
+    off = start_code_find_epb (nr->data + start, len);
+    if (off >= 0)
+      nr->next_epb = start + off + 2;
+    else
+      nr->epb_scanned = start + len - 2;
   }
+  return nr->next_epb;
+}
 
-  while (nr->bits_in_cache < nbits) {
-    uint8_t byte;
-    bool check_three_byte;
+/* Loads as many whole bytes as fit in the cache. Away from emulation
+ * prevention bytes this is a single 64-bit load. */
+static inline void
+nal_reader_refill (NalReader * nr)
+{
+  uint32_t n = (64 - nr->bits_in_cache) >> 3;
+  uint32_t end;
 
-    check_three_byte = TRUE;
-  next_byte:
-    if (G_UNLIKELY (nr->byte >= nr->size))
-      return FALSE;
+  if (G_UNLIKELY (!n))
+    return;
 
-    byte = nr->data[nr->byte++];
+  end = nal_reader_scan_epb (nr);
+  if (G_LIKELY (nr->byte + 8 <= end)) {
+    uint64_t v = GST_READ_UINT64_BE (nr->data + nr->byte);
 
-    /* check if the byte is a emulation_prevention_three_byte */
-    if (check_three_byte && byte == 0x03 && nr->first_byte == 0x00 &&
-        ((nr->cache & 0xff) == 0)) {
-      /* next byte goes unconditionally to the cache, even if it's 0x03 */
-      check_three_byte = FALSE;
+    nr->cache = n == 8 ? v : (nr->cache << (n * 8)) | (v >> (64 - n * 8));
+    nr->byte += n;
+    nr->bits_in_cache += n * 8;
+    return;
+  }
+
+  while (n > 0 && nr->byte < nr->size) {
+    if (nr->byte >= end)
+      end = nal_reader_scan_epb (nr);
+    if (nr->byte == nr->next_epb) {
+      /* drop it, the next sequence may start with the byte after it */
+      nr->epb_rbsp[nr->n_epb % NAL_READER_EPB_RING_SIZE] =
+          nr->byte - nr->n_epb;
       nr->n_epb++;
-      goto next_byte;
+      nr->byte++;
+      nr->epb_scanned = nr->byte;
+      nr->next_epb = G_MAXUINT32;
+      end = nr->byte;
+      continue;
     }
-    nr->cache = (nr->cache << 8) | nr->first_byte;
-    nr->first_byte = byte;
+    nr->cache = (nr->cache << 8) | nr->data[nr->byte++];
     nr->bits_in_cache += 8;
+    n--;
   }
+}
 
-  return TRUE;
+/* Makes sure at least @nbits (up to 57) are in the cache */
+inline bool
+nal_reader_read (NalReader * nr, uint32_t nbits)
+{
+  if (G_LIKELY (nr->bits_in_cache >= nbits))
+    return TRUE;
+
+  if (G_UNLIKELY (nr->byte * 8 + (nbits - nr->bits_in_cache) > nr->size * 8)) {
+    DEBUG ("Can not read %u bits, bits in cache %u, Byte * 8 %u, size in "
+        "bits %u", nbits, nr->bits_in_cache, nr->byte * 8, nr->size * 8);
+    return FALSE;
+  }
+
+  nal_reader_refill (nr);
+  return nr->bits_in_cache >= nbits;
 }
 
 /* Skips the specified amount of bits. This is only suitable to a
@@ -120,9 +173,13 @@ nal_reader_skip (NalReader * nr, uint32_t nbits)
 {
   g_assert (nbits <= 8 * sizeof (nr->cache));
 
-  if (G_UNLIKELY (!nal_reader_read (nr, nbits)))
-    return FALSE;
-
+  while (nbits > nr->bits_in_cache) {
+    nbits -= nr->bits_in_cache;
+    nr->bits_in_cache = 0;
+    nal_reader_refill (nr);
+    if (G_UNLIKELY (!nr->bits_in_cache))
+      return FALSE;
+  }
   nr->bits_in_cache -= nbits;
 
   return TRUE;
@@ -146,43 +203,48 @@ nal_reader_skip_long (NalReader * nr, uint32_t nbits)
   return TRUE;
 }
 
+/* An emulation prevention byte counts once the reader went past the rbsp
+ * byte following it. Only the last few can still be ahead of the reader,
+ * since the cache holds at most 8 bytes. */
 inline uint32_t
-nal_reader_get_pos (const NalReader * nr)
+nal_reader_get_epb_count (const NalReader * nr)
 {
-  return nr->byte * 8 - nr->bits_in_cache;
+  uint32_t pos = (nr->byte - nr->n_epb) * 8 - nr->bits_in_cache;
+  uint32_t n = nr->n_epb;
+
+  while (n > 0 && nr->n_epb - n < NAL_READER_EPB_RING_SIZE &&
+      nr->epb_rbsp[(n - 1) % NAL_READER_EPB_RING_SIZE] * 8 >= pos)
+    n--;
+  return n;
 }
 
 inline uint32_t
-nal_reader_get_remaining (const NalReader * nr)
+nal_reader_get_pos (const NalReader * nr)
 {
-  return (nr->size - nr->byte) * 8 + nr->bits_in_cache;
+  return (nr->byte - nr->n_epb + nal_reader_get_epb_count (nr)) * 8 -
+      nr->bits_in_cache;
 }
 
 inline uint32_t
-nal_reader_get_epb_count (const NalReader * nr)
+nal_reader_get_remaining (const NalReader * nr)
 {
-  return nr->n_epb;
+  return nr->size * 8 - nal_reader_get_pos (nr);
 }
 
 #define NAL_READER_READ_BITS(bits) \
 bool \
 nal_reader_get_bits_uint##bits (NalReader *nr, uint##bits##_t *val, uint32_t nbits) \
 { \
-  uint32_t shift; \
-  \
   if (!nal_reader_read (nr, nbits)) \
     return FALSE; \
   \
-  /* bring the required bits down and truncate */ \
-  shift = nr->bits_in_cache - nbits; \
-  *val = nr->first_byte >> shift; \
-  \
-  *val |= nr->cache << (8 - shift); \
-  /* mask out required bits */ \
-  if (nbits < bits) \
-    *val &= ((uint##bits##_t)1 << nbits) - 1; \
-  \
-  nr->bits_in_cache = shift; \
+  /* bring the required bits to the top, then down, this also truncates */ \
+  if (G_UNLIKELY (!nbits)) { \
+    *val = 0; \
+    return TRUE; \
+  } \
+  *val = (nr->cache << (64 - nr->bits_in_cache)) >> (64 - nbits); \
+  nr->bits_in_cache -= nbits; \
   \
   return TRUE; \
 } \
@@ -210,6 +272,27 @@ nal_reader_get_ue (NalReader * nr, uint32_t * val)
   uint8_t bit;
   uint32_t value;
 
+  /* fast path: the whole code is in the cache, so the prefix length is
+   * the count of leading zeros and the code word minus one is the value */
+  if (nr->bits_in_cache < 32)
+    nal_reader_refill (nr);
+  if (G_LIKELY (nr->bits_in_cache)) {
+    uint64_t window = nr->cache << (64 - nr->bits_in_cache);
+    uint32_t nbits;
+
+    if (G_LIKELY (window)) {
+      i = __builtin_clzll (window);
+      nbits = 2 * i + 1;
+      if (G_LIKELY (nbits <= nr->bits_in_cache)) {
+        *val = (uint32_t) ((window >> (64 - nbits)) - 1);
+        nr->bits_in_cache -= nbits;
+        return TRUE;
+      }
+      i = 0;
+    }
+  }
+
+  /* slow path for codes longer than the cached bits */
   if (G_UNLIKELY (!nal_reader_get_bits_uint8 (nr, &bit, 1))) {
 
     return FALSE;
@@ -228,7 +311,7 @@ nal_reader_get_ue (NalReader * nr, uint32_t * val)
   if (G_UNLIKELY (!nal_reader_get_bits_uint32 (nr, &value, i)))
     return FALSE;
 
-  *val = (1 << i) - 1 + value;
+  *val = (uint32_t) (((uint64_t) 1 << i) - 1 + value);
 
   return TRUE;
 }
@@ -252,7 +335,8 @@ nal_reader_get_se (NalReader * nr, int32_t * val)
 bool
 nal_reader_is_byte_aligned (NalReader * nr)
 {
-  if (nr->bits_in_cache != 0)
+  /* the cache only ever holds whole bytes */
+  if (nr->bits_in_cache % 8 != 0)
     return FALSE;
   return TRUE;
 }
@@ -303,10 +387,8 @@ nal_reader_has_more_data (NalReader * nr)
 inline int32_t
 scan_for_start_codes (const uint8_t * data, uint32_t size)
 {
-  ByteReader br;
-  byte_reader_init (&br, data, size);
-
   /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
+  if (size < 4)
+    return -1;
+  return start_code_find (data, size - 1);
 }
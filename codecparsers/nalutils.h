@@ -37,10 +37,15 @@
 
 #include "bytereader.h"
 #include "bitreader.h"
+#include "startcode.h"
 #include <string.h>
 
 uint32_t ceil_log2 (uint32_t v);
 
+/* ring of the most recent emulation prevention bytes, large enough to
+ * cover every one that can still sit behind bits held in the cache */
+#define NAL_READER_EPB_RING_SIZE 8
+
 typedef struct
 {
   const uint8_t *data;
@@ -49,8 +54,13 @@ typedef struct
   uint32_t n_epb;                  /* Number of emulation prevention bytes */
   uint32_t byte;                   /* Byte position */
   uint32_t bits_in_cache;          /* bitpos in the cache of next bit */
-  uint8_t first_byte;
-  uint64_t cache;                /* cached bytes */
+  uint64_t cache;                  /* cached bits, next bit is the msb of the
+                                      low bits_in_cache bits */
+
+  uint32_t epb_scanned;            /* no 00 00 03 starts below this offset */
+  uint32_t next_epb;               /* offset of the next 0x03 to drop, or
+                                      G_MAXUINT32 if not found yet */
+  uint32_t epb_rbsp[NAL_READER_EPB_RING_SIZE]; /* rbsp offsets of dropped 0x03 */
 } NalReader;
 
 void nal_reader_init (NalReader * nr, const uint8_t * data, uint32_t size);
@@ -0,0 +1,171 @@
+/*
+ *  startcode.c - fast scanner for 00 00 01 start codes and 00 00 03
+ *                emulation prevention sequences
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "startcode.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define START_CODE_USE_X86 1
+#include <immintrin.h>
+#endif
+
+typedef int32_t (*StartCodeFindFunc) (const uint8_t * data, uint32_t size,
+    uint8_t last);
+
+/* scalar scan for 00 00 @last from @pos, same skipping rules as the
+ * byte reader one */
+static inline int32_t
+_start_code_find_from (const uint8_t * data, uint32_t pos, uint32_t size,
+    uint8_t last)
+{
+  const uint8_t *p, *end;
+
+  if (size < 3 || pos > size - 3)
+    return -1;
+
+  p = data + pos;
+  end = data + size - 3;
+  while (p <= end) {
+    if (p[2] && p[2] != last)
+      p += 3;
+    else if (p[1])
+      p += 2;
+    else if (p[0] || p[2] != last)
+      p++;
+    else
+      return p - data;
+  }
+  return -1;
+}
+
+static int32_t
+_start_code_find_c (const uint8_t * data, uint32_t size, uint8_t last)
+{
+  return _start_code_find_from (data, 0, size, last);
+}
+
+int32_t
+start_code_find_c (const uint8_t * data, uint32_t size)
+{
+  return _start_code_find_from (data, 0, size, 1);
+}
+
+#ifdef START_CODE_USE_X86
+
+/* a block without any zero byte can not hold the first two bytes of a
+ * prefix, so only blocks with zeros pay for the three-load compare */
+__attribute__ ((target ("sse2")))
+static int32_t
+_start_code_find_sse2 (const uint8_t * data, uint32_t size, uint8_t last)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i third = _mm_set1_epi8 (last);
+  uint32_t pos = 0;
+
+  while (pos + 18 <= size) {
+    __m128i b0 = _mm_loadu_si128 ((const __m128i *) (data + pos));
+    if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (b0, zero))) {
+      __m128i b1 = _mm_loadu_si128 ((const __m128i *) (data + pos + 1));
+      __m128i b2 = _mm_loadu_si128 ((const __m128i *) (data + pos + 2));
+      __m128i m = _mm_and_si128 (_mm_cmpeq_epi8 (b0, zero),
+          _mm_cmpeq_epi8 (b1, zero));
+      uint32_t mask = _mm_movemask_epi8 (_mm_and_si128 (m,
+              _mm_cmpeq_epi8 (b2, third)));
+      if (mask)
+        return pos + __builtin_ctz (mask);
+    }
+    pos += 16;
+  }
+  return _start_code_find_from (data, pos, size, last);
+}
+
+__attribute__ ((target ("avx2")))
+static int32_t
+_start_code_find_avx2 (const uint8_t * data, uint32_t size, uint8_t last)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i third = _mm256_set1_epi8 (last);
+  uint32_t pos = 0;
+
+  while (pos + 34 <= size) {
+    __m256i b0 = _mm256_loadu_si256 ((const __m256i *) (data + pos));
+    if (_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (b0, zero))) {
+      __m256i b1 = _mm256_loadu_si256 ((const __m256i *) (data + pos + 1));
+      __m256i b2 = _mm256_loadu_si256 ((const __m256i *) (data + pos + 2));
+      __m256i m = _mm256_and_si256 (_mm256_cmpeq_epi8 (b0, zero),
+          _mm256_cmpeq_epi8 (b1, zero));
+      uint32_t mask = _mm256_movemask_epi8 (_mm256_and_si256 (m,
+              _mm256_cmpeq_epi8 (b2, third)));
+      if (mask)
+        return pos + __builtin_ctz (mask);
+    }
+    pos += 32;
+  }
+  return _start_code_find_from (data, pos, size, last);
+}
+
+static StartCodeFindFunc
+_start_code_select (void)
+{
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    return _start_code_find_avx2;
+  if (__builtin_cpu_supports ("sse2"))
+    return _start_code_find_sse2;
+  return _start_code_find_c;
+}
+
+#else
+
+static StartCodeFindFunc
+_start_code_select (void)
+{
+  return _start_code_find_c;
+}
+
+#endif /* START_CODE_USE_X86 */
+
+static inline int32_t
+_start_code_find (const uint8_t * data, uint32_t size, uint8_t last)
+{
+  /* selection is idempotent, so a racy first call is harmless */
+  static StartCodeFindFunc find = NULL;
+
+  if (G_UNLIKELY (!find))
+    find = _start_code_select ();
+  return find (data, size, last);
+}
+
+int32_t
+start_code_find (const uint8_t * data, uint32_t size)
+{
+  return _start_code_find (data, size, 1);
+}
+
+int32_t
+start_code_find_epb (const uint8_t * data, uint32_t size)
+{
+  return _start_code_find (data, size, 3);
+}
@@ -0,0 +1,69 @@
+/*
+ *  startcode.h - fast scanner for 00 00 01 start codes and 00 00 03
+ *                emulation prevention sequences
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef START_CODE_H
+#define START_CODE_H
+
+#include "gst/gst.h"
+
+G_BEGIN_DECLS
+
+/**
+ * start_code_find:
+ * @data: data to scan
+ * @size: size of @data in bytes
+ *
+ * Finds the first 00 00 01 start code prefix lying completely inside
+ * @data. On x86 the scan is done 16 (SSE2) or 32 (AVX2) bytes at a
+ * time, the instruction set is picked once at runtime.
+ *
+ * Returns: offset of the first byte of the prefix, or -1 if none found.
+ */
+int32_t start_code_find (const uint8_t * data, uint32_t size);
+
+/**
+ * start_code_find_c:
+ * @data: data to scan
+ * @size: size of @data in bytes
+ *
+ * Portable version of start_code_find(), always available.
+ *
+ * Returns: offset of the first byte of the prefix, or -1 if none found.
+ */
+int32_t start_code_find_c (const uint8_t * data, uint32_t size);
+
+/**
+ * start_code_find_epb:
+ * @data: data to scan
+ * @size: size of @data in bytes
+ *
+ * Same as start_code_find(), but looks for the 00 00 03 sequence that
+ * carries an emulation_prevention_three_byte.
+ *
+ * Returns: offset of the first zero byte of the sequence, or -1 if none
+ * found.
+ */
+int32_t start_code_find_epb (const uint8_t * data, uint32_t size);
+
+G_END_DECLS
+
+#endif /* START_CODE_H */
@@ -115,7 +115,7 @@ static const VLCTable vc1_bfraction_vlc_table[] = {
   {VC1_BFRACTION_BASIS / 2, 0x00, 3},
   {VC1_BFRACTION_BASIS / 3, 0x01, 3},
   {(VC1_BFRACTION_BASIS * 2) / 3, 0x02, 3},
-  {VC1_BFRACTION_BASIS / 4, 0x02, 3},
+  {VC1_BFRACTION_BASIS / 4, 0x03, 3},
   {(VC1_BFRACTION_BASIS * 3) / 4, 0x04, 3},
   {VC1_BFRACTION_BASIS / 5, 0x05, 3},
   {(VC1_BFRACTION_BASIS * 2) / 5, 0x06, 3},
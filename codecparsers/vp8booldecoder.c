@@ -0,0 +1,77 @@
+/*
+ *  vp8booldecoder.c - VP8 boolean decoder working on a 64-bit window
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "vp8booldecoder.h"
+
+void
+vp8_bool_decoder_init (Vp8BoolDecoder * bd, const uint8_t * buf,
+    uint32_t buf_size)
+{
+  bd->buf = buf;
+  bd->buf_end = buf + buf_size;
+  bd->value = 0;
+  bd->count = -8;
+  bd->range = 255;
+
+  vp8_bool_decoder_fill (bd);
+}
+
+/* byte-wise refill for the last bytes of the buffer, then marks the
+ * decoder as exhausted */
+void
+vp8_bool_decoder_fill_tail (Vp8BoolDecoder * bd)
+{
+  int32_t shift = VP8_BOOL_VALUE_SIZE - 8 - (bd->count + 8);
+  int32_t bits_left = (bd->buf_end - bd->buf) * 8;
+  int32_t loop_end = 0;
+
+  if (shift + 8 - bits_left >= 0) {
+    bd->count += VP8_BOOL_LOTS_OF_BITS;
+    loop_end = shift + 8 - bits_left;
+    if (!bits_left)
+      return;
+  }
+
+  while (shift >= loop_end) {
+    bd->count += 8;
+    bd->value |= (uint64_t) * bd->buf << shift;
+    bd->buf++;
+    shift -= 8;
+  }
+}
+
+/* state for a decoder that resumes right after the consumed bits, such
+ * as the hardware one */
+void
+vp8_bool_decoder_get_state (Vp8BoolDecoder * bd, uint8_t * range,
+    uint8_t * value, uint8_t * count)
+{
+  if (bd->count < 0)
+    vp8_bool_decoder_fill (bd);
+
+  *range = bd->range;
+  *value = (uint8_t) (bd->value >> (VP8_BOOL_VALUE_SIZE - 8));
+  *count = (8 + bd->count) % 8;
+}
@@ -0,0 +1,138 @@
+/*
+ *  vp8booldecoder.h - VP8 boolean decoder working on a 64-bit window
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef VP8_BOOL_DECODER_H
+#define VP8_BOOL_DECODER_H
+
+#include "gst/gst.h"
+
+G_BEGIN_DECLS
+
+#define VP8_BOOL_VALUE_SIZE   64
+
+/* added to count once the buffer is exhausted, zeros are shifted in
+   from there on */
+#define VP8_BOOL_LOTS_OF_BITS 0x40000000
+
+typedef struct _Vp8BoolDecoder Vp8BoolDecoder;
+
+/**
+ * Vp8BoolDecoder:
+ * @buf: next byte to load into @value
+ * @buf_end: end of the bitstream buffer
+ * @value: bit window, the bits being decoded are the most significant ones
+ * @count: number of bits in @value below its top byte, a negative
+ *   value means @value must be refilled before the next decode
+ * @range: current "Range" value
+ *
+ * Boolean entropy decoder, see RFC 6386 section 7.
+ */
+struct _Vp8BoolDecoder {
+  const uint8_t *buf;
+  const uint8_t *buf_end;
+  uint64_t value;
+  int32_t count;
+  uint32_t range;
+};
+
+extern const uint8_t vp8_norm[256];
+
+void
+vp8_bool_decoder_init (Vp8BoolDecoder * bd, const uint8_t * buf,
+    uint32_t buf_size);
+
+void
+vp8_bool_decoder_fill_tail (Vp8BoolDecoder * bd);
+
+void
+vp8_bool_decoder_get_state (Vp8BoolDecoder * bd, uint8_t * range,
+    uint8_t * value, uint8_t * count);
+
+/* tops @value up with as many whole bytes as fit, in one load while
+ * that does not reach the end of the buffer */
+static inline void
+vp8_bool_decoder_fill (Vp8BoolDecoder * bd)
+{
+  uint32_t valid, nbits;
+  uint64_t bits;
+
+  if (G_UNLIKELY (bd->buf_end - bd->buf <= 8)) {
+    vp8_bool_decoder_fill_tail (bd);
+    return;
+  }
+
+  valid = bd->count + 8;
+  nbits = (VP8_BOOL_VALUE_SIZE - valid) & ~7;
+  bits = GST_READ_UINT64_BE (bd->buf);
+  bits = bits >> (VP8_BOOL_VALUE_SIZE - nbits) << (VP8_BOOL_VALUE_SIZE - nbits);
+
+  bd->value |= bits >> valid;
+  bd->buf += nbits / 8;
+  bd->count += nbits;
+}
+
+static inline int32_t
+vp8_bool_decoder_read (Vp8BoolDecoder * bd, uint8_t prob)
+{
+  uint32_t split = 1 + (((bd->range - 1) * prob) >> 8);
+  uint64_t bigsplit;
+  uint32_t shift;
+  int32_t bit = 0;
+
+  if (bd->count < 0)
+    vp8_bool_decoder_fill (bd);
+
+  bigsplit = (uint64_t) split << (VP8_BOOL_VALUE_SIZE - 8);
+  if (bd->value >= bigsplit) {
+    bd->range -= split;
+    bd->value -= bigsplit;
+    bit = 1;
+  } else {
+    bd->range = split;
+  }
+
+  shift = vp8_norm[bd->range];
+  bd->range <<= shift;
+  bd->value <<= shift;
+  bd->count -= shift;
+  return bit;
+}
+
+static inline int32_t
+vp8_bool_decoder_read_literal (Vp8BoolDecoder * bd, int32_t bits)
+{
+  int32_t v = 0;
+
+  while (bits-- > 0)
+    v = (v << 1) | vp8_bool_decoder_read (bd, 128);
+  return v;
+}
+
+/* number of bits consumed since vp8_bool_decoder_init() */
+static inline uint32_t
+vp8_bool_decoder_get_pos (Vp8BoolDecoder * bd, const uint8_t * buf)
+{
+  return (bd->buf - buf) * 8 - (8 + bd->count);
+}
+
+G_END_DECLS
+
+#endif /* VP8_BOOL_DECODER_H */
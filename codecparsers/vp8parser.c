@@ -35,7 +35,7 @@
 #include <string.h>
 #include "bytereader.h"
 #include "vp8parser.h"
-#include "vp8rangedecoder.h"
+#include "vp8booldecoder.h"
 #include "vp8utils.h"
 
 DEBUG_CATEGORY (vp8_parser_debug);
@@ -79,31 +79,31 @@ ensure_prob_tables (void)
   val = vp8_read_sint ((rd), (nbits))
 
 static inline bool
-vp8_read_bool (Vp8RangeDecoder * rd)
+vp8_read_bool (Vp8BoolDecoder * rd)
 {
-  return (bool) vp8_range_decoder_read_literal (rd, 1);
+  return (bool) vp8_bool_decoder_read (rd, 128);
 }
 
 static inline uint32_t
-vp8_read_uint (Vp8RangeDecoder * rd, uint32_t nbits)
+vp8_read_uint (Vp8BoolDecoder * rd, uint32_t nbits)
 {
-  return (uint32_t) vp8_range_decoder_read_literal (rd, nbits);
+  return (uint32_t) vp8_bool_decoder_read_literal (rd, nbits);
 }
 
 static inline int32_t
-vp8_read_sint (Vp8RangeDecoder * rd, uint32_t nbits)
+vp8_read_sint (Vp8BoolDecoder * rd, uint32_t nbits)
 {
   int32_t v;
 
-  v = vp8_range_decoder_read_literal (rd, nbits);
-  if (vp8_range_decoder_read_literal (rd, 1))
+  v = vp8_bool_decoder_read_literal (rd, nbits);
+  if (vp8_bool_decoder_read (rd, 128))
     v = -v;
   return v;
 }
 
 /* Parse update_segmentation() */
 static bool
-parse_update_segmentation (Vp8RangeDecoder * rd, Vp8Segmentation * seg)
+parse_update_segmentation (Vp8BoolDecoder * rd, Vp8Segmentation * seg)
 {
   bool update;
   int32_t i;
@@ -160,7 +160,7 @@ parse_update_segmentation (Vp8RangeDecoder * rd, Vp8Segmentation * seg)
 
 /* Parse mb_lf_adjustments() to update loop filter delta adjustments */
 static bool
-parse_mb_lf_adjustments (Vp8RangeDecoder * rd, Vp8MbLfAdjustments * adj)
+parse_mb_lf_adjustments (Vp8BoolDecoder * rd, Vp8MbLfAdjustments * adj)
 {
   bool update;
   int32_t i;
@@ -193,7 +193,7 @@ parse_mb_lf_adjustments (Vp8RangeDecoder * rd, Vp8MbLfAdjustments * adj)
 
 /* Parse quant_indices() */
 static bool
-parse_quant_indices (Vp8RangeDecoder * rd, Vp8QuantIndices * qip)
+parse_quant_indices (Vp8BoolDecoder * rd, Vp8QuantIndices * qip)
 {
   bool update;
 
@@ -234,37 +234,30 @@ parse_quant_indices (Vp8RangeDecoder * rd, Vp8QuantIndices * qip)
 
 /* Parse token_prob_update() to update persistent token probabilities */
 static bool
-parse_token_prob_update (Vp8RangeDecoder * rd, Vp8TokenProbs * probs)
+parse_token_prob_update (Vp8BoolDecoder * rd, Vp8TokenProbs * probs)
 {
-  int32_t i, j, k, l;
-  uint8_t prob;
+  const uint8_t *const update_probs = &vp8_token_update_probs.prob[0][0][0][0];
+  uint8_t *const token_probs = &probs->prob[0][0][0][0];
+  uint32_t i;
 
-  for (i = 0; i < 4; i++) {
-    for (j = 0; j < 8; j++) {
-      for (k = 0; k < 3; k++) {
-        for (l = 0; l < 11; l++) {
-          if (vp8_range_decoder_read (rd,
-                  vp8_token_update_probs.prob[i][j][k][l])) {
-            READ_UINT (rd, prob, 8, "token_prob_update");
-            probs->prob[i][j][k][l] = prob;
-          }
-        }
-      }
-    }
+  /* the four nested loops of the spec visit the tables in memory order */
+  for (i = 0; i < sizeof (probs->prob); i++) {
+    if (vp8_bool_decoder_read (rd, update_probs[i]))
+      token_probs[i] = vp8_bool_decoder_read_literal (rd, 8);
   }
   return TRUE;
 }
 
 /* Parse prob_update() to update probabilities used for MV decoding */
 static bool
-parse_mv_prob_update (Vp8RangeDecoder * rd, Vp8MvProbs * probs)
+parse_mv_prob_update (Vp8BoolDecoder * rd, Vp8MvProbs * probs)
 {
   int32_t i, j;
   uint8_t prob;
 
   for (i = 0; i < 2; i++) {
     for (j = 0; j < 19; j++) {
-      if (vp8_range_decoder_read (rd, vp8_mv_update_probs.prob[i][j])) {
+      if (vp8_bool_decoder_read (rd, vp8_mv_update_probs.prob[i][j])) {
         READ_UINT (rd, prob, 7, "mv_prob_update");
         probs->prob[i][j] = prob ? (prob << 1) : 1;
       }
@@ -364,7 +357,7 @@ error:
 
 /* Parse Frame Header (19.2) */
 static Vp8ParserResult
-parse_frame_header (Vp8Parser * parser, Vp8RangeDecoder * rd,
+parse_frame_header (Vp8Parser * parser, Vp8BoolDecoder * rd,
     Vp8FrameHdr * frame_hdr)
 {
   bool update;
@@ -473,8 +466,6 @@ parse_frame_header (Vp8Parser * parser, Vp8RangeDecoder * rd,
           sizeof (frame_hdr->mode_probs));
   }
 
-  /* Calculated values */
-  frame_hdr->header_size = vp8_range_decoder_get_pos (rd);
   return VP8_PARSER_OK;
 
 error:
@@ -524,8 +515,7 @@ vp8_parser_parse_frame_header (Vp8Parser * parser,
     Vp8FrameHdr * frame_hdr, const uint8_t * data, size_t size)
 {
   ByteReader br;
-  Vp8RangeDecoder rd;
-  Vp8RangeDecoderState rd_state;
+  Vp8BoolDecoder rd;
   Vp8ParserResult result;
 
   ensure_debug_category ();
@@ -547,21 +537,23 @@ vp8_parser_parse_frame_header (Vp8Parser * parser,
 
   data += frame_hdr->data_chunk_size;
   size -= frame_hdr->data_chunk_size;
-  if (!vp8_range_decoder_init (&rd, data, size))
+  if (size && !data)
     return VP8_PARSER_BROKEN_DATA;
+  vp8_bool_decoder_init (&rd, data, size);
 
   result = parse_frame_header (parser, &rd, frame_hdr);
   if (result != VP8_PARSER_OK)
     return result;
 
+  /* Calculated values */
+  frame_hdr->header_size = vp8_bool_decoder_get_pos (&rd, data);
+
   /* Calculate partition sizes */
   if (!calc_partition_sizes (frame_hdr, data, size))
     return VP8_PARSER_BROKEN_DATA;
 
   /* Sync range decoder state */
-  vp8_range_decoder_get_state (&rd, &rd_state);
-  frame_hdr->rd_range = rd_state.range;
-  frame_hdr->rd_value = rd_state.value;
-  frame_hdr->rd_count = rd_state.count;
+  vp8_bool_decoder_get_state (&rd, &frame_hdr->rd_range,
+      &frame_hdr->rd_value, &frame_hdr->rd_count);
   return VP8_PARSER_OK;
 }
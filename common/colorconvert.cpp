@@ -0,0 +1,450 @@
+/*
+ *  colorconvert.cpp - convert raw frames between pixel formats
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "colorconvert.h"
+
+#include "common/log.h"
+#include "common/planecopy.h"
+#include "common/utils.h"
+#include <string.h>
+#include <va/va.h>
+#include <vector>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace YamiMediaCodec{
+
+/**
+ * limited range yuv to rgb in 6 bits fixed point:
+ *   Y' = (Y - 16) * y + ((Y - 16) >> 1), U' = U - 128, V' = V - 128
+ *   R = (Y' + rv * V' + 32) >> 6
+ *   G = (Y' - gu * U' - gv * V' + 32) >> 6
+ *   B = (Y' + bu * U' + 32) >> 6
+ * the half step makes the luma scale 74.5, 1.164 * 64, so 235 is white.
+ * all terms fit in int16, only B may saturate and then it clamps to 255 anyway,
+ * so the simd kernels give the same bytes as the C one.
+ */
+struct YuvToRgb {
+    int16_t y;
+    int16_t rv;
+    int16_t gu;
+    int16_t gv;
+    int16_t bu;
+};
+
+static const YuvToRgb s_bt601 = { 74, 102, 25, 52, 129 };
+static const YuvToRgb s_bt709 = { 74, 115, 14, 34, 135 };
+
+//even bytes of src to even, odd bytes to odd, count bytes each
+typedef void (*SplitBytesFunc)(const uint8_t* src, uint8_t* even, uint8_t* odd, uint32_t count);
+//the other way around
+typedef void (*MergeBytesFunc)(const uint8_t* even, const uint8_t* odd, uint8_t* dest, uint32_t count);
+//(a + b + 1) >> 1
+typedef void (*AverageBytesFunc)(const uint8_t* a, const uint8_t* b, uint8_t* dest, uint32_t count);
+//one row of NV12 to 4 bytes per pixel, r, g, b, 0xff or b, g, r, 0xff
+typedef void (*NV12ToRGBXFunc)(const uint8_t* y, const uint8_t* uv, uint8_t* dest, uint32_t width,
+                               const YuvToRgb* coef, bool bgr);
+
+struct ConvertKernels {
+    SplitBytesFunc splitBytes;
+    MergeBytesFunc mergeBytes;
+    AverageBytesFunc averageBytes;
+    NV12ToRGBXFunc nv12ToRGBX;
+};
+
+static void splitBytesC(const uint8_t* src, uint8_t* even, uint8_t* odd, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        even[i] = src[2 * i];
+        odd[i] = src[2 * i + 1];
+    }
+}
+
+static void mergeBytesC(const uint8_t* even, const uint8_t* odd, uint8_t* dest, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        dest[2 * i] = even[i];
+        dest[2 * i + 1] = odd[i];
+    }
+}
+
+static void averageBytesC(const uint8_t* a, const uint8_t* b, uint8_t* dest, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+        dest[i] = (a[i] + b[i] + 1) >> 1;
+}
+
+static inline uint8_t clampByte(int32_t v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+static void nv12ToRGBXC(const uint8_t* y, const uint8_t* uv, uint8_t* dest, uint32_t width,
+                        const YuvToRgb* coef, bool bgr)
+{
+    for (uint32_t i = 0; i < width; i++) {
+        int32_t luma = (y[i] - 16) * coef->y + ((y[i] - 16) >> 1);
+        int32_t u = uv[i & ~1u] - 128;
+        int32_t v = uv[(i & ~1u) + 1] - 128;
+        uint8_t r = clampByte((luma + coef->rv * v + 32) >> 6);
+        uint8_t g = clampByte((luma - coef->gu * u - coef->gv * v + 32) >> 6);
+        uint8_t b = clampByte((luma + coef->bu * u + 32) >> 6);
+        dest[4 * i] = bgr ? b : r;
+        dest[4 * i + 1] = g;
+        dest[4 * i + 2] = bgr ? r : b;
+        dest[4 * i + 3] = 0xff;
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+
+__attribute__((target("sse2")))
+static void splitBytesSSE2(const uint8_t* src, uint8_t* even, uint8_t* odd, uint32_t count)
+{
+    const __m128i mask = _mm_set1_epi16(0xff);
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + 2 * i + 16));
+        _mm_storeu_si128((__m128i*)(even + i),
+            _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+        _mm_storeu_si128((__m128i*)(odd + i),
+            _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+    splitBytesC(src + 2 * i, even + i, odd + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void mergeBytesSSE2(const uint8_t* even, const uint8_t* odd, uint8_t* dest, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i e = _mm_loadu_si128((const __m128i*)(even + i));
+        __m128i o = _mm_loadu_si128((const __m128i*)(odd + i));
+        _mm_storeu_si128((__m128i*)(dest + 2 * i), _mm_unpacklo_epi8(e, o));
+        _mm_storeu_si128((__m128i*)(dest + 2 * i + 16), _mm_unpackhi_epi8(e, o));
+    }
+    mergeBytesC(even + i, odd + i, dest + 2 * i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void averageBytesSSE2(const uint8_t* a, const uint8_t* b, uint8_t* dest, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_avg_epu8(x, y));
+    }
+    averageBytesC(a + i, b + i, dest + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void nv12ToRGBXSSE2(const uint8_t* y, const uint8_t* uv, uint8_t* dest, uint32_t width,
+                           const YuvToRgb* coef, bool bgr)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi8((char)0xff);
+    const __m128i y16 = _mm_set1_epi16(16);
+    const __m128i uv128 = _mm_set1_epi16(128);
+    const __m128i round = _mm_set1_epi16(32);
+    const __m128i cy = _mm_set1_epi16(coef->y);
+    const __m128i crv = _mm_set1_epi16(coef->rv);
+    const __m128i cgu = _mm_set1_epi16(coef->gu);
+    const __m128i cgv = _mm_set1_epi16(coef->gv);
+    const __m128i cbu = _mm_set1_epi16(coef->bu);
+    uint32_t i = 0;
+
+    for (; i + 8 <= width; i += 8) {
+        __m128i luma = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(y + i)), zero);
+        luma = _mm_sub_epi16(luma, y16);
+        luma = _mm_add_epi16(_mm_mullo_epi16(luma, cy), _mm_srai_epi16(luma, 1));
+        //4 u, v pairs for 8 pixels
+        __m128i chroma = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(uv + i)), zero);
+        chroma = _mm_sub_epi16(chroma, uv128);
+        __m128i u = _mm_shufflelo_epi16(chroma, _MM_SHUFFLE(2, 2, 0, 0));
+        u = _mm_shufflehi_epi16(u, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128i v = _mm_shufflelo_epi16(chroma, _MM_SHUFFLE(3, 3, 1, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 3, 1, 1));
+
+        __m128i r = _mm_adds_epi16(luma, _mm_mullo_epi16(v, crv));
+        __m128i g = _mm_subs_epi16(luma, _mm_mullo_epi16(u, cgu));
+        g = _mm_subs_epi16(g, _mm_mullo_epi16(v, cgv));
+        __m128i b = _mm_adds_epi16(luma, _mm_mullo_epi16(u, cbu));
+        r = _mm_srai_epi16(_mm_adds_epi16(r, round), 6);
+        g = _mm_srai_epi16(_mm_adds_epi16(g, round), 6);
+        b = _mm_srai_epi16(_mm_adds_epi16(b, round), 6);
+
+        __m128i first = _mm_packus_epi16(bgr ? b : r, zero);
+        __m128i third = _mm_packus_epi16(bgr ? r : b, zero);
+        g = _mm_packus_epi16(g, zero);
+        __m128i fg = _mm_unpacklo_epi8(first, g);
+        __m128i ta = _mm_unpacklo_epi8(third, alpha);
+        _mm_storeu_si128((__m128i*)(dest + 4 * i), _mm_unpacklo_epi16(fg, ta));
+        _mm_storeu_si128((__m128i*)(dest + 4 * i + 16), _mm_unpackhi_epi16(fg, ta));
+    }
+    nv12ToRGBXC(y + i, uv + i, dest + 4 * i, width - i, coef, bgr);
+}
+
+__attribute__((target("avx2")))
+static void splitBytesAVX2(const uint8_t* src, uint8_t* even, uint8_t* odd, uint32_t count)
+{
+    const __m256i mask = _mm256_set1_epi16(0xff);
+    uint32_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + 2 * i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + 2 * i + 32));
+        //packus works per 128 bits lane, put the quarters back in order
+        __m256i e = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+        __m256i o = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+        _mm256_storeu_si256((__m256i*)(even + i), _mm256_permute4x64_epi64(e, _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_si256((__m256i*)(odd + i), _mm256_permute4x64_epi64(o, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    splitBytesSSE2(src + 2 * i, even + i, odd + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void mergeBytesAVX2(const uint8_t* even, const uint8_t* odd, uint8_t* dest, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i e = _mm256_loadu_si256((const __m256i*)(even + i));
+        __m256i o = _mm256_loadu_si256((const __m256i*)(odd + i));
+        __m256i lo = _mm256_unpacklo_epi8(e, o);
+        __m256i hi = _mm256_unpackhi_epi8(e, o);
+        _mm256_storeu_si256((__m256i*)(dest + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(dest + 2 * i + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    mergeBytesSSE2(even + i, odd + i, dest + 2 * i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void averageBytesAVX2(const uint8_t* a, const uint8_t* b, uint8_t* dest, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_avg_epu8(x, y));
+    }
+    averageBytesSSE2(a + i, b + i, dest + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void nv12ToRGBXAVX2(const uint8_t* y, const uint8_t* uv, uint8_t* dest, uint32_t width,
+                           const YuvToRgb* coef, bool bgr)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set1_epi8((char)0xff);
+    const __m256i y16 = _mm256_set1_epi16(16);
+    const __m256i uv128 = _mm256_set1_epi16(128);
+    const __m256i round = _mm256_set1_epi16(32);
+    const __m256i cy = _mm256_set1_epi16(coef->y);
+    const __m256i crv = _mm256_set1_epi16(coef->rv);
+    const __m256i cgu = _mm256_set1_epi16(coef->gu);
+    const __m256i cgv = _mm256_set1_epi16(coef->gv);
+    const __m256i cbu = _mm256_set1_epi16(coef->bu);
+    uint32_t i = 0;
+
+    for (; i + 16 <= width; i += 16) {
+        __m256i luma = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + i)));
+        luma = _mm256_sub_epi16(luma, y16);
+        luma = _mm256_add_epi16(_mm256_mullo_epi16(luma, cy), _mm256_srai_epi16(luma, 1));
+        //8 u, v pairs for 16 pixels, 4 in each lane
+        __m256i chroma = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(uv + i)));
+        chroma = _mm256_sub_epi16(chroma, uv128);
+        __m256i u = _mm256_shufflelo_epi16(chroma, _MM_SHUFFLE(2, 2, 0, 0));
+        u = _mm256_shufflehi_epi16(u, _MM_SHUFFLE(2, 2, 0, 0));
+        __m256i v = _mm256_shufflelo_epi16(chroma, _MM_SHUFFLE(3, 3, 1, 1));
+        v = _mm256_shufflehi_epi16(v, _MM_SHUFFLE(3, 3, 1, 1));
+
+        __m256i r = _mm256_adds_epi16(luma, _mm256_mullo_epi16(v, crv));
+        __m256i g = _mm256_subs_epi16(luma, _mm256_mullo_epi16(u, cgu));
+        g = _mm256_subs_epi16(g, _mm256_mullo_epi16(v, cgv));
+        __m256i b = _mm256_adds_epi16(luma, _mm256_mullo_epi16(u, cbu));
+        r = _mm256_srai_epi16(_mm256_adds_epi16(r, round), 6);
+        g = _mm256_srai_epi16(_mm256_adds_epi16(g, round), 6);
+        b = _mm256_srai_epi16(_mm256_adds_epi16(b, round), 6);
+
+        //pixels 0-7 in the low lane, 8-15 in the high one
+        __m256i first = _mm256_packus_epi16(bgr ? b : r, zero);
+        __m256i third = _mm256_packus_epi16(bgr ? r : b, zero);
+        g = _mm256_packus_epi16(g, zero);
+        __m256i fg = _mm256_unpacklo_epi8(first, g);
+        __m256i ta = _mm256_unpacklo_epi8(third, alpha);
+        __m256i lo = _mm256_unpacklo_epi16(fg, ta);
+        __m256i hi = _mm256_unpackhi_epi16(fg, ta);
+        _mm256_storeu_si256((__m256i*)(dest + 4 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(dest + 4 * i + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    nv12ToRGBXSSE2(y + i, uv + i, dest + 4 * i, width - i, coef, bgr);
+}
+
+#endif //HAVE_X86_SIMD
+
+static ConvertKernels selectKernels()
+{
+    ConvertKernels kernels = { splitBytesC, mergeBytesC, averageBytesC, nv12ToRGBXC };
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        ConvertKernels avx2 = { splitBytesAVX2, mergeBytesAVX2, averageBytesAVX2, nv12ToRGBXAVX2 };
+        kernels = avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        ConvertKernels sse2 = { splitBytesSSE2, mergeBytesSSE2, averageBytesSSE2, nv12ToRGBXSSE2 };
+        kernels = sse2;
+    }
+#endif
+    return kernels;
+}
+
+static const ConvertKernels& getKernels()
+{
+    static const ConvertKernels kernels = selectKernels();
+    return kernels;
+}
+
+struct Planes {
+    uint8_t* data[3];
+    uint32_t pitch[3];
+    uint8_t* row(int plane, uint32_t y) const { return data[plane] + y * pitch[plane]; }
+};
+
+static void getPlanes(Planes& planes, const VideoFrameRawData* frame)
+{
+    uint8_t* base = reinterpret_cast<uint8_t*>(frame->handle);
+    for (int i = 0; i < 3; i++) {
+        planes.data[i] = base + frame->offset[i];
+        planes.pitch[i] = frame->pitch[i];
+    }
+}
+
+static bool isPlanar420(uint32_t fourcc)
+{
+    return fourcc == VA_FOURCC_I420 || fourcc == VA_FOURCC_YV12;
+}
+
+bool isConvertSupported(uint32_t srcFourcc, uint32_t destFourcc)
+{
+    if (srcFourcc == destFourcc)
+        return true;
+    if (srcFourcc == VA_FOURCC_NV12)
+        return isPlanar420(destFourcc) || destFourcc == VA_FOURCC_RGBX || destFourcc == VA_FOURCC_BGRX;
+    if (destFourcc == VA_FOURCC_NV12)
+        return isPlanar420(srcFourcc) || srcFourcc == VA_FOURCC_YUY2 || srcFourcc == VA_FOURCC_UYVY;
+    return false;
+}
+
+static bool copyFrame(const Planes& dest, const Planes& src, const VideoFrameRawData* frame)
+{
+    uint32_t width[3];
+    uint32_t height[3];
+    uint32_t planes;
+    if (!getPlaneResolution(frame->fourcc, frame->width, frame->height, width, height, planes))
+        return false;
+    for (uint32_t i = 0; i < planes; i++)
+        copyPlane(dest.data[i], dest.pitch[i], src.data[i], src.pitch[i], width[i], height[i]);
+    return true;
+}
+
+bool convertFrame(VideoFrameRawData* dest, const VideoFrameRawData* src, ColorMatrix matrix)
+{
+    const ConvertKernels& kernels = getKernels();
+    uint32_t srcFourcc = src->fourcc;
+    uint32_t destFourcc = dest->fourcc;
+    uint32_t width = src->width;
+    uint32_t height = src->height;
+    uint32_t chromaWidth = (width + 1) >> 1;
+    uint32_t chromaHeight = (height + 1) >> 1;
+
+    if (dest->width != width || dest->height != height) {
+        ERROR("can't convert %dx%d to %dx%d", width, height, dest->width, dest->height);
+        return false;
+    }
+    if (!isConvertSupported(srcFourcc, destFourcc)) {
+        ERROR("can't convert %.4s to %.4s", (char*)&srcFourcc, (char*)&destFourcc);
+        return false;
+    }
+    Planes s, d;
+    getPlanes(s, src);
+    getPlanes(d, dest);
+
+    if (srcFourcc == destFourcc)
+        return copyFrame(d, s, src);
+
+    if (srcFourcc == VA_FOURCC_NV12 && isPlanar420(destFourcc)) {
+        int u = destFourcc == VA_FOURCC_I420 ? 1 : 2;
+        copyPlane(d.data[0], d.pitch[0], s.data[0], s.pitch[0], width, height);
+        for (uint32_t y = 0; y < chromaHeight; y++)
+            kernels.splitBytes(s.row(1, y), d.row(u, y), d.row(3 - u, y), chromaWidth);
+        return true;
+    }
+    if (isPlanar420(srcFourcc) && destFourcc == VA_FOURCC_NV12) {
+        int u = srcFourcc == VA_FOURCC_I420 ? 1 : 2;
+        copyPlane(d.data[0], d.pitch[0], s.data[0], s.pitch[0], width, height);
+        for (uint32_t y = 0; y < chromaHeight; y++)
+            kernels.mergeBytes(s.row(u, y), s.row(3 - u, y), d.row(1, y), chromaWidth);
+        return true;
+    }
+    if (srcFourcc == VA_FOURCC_NV12) {
+        const YuvToRgb* coef = matrix == COLOR_MATRIX_BT709 ? &s_bt709 : &s_bt601;
+        bool bgr = destFourcc == VA_FOURCC_BGRX;
+        for (uint32_t y = 0; y < height; y++)
+            kernels.nv12ToRGBX(s.row(0, y), s.row(1, y >> 1), d.row(0, y), width, coef, bgr);
+        return true;
+    }
+
+    //YUY2 or UYVY, the chroma of two rows is averaged
+    if (width & 1) {
+        ERROR("can't convert %.4s with odd width %d", (char*)&srcFourcc, width);
+        return false;
+    }
+    bool yuy2 = srcFourcc == VA_FOURCC_YUY2;
+    std::vector<uint8_t> chroma(width * 2);
+    uint8_t* top = &chroma[0];
+    uint8_t* bottom = top + width;
+    for (uint32_t y = 0; y < height; y += 2) {
+        uint8_t* uv = d.row(1, y >> 1);
+        if (yuy2)
+            kernels.splitBytes(s.row(0, y), d.row(0, y), top, width);
+        else
+            kernels.splitBytes(s.row(0, y), top, d.row(0, y), width);
+        if (y + 1 == height) {
+            memcpy(uv, top, width);
+            break;
+        }
+        if (yuy2)
+            kernels.splitBytes(s.row(0, y + 1), d.row(0, y + 1), bottom, width);
+        else
+            kernels.splitBytes(s.row(0, y + 1), bottom, d.row(0, y + 1), width);
+        kernels.averageBytes(top, bottom, uv, width);
+    }
+    return true;
+}
+
+};
@@ -0,0 +1,51 @@
+/*
+ *  colorconvert.h - convert raw frames between pixel formats
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+#ifndef colorconvert_h
+#define colorconvert_h
+
+#include "interface/VideoCommonDefs.h"
+
+#include <stdint.h>
+
+namespace YamiMediaCodec{
+
+typedef enum {
+    COLOR_MATRIX_BT601,
+    COLOR_MATRIX_BT709,
+} ColorMatrix;
+
+/// true if convertFrame() can convert @param srcFourcc to @param destFourcc
+bool isConvertSupported(uint32_t srcFourcc, uint32_t destFourcc);
+
+/**
+ * convert @param src to the fourcc of @param dest on the cpu.
+ * both frames are raw pointers to memory, with planes described by offset and pitch
+ * the way fillFrameRawData() lays them out, and the same width and height.
+ * supported: NV12 <-> I420/YV12, YUY2/UYVY -> NV12 and NV12 -> RGBX/BGRX,
+ * @param matrix is used for the limited range yuv to rgb conversion.
+ * same fourcc copies the planes. the rows are done with SSE2 or AVX2 when the cpu has them.
+ */
+bool convertFrame(VideoFrameRawData* dest, const VideoFrameRawData* src,
+                  ColorMatrix matrix = COLOR_MATRIX_BT601);
+
+};
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ *  planecopy.cpp - copy image planes from and to uncached memory
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "planecopy.h"
+
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define HAVE_STREAM_LOAD
+#include <smmintrin.h>
+#endif
+
+namespace YamiMediaCodec{
+
+typedef void (*CopyPlaneFunc)(uint8_t*, uint32_t, const uint8_t*, uint32_t, uint32_t, uint32_t);
+
+void copyPlaneC(uint8_t* dest, uint32_t destPitch,
+                const uint8_t* src, uint32_t srcPitch,
+                uint32_t width, uint32_t height)
+{
+    for (uint32_t i = 0; i < height; i++) {
+        memcpy(dest, src, width);
+        src += srcPitch;
+        dest += destPitch;
+    }
+}
+
+#ifdef HAVE_STREAM_LOAD
+
+enum {
+    //small enough to stay in L1
+    BOUNCE_SIZE = 4096,
+};
+
+//src is 16 bytes aligned and size is a multiple of 16
+__attribute__((target("sse4.1")))
+static void streamLoad(uint8_t* bounce, const uint8_t* src, uint32_t size)
+{
+    __m128i* s = (__m128i*)src;
+    __m128i* b = (__m128i*)bounce;
+    uint32_t i = 0;
+
+    //a full cache line at once, so the fill buffer is used up before it is dropped
+    for (; i + 4 <= size / 16; i += 4) {
+        __m128i x0 = _mm_stream_load_si128(s + i);
+        __m128i x1 = _mm_stream_load_si128(s + i + 1);
+        __m128i x2 = _mm_stream_load_si128(s + i + 2);
+        __m128i x3 = _mm_stream_load_si128(s + i + 3);
+        _mm_store_si128(b + i, x0);
+        _mm_store_si128(b + i + 1, x1);
+        _mm_store_si128(b + i + 2, x2);
+        _mm_store_si128(b + i + 3, x3);
+    }
+    for (; i < size / 16; i++)
+        _mm_store_si128(b + i, _mm_stream_load_si128(s + i));
+}
+
+__attribute__((target("sse4.1")))
+static void streamStore(uint8_t* dest, const uint8_t* bounce, uint32_t size)
+{
+    __m128i* d = (__m128i*)dest;
+    const __m128i* b = (const __m128i*)bounce;
+
+    if ((uintptr_t)dest & 15) {
+        for (uint32_t i = 0; i < size / 16; i++)
+            _mm_storeu_si128(d + i, _mm_load_si128(b + i));
+        return;
+    }
+    for (uint32_t i = 0; i < size / 16; i++)
+        _mm_stream_si128(d + i, _mm_load_si128(b + i));
+}
+
+__attribute__((target("sse4.1")))
+void copyPlaneSSE4_1(uint8_t* dest, uint32_t destPitch,
+                     const uint8_t* src, uint32_t srcPitch,
+                     uint32_t width, uint32_t height)
+{
+    uint8_t bounce[BOUNCE_SIZE] __attribute__((aligned(16)));
+
+    //order the streaming loads after earlier writes to the source
+    _mm_mfence();
+    for (uint32_t i = 0; i < height; i++) {
+        const uint8_t* s = src;
+        uint8_t* d = dest;
+        uint32_t left = width;
+
+        uint32_t head = (16 - ((uintptr_t)s & 15)) & 15;
+        if (head > left)
+            head = left;
+        memcpy(d, s, head);
+        s += head;
+        d += head;
+        left -= head;
+
+        while (left >= 16) {
+            uint32_t size = left & ~15u;
+            if (size > BOUNCE_SIZE)
+                size = BOUNCE_SIZE;
+            streamLoad(bounce, s, size);
+            streamStore(d, bounce, size);
+            s += size;
+            d += size;
+            left -= size;
+        }
+        memcpy(d, s, left);
+
+        src += srcPitch;
+        dest += destPitch;
+    }
+    //make the non-temporal stores visible to others
+    _mm_sfence();
+}
+
+#endif //HAVE_STREAM_LOAD
+
+static CopyPlaneFunc selectCopyPlane()
+{
+#ifdef HAVE_STREAM_LOAD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1"))
+        return copyPlaneSSE4_1;
+#endif
+    return copyPlaneC;
+}
+
+void copyPlane(uint8_t* dest, uint32_t destPitch,
+               const uint8_t* src, uint32_t srcPitch,
+               uint32_t width, uint32_t height)
+{
+    static const CopyPlaneFunc copy = selectCopyPlane();
+    copy(dest, destPitch, src, srcPitch, width, height);
+}
+
+};
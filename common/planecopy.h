@@ -0,0 +1,53 @@
+/*
+ *  planecopy.h - copy image planes from and to uncached memory
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+#ifndef planecopy_h
+#define planecopy_h
+
+#include <stdint.h>
+
+namespace YamiMediaCodec{
+
+/**
+ * copy @param height rows of @param width bytes.
+ * mapped VA images are usually uncached (write-combined) memory, plain loads from there are
+ * very slow. on cpus with SSE4.1, the rows are read with streaming loads (movntdqa) into a small
+ * bounce buffer which stays in the cache, and written out with non-temporal stores.
+ * other cpus fall back to memcpy per row. works on any memory, uncached or not.
+ */
+void copyPlane(uint8_t* dest, uint32_t destPitch,
+               const uint8_t* src, uint32_t srcPitch,
+               uint32_t width, uint32_t height);
+
+/// portable version of copyPlane(), always available
+void copyPlaneC(uint8_t* dest, uint32_t destPitch,
+                const uint8_t* src, uint32_t srcPitch,
+                uint32_t width, uint32_t height);
+
+#if defined(__i386__) || defined(__x86_64__)
+/// the streaming load version of copyPlane(), only call it if the cpu has SSE4.1
+void copyPlaneSSE4_1(uint8_t* dest, uint32_t destPitch,
+                     const uint8_t* src, uint32_t srcPitch,
+                     uint32_t width, uint32_t height);
+#endif
+
+};
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ *  spscring.h - single producer single consumer ring
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+#ifndef spscring_h
+#define spscring_h
+
+//TODO: remove this when we put DISALLOW_COPY_AND_ASSIGN to common/
+#include "vaapi/vaapitypes.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace YamiMediaCodec{
+
+/**
+ * \class SpscRing
+ * \brief fixed size fifo, one thread may push while another one pops without a lock
+ * <pre>
+ * push() belongs to the producer thread, front(), pop() and clear() to the consumer thread.
+ * the capacity is rounded up to a power of 2, push() fails when the ring is full.
+ *</pre>
+ */
+template <class T>
+class SpscRing
+{
+public:
+    explicit SpscRing(uint32_t capacity)
+        : m_head(0), m_tail(0)
+    {
+        uint32_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        m_items.resize(size);
+        m_mask = size - 1;
+    }
+
+    bool push(const T& item)
+    {
+        uint32_t tail = m_tail;
+        if (tail - load(m_head) > m_mask)
+            return false;
+        m_items[tail & m_mask] = item;
+        store(m_tail, tail + 1);
+        return true;
+    }
+
+    bool front(T& item) const
+    {
+        uint32_t head = m_head;
+        if (head == load(m_tail))
+            return false;
+        item = m_items[head & m_mask];
+        return true;
+    }
+
+    void pop()
+    {
+        store(m_head, m_head + 1);
+    }
+
+    void clear()
+    {
+        store(m_head, load(m_tail));
+    }
+
+    uint32_t size() const
+    {
+        return load(m_tail) - load(m_head);
+    }
+
+private:
+    //acquire and release order the item access against the index update of the other thread
+    static uint32_t load(const uint32_t& index)
+    {
+        return __atomic_load_n(&index, __ATOMIC_ACQUIRE);
+    }
+    static void store(uint32_t& index, uint32_t value)
+    {
+        __atomic_store_n(&index, value, __ATOMIC_RELEASE);
+    }
+
+    std::vector<T> m_items;
+    uint32_t m_mask;
+    uint32_t m_head;
+    uint32_t m_tail;
+    DISALLOW_COPY_AND_ASSIGN(SpscRing);
+};
+
+};
+
+#endif
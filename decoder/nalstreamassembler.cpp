@@ -0,0 +1,328 @@
+/*
+ *  nalstreamassembler.cpp - splits buffers and chunked byte streams into NAL units
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "nalstreamassembler.h"
+
+#include "codecparsers/startcode.h"
+#include <algorithm>
+
+namespace YamiMediaCodec{
+
+static const uint8_t START_CODE[] = { 0, 0, 1 };
+static const uint32_t START_CODE_SIZE = sizeof(START_CODE);
+
+// the first headSize bytes of the start code are in head, the rest in tail
+static bool isSplitStartCode(const uint8_t* head, uint32_t headSize, const uint8_t* tail)
+{
+    for (uint32_t i = 0; i < START_CODE_SIZE; i++) {
+        uint8_t b = i < headSize ? head[i] : tail[i - headSize];
+        if (b != START_CODE[i])
+            return false;
+    }
+    return true;
+}
+
+NalStreamAssembler::NalStreamAssembler()
+    : m_chunk(NULL)
+    , m_chunkSize(0)
+    , m_offset(0)
+    , m_pendingIsNal(false)
+    , m_heldNext(0)
+    , m_heldOffset(0)
+{
+}
+
+void NalStreamAssembler::push(const uint8_t* data, uint32_t size)
+{
+    while (!m_done.empty()) {
+        m_done.front().clear();
+        m_free.splice(m_free.end(), m_done, m_done.begin());
+    }
+    m_popped.clear();
+    if (m_heldNext == m_heldSizes.size()) {
+        m_held.clear();
+        m_heldSizes.clear();
+        m_heldNext = 0;
+        m_heldOffset = 0;
+    }
+    m_chunk = data;
+    m_chunkSize = size;
+    m_offset = 0;
+}
+
+bool NalStreamAssembler::pop(const uint8_t*& data, uint32_t& size)
+{
+    if (m_heldNext < m_heldSizes.size()) {
+        data = &m_held[m_heldOffset];
+        size = m_heldSizes[m_heldNext++];
+        m_heldOffset += size;
+    } else if (!popChunk(data, size)) {
+        return false;
+    }
+    m_popped.push_back(Unit(data, size));
+    return true;
+}
+
+void NalStreamAssembler::hold(const uint8_t* data)
+{
+    Buffer held;
+    std::vector<uint32_t> sizes;
+    const uint8_t* unit;
+    uint32_t size;
+    size_t i = 0;
+
+    // the rest of the chunk is not sent again
+    while (pop(unit, size))
+        ;
+    while (i < m_popped.size() && m_popped[i].first != data)
+        i++;
+    if (i == m_popped.size())
+        return;
+    for (; i < m_popped.size(); i++) {
+        held.insert(held.end(), m_popped[i].first, m_popped[i].first + m_popped[i].second);
+        sizes.push_back(m_popped[i].second);
+    }
+    m_held.swap(held);
+    m_heldSizes.swap(sizes);
+    m_heldNext = 0;
+    m_heldOffset = 0;
+    m_popped.clear();
+}
+
+bool NalStreamAssembler::popChunk(const uint8_t*& data, uint32_t& size)
+{
+    const uint8_t* chunk;
+    uint32_t left;
+    int32_t start, end;
+
+    if (!m_pending.empty()) {
+        if (popPending(data, size))
+            return true;
+        if (!m_pending.empty())
+            return false;
+    }
+
+    chunk = m_chunk + m_offset;
+    left = m_chunkSize - m_offset;
+    start = start_code_find(chunk, left);
+    if (start < 0) {
+        keepTrailingZeros(chunk, left);
+        m_offset = m_chunkSize;
+        return false;
+    }
+
+    end = start_code_find(chunk + start + START_CODE_SIZE, left - start - START_CODE_SIZE);
+    if (end < 0) {
+        m_pending.assign(chunk + start, chunk + left);
+        m_pendingIsNal = true;
+        m_offset = m_chunkSize;
+        return false;
+    }
+
+    data = chunk + start;
+    size = end + START_CODE_SIZE;
+    m_offset += start + size;
+    return true;
+}
+
+bool NalStreamAssembler::popPending(const uint8_t*& data, uint32_t& size)
+{
+    const uint8_t* chunk = m_chunk + m_offset;
+    uint32_t left = m_chunkSize - m_offset;
+    uint32_t n = m_pending.size();
+    uint32_t k, used = 0;
+    int32_t end;
+
+    // m_pending itself was searched already, only a start code split
+    // between its last two bytes and the chunk can be new
+    for (k = m_pendingIsNal ? std::max(n, START_CODE_SIZE + 2) - 2 : 0; k < n; k++) {
+        used = START_CODE_SIZE - (n - k);
+        if (used <= left && isSplitStartCode(&m_pending[k], n - k, chunk))
+            break;
+    }
+
+    if (k < n) {
+        m_pending.insert(m_pending.end(), chunk, chunk + used);
+        m_offset += used;
+        if (m_pendingIsNal) {
+            completePending(k, data, size);
+            return true;
+        }
+        m_pending.erase(m_pending.begin(), m_pending.begin() + k);
+        m_pendingIsNal = true;
+        chunk += used;
+        left -= used;
+    } else if (!m_pendingIsNal) {
+        // too few bytes to tell, the zeros may still start a start code
+        if (left < START_CODE_SIZE - 1) {
+            keepTrailingZeros(chunk, left);
+            m_offset = m_chunkSize;
+        } else {
+            m_pending.clear();
+        }
+        return false;
+    }
+
+    end = start_code_find(chunk, left);
+    if (end < 0) {
+        m_pending.insert(m_pending.end(), chunk, chunk + left);
+        m_offset = m_chunkSize;
+        return false;
+    }
+    m_pending.insert(m_pending.end(), chunk, chunk + end);
+    m_offset += end;
+    completePending(m_pending.size(), data, size);
+    return true;
+}
+
+// hands out the first unitSize bytes of m_pending, the rest stays pending
+void NalStreamAssembler::completePending(uint32_t unitSize, const uint8_t*& data, uint32_t& size)
+{
+    if (m_free.empty())
+        m_free.push_back(Buffer());
+    m_done.splice(m_done.end(), m_free, m_free.begin());
+
+    Buffer& unit = m_done.back();
+    unit.swap(m_pending);
+    m_pending.assign(unit.begin() + unitSize, unit.end());
+    m_pendingIsNal = !m_pending.empty();
+    unit.resize(unitSize);
+
+    data = &unit[0];
+    size = unitSize;
+}
+
+// a start code may begin in the last two bytes of the chunk
+void NalStreamAssembler::keepTrailingZeros(const uint8_t* data, uint32_t size)
+{
+    uint32_t zeros = 0;
+
+    m_pending.insert(m_pending.end(), data, data + size);
+    while (zeros < m_pending.size() && zeros < START_CODE_SIZE - 1
+           && !m_pending[m_pending.size() - 1 - zeros])
+        zeros++;
+    m_pending.erase(m_pending.begin(), m_pending.end() - zeros);
+    m_pendingIsNal = false;
+}
+
+bool NalStreamAssembler::flush(const uint8_t*& data, uint32_t& size)
+{
+    if (pop(data, size))
+        return true;
+    if (!m_pendingIsNal || m_pending.size() <= START_CODE_SIZE) {
+        m_pending.clear();
+        m_pendingIsNal = false;
+        return false;
+    }
+    completePending(m_pending.size(), data, size);
+    m_pendingIsNal = false;
+    return true;
+}
+
+void NalStreamAssembler::reset()
+{
+    while (!m_done.empty()) {
+        m_done.front().clear();
+        m_free.splice(m_free.end(), m_done, m_done.begin());
+    }
+    m_pending.clear();
+    m_pendingIsNal = false;
+    m_popped.clear();
+    m_held.clear();
+    m_heldSizes.clear();
+    m_heldNext = 0;
+    m_heldOffset = 0;
+    m_chunk = NULL;
+    m_chunkSize = 0;
+    m_offset = 0;
+}
+
+void NalUnitSplitter::addUnit(const uint8_t* data, uint32_t size)
+{
+    Unit unit = { data, size };
+    m_units.push_back(unit);
+}
+
+void NalUnitSplitter::split(const VideoDecodeBuffer* buffer, uint32_t nalLengthSize)
+{
+    const uint8_t* buf = buffer->data;
+    uint32_t size = buffer->size;
+    uint32_t i, unitSize;
+    int32_t ofs;
+
+    m_units.clear();
+    if (buffer->flag & IS_STREAM_CHUNK) {
+        m_stream.push(buffer->data, buffer->size);
+        while (m_stream.pop(buf, unitSize))
+            addUnit(buf, unitSize);
+        return;
+    }
+
+    if (nalLengthSize) {
+        while (size >= nalLengthSize) {
+            unitSize = 0;
+            for (i = 0; i < nalLengthSize; i++)
+                unitSize = (unitSize << 8) | buf[i];
+            unitSize += nalLengthSize;
+            if (size < unitSize)
+                break;
+            addUnit(buf, unitSize);
+            buf += unitSize;
+            size -= unitSize;
+        }
+        return;
+    }
+
+    if (size < 4)
+        return;
+    if (buffer->flag & IS_NAL_UNIT) {
+        addUnit(buf, size);
+        return;
+    }
+    while (size >= 4) {
+        /* skip the un-used bit before start code */
+        ofs = start_code_find(buf, size);
+        if (ofs < 0)
+            break;
+        buf += ofs;
+        size -= ofs;
+
+        /* find the length of the nal */
+        ofs = (size < 7) ? -1 : start_code_find(buf + 3, size - 6);
+        if (ofs < 0)
+            ofs = size - 3;
+        unitSize = ofs + 3;
+        addUnit(buf, unitSize);
+        buf += unitSize;
+        size -= unitSize;
+    }
+}
+
+void NalUnitSplitter::reset()
+{
+    m_units.clear();
+    m_stream.reset();
+}
+
+};
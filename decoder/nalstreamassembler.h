@@ -0,0 +1,137 @@
+/*
+ *  nalstreamassembler.h - splits buffers and chunked byte streams into NAL units
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef nalstreamassembler_h
+#define nalstreamassembler_h
+
+#include "interface/VideoDecoderDefs.h"
+#include <list>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace YamiMediaCodec{
+
+/**
+ * \class NalStreamAssembler
+ * \brief splits an annex B byte stream fed in arbitrary chunks into NAL units
+ * <pre>
+ * 1. a NAL unit lying completely inside the chunk is returned in place, without any copy.
+ * 2. only a NAL unit spanning chunks is copied, once, into an internal buffer.
+ *    the buffers are recycled, so a steady stream does not allocate.
+ * 3. every unit starts with its 00 00 01 start code, like the units split from a whole buffer.
+ * 4. units returned by pop() stay valid until the next push(), flush() or reset().
+ * 5. when the decoder stops at a unit, e.g. on DECODE_FORMAT_CHANGE, hold() keeps that unit
+ *    and the ones popped after it, together with the rest of the chunk. pop() returns them
+ *    again after the next push(), before the units of the new chunk.
+ *</pre>
+*/
+class NalStreamAssembler
+{
+public:
+    NalStreamAssembler();
+    /// queue the next chunk, the previous one must be drained by pop() first
+    void push(const uint8_t* data, uint32_t size);
+    /// get next complete NAL unit, false if the chunk is drained
+    bool pop(const uint8_t*& data, uint32_t& size);
+    /// @param data, returned by pop() since the last push(), and the units after it were not used
+    void hold(const uint8_t* data);
+    /// get the held units, then the incomplete NAL unit left at the end of the stream.
+    /// call it until it returns false
+    bool flush(const uint8_t*& data, uint32_t& size);
+    /// drop everything queued
+    void reset();
+
+private:
+    typedef std::vector<uint8_t> Buffer;
+    typedef std::pair<const uint8_t*, uint32_t> Unit;
+
+    bool popChunk(const uint8_t*& data, uint32_t& size);
+    bool popPending(const uint8_t*& data, uint32_t& size);
+    void completePending(uint32_t size, const uint8_t*& data, uint32_t& outSize);
+    void keepTrailingZeros(const uint8_t* data, uint32_t size);
+
+    const uint8_t* m_chunk;
+    uint32_t m_chunkSize;
+    uint32_t m_offset;
+
+    // beginning of a NAL unit spanning chunks, or the zero bytes of a
+    // start code split between chunks when m_pendingIsNal is false
+    Buffer m_pending;
+    bool m_pendingIsNal;
+    // units handed out from m_pending, recycled on next push()
+    std::list<Buffer> m_done;
+    std::list<Buffer> m_free;
+
+    // units popped since push(), for hold()
+    std::vector<Unit> m_popped;
+    // held units, m_heldSizes[m_heldNext] is the next one to pop
+    Buffer m_held;
+    std::vector<uint32_t> m_heldSizes;
+    uint32_t m_heldNext;
+    uint32_t m_heldOffset;
+    DISALLOW_COPY_AND_ASSIGN(NalStreamAssembler);
+};
+
+/**
+ * \class NalUnitSplitter
+ * \brief splits the buffers given to the h264 and h265 decoders into NAL units
+ * <pre>
+ * 1. with a nalLengthSize, the buffer holds length prefixed units (avcC, hvcC),
+ *    each unit is returned with its prefix.
+ * 2. an IS_NAL_UNIT buffer is a single annex B unit.
+ * 3. other buffers are annex B, units start with their start code and are found
+ *    in one tight pass of start_code_find().
+ * 4. IS_STREAM_CHUNK buffers go through a NalStreamAssembler, nalLengthSize must be 0.
+ * 5. units point into the buffer or the assembler and stay valid until the next split(),
+ *    flush() or reset(). the decoder identifies them with its own parser.
+ *</pre>
+*/
+class NalUnitSplitter
+{
+public:
+    struct Unit {
+        const uint8_t* data;
+        uint32_t size;
+    };
+
+    NalUnitSplitter() {}
+    /// replace units() with the NAL units of @param buffer
+    void split(const VideoDecodeBuffer* buffer, uint32_t nalLengthSize);
+    const std::vector<Unit>& units() const { return m_units; }
+    /// see NalStreamAssembler::hold()
+    void hold(const uint8_t* data) { m_stream.hold(data); }
+    /// see NalStreamAssembler::flush()
+    bool flush(const uint8_t*& data, uint32_t& size) { return m_stream.flush(data, size); }
+    void reset();
+
+private:
+    void addUnit(const uint8_t* data, uint32_t size);
+
+    std::vector<Unit> m_units;
+    // NAL units carried over between IS_STREAM_CHUNK buffers
+    NalStreamAssembler m_stream;
+    DISALLOW_COPY_AND_ASSIGN(NalUnitSplitter);
+};
+
+};
+
+#endif
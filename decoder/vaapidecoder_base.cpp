@@ -50,7 +50,8 @@ m_renderTarget(NULL),
 m_lastReference(NULL),
 m_forwardReference(NULL),
 m_VAStarted(false),
-m_currentPTS(INVALID_PTS), m_enableNativeBuffersFlag(false)
+m_currentPTS(INVALID_PTS), m_enableNativeBuffersFlag(false),
+m_renderedPictures(0), m_vaCalls(0)
 {
     INFO("base: construct()");
     m_externalDisplay.handle = 0,
@@ -75,7 +76,13 @@ PicturePtr VaapiDecoderBase::createPicture(int64_t timeStamp /* , VaapiPictureSt
         return picture;
     }
 
-    picture.reset(new VaapiDecPicture(m_context, surface, timeStamp));
+    return createPicture(surface, timeStamp);
+}
+
+PicturePtr VaapiDecoderBase::createPicture(const SurfacePtr& surface, int64_t timeStamp)
+{
+    PicturePtr picture(new VaapiDecPicture(m_context, surface, timeStamp));
+    picture->setPackedSlices(m_configBuffer.flag & WANT_PACKED_SLICES);
     return picture;
 }
 
@@ -218,7 +225,7 @@ const VideoRenderBuffer *VaapiDecoderBase::getOutput(bool draining)
     if (draining)
         flushOutport();
 
-    VideoRenderBuffer *buffer = m_surfacePool->getOutput();
+    VideoRenderBuffer *buffer = m_surfacePool->getOutput(draining);
 
 #ifdef __ENABLE_DEBUG__
     if (buffer) {
@@ -291,7 +298,7 @@ Decode_Status VaapiDecoderBase::getOutput(VideoFrameRawData* frame, bool drainin
     if (draining)
         flushOutport();
 
-    if (!m_surfacePool->getOutput(frame))
+    if (!m_surfacePool->getOutput(frame, draining))
         return RENDER_NO_AVAILABLE_FRAME;
 
 #ifdef __ENABLE_DEBUG__
@@ -365,21 +372,19 @@ Decode_Status
         return DECODE_SUCCESS;
     }
 
-    if (m_display != NULL) {
-        WARNING("VA is partially started.");
-        return DECODE_FAIL;
-    }
-
+    // reconfigure() keeps the display
+    if (!m_display) {
 #if __PLATFORM_BYT__
-    if (setenv("LIBVA_DRIVER_NAME", "wrapper", 1) == 0) {
-        INFO("setting LIBVA_DRIVER_NAME to wrapper for chromeos");
-    }
+        if (setenv("LIBVA_DRIVER_NAME", "wrapper", 1) == 0) {
+            INFO("setting LIBVA_DRIVER_NAME to wrapper for chromeos");
+        }
 #endif
-    m_display = VaapiDisplay::create(m_externalDisplay, profile);
+        m_display = VaapiDisplay::create(m_externalDisplay, profile);
 
-    if (!m_display) {
-        ERROR("failed to create display");
-        return DECODE_FAIL;
+        if (!m_display) {
+            ERROR("failed to create display");
+            return DECODE_FAIL;
+        }
     }
 
     VAConfigAttrib attrib;
@@ -394,7 +399,8 @@ Decode_Status
     }
 
     m_configBuffer.surfaceNumber = numSurface;
-    m_surfacePool = VaapiDecSurfacePool::create(m_display, &m_configBuffer);
+    // m_surfacePool is only set here when we come from reconfigure()
+    m_surfacePool = VaapiDecSurfacePool::create(m_display, &m_configBuffer, m_surfacePool);
     DEBUG("surface pool is created");
     if (!m_surfacePool)
         return DECODE_FAIL;
@@ -432,13 +438,45 @@ Decode_Status VaapiDecoderBase::terminateVA(void)
     INFO("base: terminate VA");
     m_surfacePool.reset();
     DEBUG("surface pool is reset");
-    m_context.reset();
+    releaseContext();
     m_display.reset();
 
     m_VAStarted = false;
     return DECODE_SUCCESS;
 }
 
+Decode_Status VaapiDecoderBase::reconfigure(VideoConfigBuffer * buffer)
+{
+    INFO("base: reconfigure()");
+    // setupVA() keeps the display and hands the old surface pool to the new one.
+    // not the virtual start(), vp8 and vp9 only take the config there and create no context
+    releaseContext();
+    m_VAStarted = false;
+    return VaapiDecoderBase::start(buffer);
+}
+
+void VaapiDecoderBase::releaseContext()
+{
+    if (m_context) {
+        uint32_t pictures = m_context->getRenderedPictures();
+        uint32_t vaCalls = m_context->getVaCalls();
+        INFO("base: %d pictures rendered in %d va calls", pictures, vaCalls);
+        m_renderedPictures += pictures;
+        m_vaCalls += vaCalls;
+    }
+    m_context.reset();
+}
+
+void VaapiDecoderBase::getRenderStatistics(uint32_t& renderedPictures, uint32_t& vaCalls) const
+{
+    renderedPictures = m_renderedPictures;
+    vaCalls = m_vaCalls;
+    if (m_context) {
+        renderedPictures += m_context->getRenderedPictures();
+        vaCalls += m_context->getVaCalls();
+    }
+}
+
 void VaapiDecoderBase::setNativeDisplay(NativeDisplay * nativeDisplay)
 {
     if (!nativeDisplay || nativeDisplay->type == NATIVE_DISPLAY_AUTO)
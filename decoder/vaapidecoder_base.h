@@ -78,11 +78,23 @@ class VaapiDecoderBase:public IVideoDecoder {
 
     //do not use this, we will remove this in near future
     virtual VADisplay getDisplayID();
+
+    /// pictures sent to the driver since construction and the va calls it took,
+    /// begin and end picture included, over all contexts of this decoder
+    void getRenderStatistics(uint32_t& renderedPictures, uint32_t& vaCalls) const;
   protected:
     Decode_Status setupVA(uint32_t numSurface, VAProfile profile);
     Decode_Status terminateVA(void);
+    /// the stream changed its size or needs more surfaces: recreates the context, but
+    /// keeps the display and moves the surfaces which are big enough to the new pool.
+    /// frames the client still holds go back to the old pool, it lives until they are all back.
+    Decode_Status reconfigure(VideoConfigBuffer * buffer);
     Decode_Status updateReference(void);
+    /// adds the counts of m_context to the totals before it goes away
+    void releaseContext();
     Decode_Status outputPicture(const PicturePtr& picture);
+    /// a picture decoding into @param surface, such as the second field of a frame
+    PicturePtr createPicture(const SurfacePtr& surface, int64_t timeStamp);
     SurfacePtr createSurface();
 
     NativeDisplay   m_externalDisplay;
@@ -116,11 +128,15 @@ class VaapiDecoderBase:public IVideoDecoder {
      */
     //VideoSurfaceBuffer *outputList;
     uint64_t m_currentPTS;
+    // WANT_LOW_DELAY, output pictures as early as output order allows
+    bool m_lowDelay;
 
   private:
-    bool m_lowDelay;
     bool m_rawOutput;
     bool m_enableNativeBuffersFlag;
+    // counts of the contexts released so far, see getRenderStatistics()
+    uint32_t m_renderedPictures;
+    uint32_t m_vaCalls;
 #ifdef __ENABLE_DEBUG__
     int renderPictureCount;
 #endif
@@ -152,40 +152,33 @@ fillIqMatrix8x8(VAIQMatrixBufferH264 *iq_matrix, const H264PPS *pps)
     }
 }
 
-static inline int32_t
-scanForStartCode(const uint8_t * data,
-                 uint32_t offset, uint32_t size, uint32_t * scp)
+VaapiFrameStore::VaapiFrameStore()
+    : m_structure(0)
+    , m_numBuffers(0)
+    , m_outputNeeded(0)
+    , m_usage(0)
 {
-/*
-    ByteReader br;
-    byte_reader_init(&br, data, size);
-    return byte_reader_masked_scan_uint32(&br, 0xffffff00, 0x00000100, 0, size) - 1;
-*/
-    uint32_t i;
-    const uint8_t *buf;
-
-    if (offset + 3 > size)
-        return -1;
-
-    for (i = 0; i < size - offset - 3 + 1; i++) {
-        buf = data + offset + i;
-        if (buf[0] == 0 && buf[1] == 0 && buf[2] == 1)
-            return i;
-    }
+}
 
-    return -1;
+VaapiFrameStore::~VaapiFrameStore()
+{
 }
 
-VaapiFrameStore::VaapiFrameStore(const PicturePtr& pic)
+void VaapiFrameStore::init(const PicturePtr& pic)
 {
     m_structure = pic->m_structure;
     m_buffers[0] = pic;
+    m_buffers[1].reset();
     m_numBuffers = 1;
     m_outputNeeded = pic->m_outputNeeded;
 }
 
-VaapiFrameStore::~VaapiFrameStore()
+void VaapiFrameStore::clear()
 {
+    m_buffers[0].reset();
+    m_buffers[1].reset();
+    m_numBuffers = 0;
+    m_outputNeeded = 0;
 }
 
 bool
@@ -247,6 +240,18 @@ bool VaapiFrameStore::splitFields()
     return true;
 }
 
+void VaapiFrameStore::use(uint32_t usage)
+{
+    m_usage |= usage;
+}
+
+void VaapiFrameStore::unuse(uint32_t usage)
+{
+    m_usage &= ~usage;
+    if (!m_usage)
+        clear();
+}
+
 bool VaapiFrameStore::hasFrame()
 {
     return m_structure == VAAPI_PICTURE_STRUCTURE_FRAME;
@@ -272,8 +277,14 @@ Decode_Status VaapiDecoderH264::decodeSPS(H264NalUnit * nalu)
 
     DEBUG("H264: decode SPS");
 
+    if (h264_parser_is_repeated_sps(m_parser.get(), nalu)) {
+        DEBUG("H264: SPS unchanged");
+        m_gotSPS = true;
+        return DECODE_SUCCESS;
+    }
+
     memset(sps, 0, sizeof(*sps));
-    result = h264_parser_parse_sps(&m_parser, nalu, sps, true);
+    result = h264_parser_parse_sps(m_parser.get(), nalu, sps, true);
     if (result != H264_PARSER_OK) {
         ERROR("parse sps failed");
         m_gotSPS = false;
@@ -281,6 +292,7 @@ Decode_Status VaapiDecoderH264::decodeSPS(H264NalUnit * nalu)
     }
 
     m_gotSPS = true;
+    m_contextPPS = NULL;
 
     return DECODE_SUCCESS;
 }
@@ -292,14 +304,22 @@ Decode_Status VaapiDecoderH264::decodePPS(H264NalUnit * nalu)
 
     DEBUG("H264: decode PPS");
 
+    if (h264_parser_is_repeated_pps(m_parser.get(), nalu)) {
+        DEBUG("H264: PPS unchanged");
+        m_gotPPS = true;
+        return DECODE_SUCCESS;
+    }
+
+    h264_pps_clear(pps);
     memset(pps, 0, sizeof(*pps));
-    result = h264_parser_parse_pps(&m_parser, nalu, pps);
+    result = h264_parser_parse_pps(m_parser.get(), nalu, pps);
     if (result != H264_PARSER_OK) {
         m_gotPPS = false;
         return getStatus(result);
     }
 
     m_gotPPS = true;
+    m_contextPPS = NULL;
     return DECODE_SUCCESS;
 }
 
@@ -312,7 +332,7 @@ Decode_Status VaapiDecoderH264::decodeSEI(H264NalUnit * nalu)
     DEBUG("H264: decode SEI");
 
     memset(&sei, 0, sizeof(sei));
-    result = h264_parser_parse_sei(&m_parser, nalu, &sei);
+    result = h264_parser_parse_sei(m_parser.get(), nalu, &sei);
     if (result != H264_PARSER_OK) {
         WARNING("failed to decode SEI, payload type:%d", sei.payloadType);
         return getStatus(result);
@@ -549,7 +569,7 @@ bool VaapiDecoderH264::initPicture(const PicturePtr& picture,
         DEBUG("H264: IDR frame detected");
         VAAPI_PICTURE_FLAG_SET(picture, VAAPI_PICTURE_FLAG_IDR);
         m_DPBManager->flushDPB();
-        m_prevFrame.reset();
+        setPrevFrame(NULL);
     } else if (sps->gaps_in_frame_num_value_allowed_flag)
         if (!processForGapsInFrameNum(picture, sliceHdr))
             return false;
@@ -652,7 +672,7 @@ bool VaapiDecoderH264::fillPicture(const PicturePtr& picture,
     vaapiFillPicture(&picParam->CurrPic, picture.get(), 0);
 
     for (i = 0, n = 0; i < DPBLayer->DPBCount; i++) {
-        const VaapiFrameStore::Ptr& frameStore = DPBLayer->DPB[i];
+        VaapiFrameStore* frameStore = DPBLayer->DPB[i];
         if (frameStore && frameStore->hasReference())
             vaapiFillPicture(&picParam->ReferenceFrames[n++],
                              frameStore->m_buffers[0].get(),
@@ -884,12 +904,22 @@ Decode_Status VaapiDecoderH264::ensureContext(H264PPS * pps)
     uint32_t DPBSize = 0;
     Decode_Status status;
 
+    /* nothing to check until a parameter set really changes */
+    if (pps == m_contextPPS && m_hasContext && m_DPBManager)
+        return DECODE_SUCCESS;
+
     m_progressiveSequence = sps->frame_mbs_only_flag;
 
     if (!m_DPBManager) {
         DPBSize = getMaxDecFrameBuffering(sps, 1);
-        m_DPBManager.reset(new VaapiDPBManager(this, DPBSize));
+        m_DPBManager.reset(new VaapiDPBManager(
+            std::tr1::bind(&VaapiDecoderH264::outputPicture, this,
+                           std::tr1::placeholders::_1),
+            DPBSize));
     }
+    if (m_configBuffer.flag & WANT_LOW_DELAY)
+        m_DPBManager->setMaxReorderFrames(
+            getMaxReorderFrames(sps, m_configBuffer.maxReorderFrames));
 
     parsedProfile = getH264VAProfile(pps);
     if (parsedProfile != m_configBuffer.profile) {
@@ -927,11 +957,19 @@ Decode_Status VaapiDecoderH264::ensureContext(H264PPS * pps)
         resetContext = true;
     }
 
-    if (!resetContext && m_hasContext)
+    DPBSize = getMaxDecFrameBuffering(sps, 1);
+    if (m_hasContext
+        && DPBSize + H264_EXTRA_SURFACE_NUMBER > (uint32_t)m_configBuffer.surfaceNumber) {
+        DEBUG("H264: DPB size grows to %d", DPBSize);
+        resetContext = true;
+    }
+
+    if (!resetContext && m_hasContext) {
+        m_contextPPS = pps;
         return DECODE_SUCCESS;
+    }
 
     if (!m_hasContext) {
-        DPBSize = getMaxDecFrameBuffering(sps, 1);
         m_configBuffer.surfaceNumber = DPBSize + H264_EXTRA_SURFACE_NUMBER;
         m_configBuffer.flag |= HAS_SURFACE_NUMBER;
         status = VaapiDecoderBase::start(&m_configBuffer);
@@ -942,7 +980,12 @@ Decode_Status VaapiDecoderH264::ensureContext(H264PPS * pps)
         m_resetContext = true;
     } else if (resetContext) {
         m_hasContext = false;
-        status = VaapiDecoderBase::reset(&m_configBuffer);
+        // pictures of the old size are output through the old surface pool,
+        // a pending picture still decodes to the old context it holds
+        if (m_DPBManager)
+            m_DPBManager->flushDPB();
+        m_configBuffer.surfaceNumber = DPBSize + H264_EXTRA_SURFACE_NUMBER;
+        status = VaapiDecoderBase::reconfigure(&m_configBuffer);
         if (status != DECODE_SUCCESS)
             return status;
 
@@ -954,6 +997,7 @@ Decode_Status VaapiDecoderH264::ensureContext(H264PPS * pps)
     }
 
     m_hasContext = true;
+    m_contextPPS = pps;
 
     if (resetContext)
         return DECODE_FORMAT_CHANGE;
@@ -1039,7 +1083,7 @@ bool VaapiDecoderH264::markingPicture(const PicturePtr& pic)
     if (m_prevPicHasMMCO5) {
         m_frameNum = 0;
         m_frameNumOffset = 0;
-        m_prevFrame.reset();
+        setPrevFrame(NULL);
     }
 
     m_prevPicStructure = pic->m_structure;
@@ -1047,11 +1091,20 @@ bool VaapiDecoderH264::markingPicture(const PicturePtr& pic)
     return true;
 }
 
+void VaapiDecoderH264::setPrevFrame(VaapiFrameStore* frameStore)
+{
+    if (m_prevFrame)
+        m_prevFrame->unuse(FRAME_STORE_CURRENT);
+    m_prevFrame = frameStore;
+    if (m_prevFrame)
+        m_prevFrame->use(FRAME_STORE_CURRENT);
+}
+
 bool VaapiDecoderH264::storeDecodedPicture(const PicturePtr pic)
 {
     int ret = true;
 
-    VaapiFrameStore::Ptr frameStore;
+    VaapiFrameStore* frameStore;
     // Check if picture is the second field and the first field is still in DPB
     if (m_prevFrame && !m_prevFrame->hasFrame()) {
         RETURN_VAL_IF_FAIL(m_prevFrame->m_numBuffers == 1, false);
@@ -1062,12 +1115,17 @@ bool VaapiDecoderH264::storeDecodedPicture(const PicturePtr pic)
 
         ret = m_prevFrame->addPicture(m_currentPicture);
         m_currentPicture.reset();
+        if (ret && m_lowDelay)
+            ret = m_DPBManager->bumpReorderedDPB();
         return ret;
     }
     // Create new frame store, and split fields if necessary
-    frameStore.reset(new VaapiFrameStore(pic));
+    setPrevFrame(NULL);
+    frameStore = m_DPBManager->newFrameStore(pic);
+    if (!frameStore)
+        return false;
 
-    m_prevFrame = frameStore;
+    setPrevFrame(frameStore);
     if (!m_progressiveSequence && frameStore->hasFrame()) {
         if (!frameStore->splitFields())
             return false;
@@ -1079,6 +1137,10 @@ bool VaapiDecoderH264::storeDecodedPicture(const PicturePtr pic)
     if (!m_DPBManager->addDPB(m_prevFrame, pic))
         return false;
 
+    // a first field waits for its second one
+    if (m_lowDelay && m_prevFrame->hasFrame())
+        ret = m_DPBManager->bumpReorderedDPB();
+
     return ret;
 }
 
@@ -1137,6 +1199,7 @@ Decode_Status
         if (!s)
             return DECODE_FAIL;
         picture.reset(new VaapiDecPictureH264(m_context, s, 0));
+        picture->setPackedSlices(m_configBuffer.flag & WANT_PACKED_SLICES);
         /* test code */
 
         VAAPI_PICTURE_FLAG_SET(picture, VAAPI_PICTURE_FLAG_FF);
@@ -1169,7 +1232,7 @@ Decode_Status VaapiDecoderH264::decodeSlice(H264NalUnit * nalu)
 
     /* parser the slice header info */
     memset(sliceHdr.get(), 0, sizeof(H264SliceHdr));
-    result = h264_parser_parse_slice_hdr(&m_parser, nalu,
+    result = h264_parser_parse_slice_hdr(m_parser.get(), nalu,
                                          sliceHdr.get(), true, true);
     if (result != H264_PARSER_OK) {
         status = getStatus(result);
@@ -1199,6 +1262,37 @@ Decode_Status VaapiDecoderH264::decodeSlice(H264NalUnit * nalu)
     return DECODE_SUCCESS;
 }
 
+bool VaapiDecoderH264::isSkippedSlice(H264NalUnit * nalu)
+{
+    if (m_configBuffer.flag & WANT_KEY_FRAMES_ONLY) {
+        if (nalu->type == H264_NAL_SLICE_IDR)
+            return false;
+    } else if (m_configBuffer.flag & WANT_SKIP_NON_REFERENCE) {
+        if (nalu->ref_idc)
+            return false;
+    } else
+        return false;
+
+    // the second field of a decoded first field, it may be a non-IDR or non-reference one
+    if (m_currentPicture) {
+        if (!VAAPI_PICTURE_IS_FRAME(m_currentPicture)
+            && VAAPI_PICTURE_IS_FIRST_FIELD(m_currentPicture))
+            return false;
+    } else if (m_prevFrame && !m_prevFrame->hasFrame())
+        return false;
+    return true;
+}
+
+Decode_Status VaapiDecoderH264::skipSlice(H264NalUnit * nalu)
+{
+    // first_mb_in_slice is the first ue(v) of the slice header, its leading bit is set for 0.
+    // a new picture starts there, so the pending one is complete
+    if (nalu->size > nalu->header_bytes
+        && (nalu->data[nalu->offset + nalu->header_bytes] & 0x80))
+        return decodeCurrentPicture();
+    return DECODE_SUCCESS;
+}
+
 Decode_Status VaapiDecoderH264::decodeNalu(H264NalUnit * nalu)
 {
     Decode_Status status;
@@ -1209,6 +1303,10 @@ Decode_Status VaapiDecoderH264::decodeNalu(H264NalUnit * nalu)
     case H264_NAL_SLICE:
         if (!m_gotSPS || !m_gotPPS)
             return DECODE_SUCCESS;
+        if (isSkippedSlice(nalu)) {
+            status = skipSlice(nalu);
+            break;
+        }
         status = decodeSlice(nalu);
         break;
     case H264_NAL_SPS:
@@ -1278,7 +1376,7 @@ bool VaapiDecoderH264::decodeCodecData(uint8_t * buf, uint32_t bufSize)
     ofs = 6;
 
     for (i = 0; i < numSPS; i++) {
-        result = h264_parser_identify_nalu_avc(&m_parser,
+        result = h264_parser_identify_nalu_avc(m_parser.get(),
                                                buf, ofs, bufSize, 2,
                                                &nalu);
         if (result != H264_PARSER_OK)
@@ -1294,7 +1392,7 @@ bool VaapiDecoderH264::decodeCodecData(uint8_t * buf, uint32_t bufSize)
     ofs++;
 
     for (i = 0; i < numPPS; i++) {
-        result = h264_parser_identify_nalu_avc(&m_parser,
+        result = h264_parser_identify_nalu_avc(m_parser.get(),
                                                buf, ofs, bufSize, 2,
                                                &nalu);
         if (result != H264_PARSER_OK)
@@ -1334,15 +1432,17 @@ void VaapiDecoderH264::updateFrameInfo()
 }
 
 
-Decode_Status VaapiDecoderH264::outputPicture(PicturePtr& picture)
+bool VaapiDecoderH264::outputPicture(const PicturePtr& picture)
 {
     VaapiDecoderBase::PicturePtr base = std::tr1::static_pointer_cast<VaapiDecPicture>(picture);
-    return VaapiDecoderBase::outputPicture(base);
+    return VaapiDecoderBase::outputPicture(base) == DECODE_SUCCESS;
 }
 
 VaapiDecoderH264::VaapiDecoderH264()
+    : m_prevFrame(NULL)
 {
-    memset((void *) &m_parser, 0, sizeof(H264NalParser));
+    m_parser.reset(h264_nal_parser_new(), h264_nal_parser_free);
+    m_contextPPS = NULL;
     memset((void *) &m_lastSPS, 0, sizeof(H264SPS));
     memset((void *) &m_lastPPS, 0, sizeof(H264PPS));
 
@@ -1367,6 +1467,7 @@ VaapiDecoderH264::VaapiDecoderH264()
 VaapiDecoderH264::~VaapiDecoderH264()
 {
     stop();
+    h264_pps_clear(&m_lastPPS);
 }
 
 Decode_Status VaapiDecoderH264::start(VideoConfigBuffer * buffer)
@@ -1375,6 +1476,11 @@ Decode_Status VaapiDecoderH264::start(VideoConfigBuffer * buffer)
     Decode_Status status;
     bool gotConfig = false;
 
+    // keep the client flags for the context created on the first sps
+    m_configBuffer = *buffer;
+    m_configBuffer.data = NULL;
+    m_configBuffer.size = 0;
+
     if (buffer->data == NULL || buffer->size == 0) {
         gotConfig = false;
         if ((buffer->flag & HAS_SURFACE_NUMBER)
@@ -1402,11 +1508,14 @@ Decode_Status VaapiDecoderH264::start(VideoConfigBuffer * buffer)
 Decode_Status VaapiDecoderH264::reset(VideoConfigBuffer * buffer)
 {
     DEBUG("H264: reset()");
+    // before clearDPB(), so the frame store goes back with the others
+    setPrevFrame(NULL);
     if (m_DPBManager)
         m_DPBManager->clearDPB();
 
-    m_prevFrame.reset();
     m_currentPicture.reset();
+    m_contextPPS = NULL;
+    m_splitter.reset();
     return VaapiDecoderBase::reset(buffer);
 }
 
@@ -1415,12 +1524,15 @@ void VaapiDecoderH264::stop(void)
     DEBUG("H264: stop()");
     flush();
     //release all pictures before we release surface pool
-    m_prevFrame.reset();
+    setPrevFrame(NULL);
     m_currentPicture.reset();
+    // the frame stores and their pictures go with the dpb manager
+    m_DPBManager.reset();
 
     VaapiDecoderBase::stop();
 
-    m_DPBManager.reset();
+    m_contextPPS = NULL;
+    m_splitter.reset();
 }
 
 void VaapiDecoderH264::flush(void)
@@ -1434,92 +1546,83 @@ void VaapiDecoderH264::flush(void)
     VaapiDecoderBase::flush();
 }
 
-Decode_Status VaapiDecoderH264::decode(VideoDecodeBuffer * buffer)
+/* the last NAL unit of a chunked stream only ends with the stream,
+ * units held on a format change which was not followed by a resend go first */
+void VaapiDecoderH264::decodeStreamTail()
+{
+    H264NalUnit nalu;
+    const uint8_t *data;
+    uint32_t size;
+
+    while (m_splitter.flush(data, size)) {
+        if (h264_parser_identify_nalu_unchecked(m_parser.get(), data, 0, size,
+                                                &nalu) == H264_PARSER_OK)
+            decodeNalu(&nalu);
+    }
+}
+
+/* split the whole buffer into NAL units before decoding any of them, so
+ * the start code search runs in one tight pass over the data */
+Decode_Status VaapiDecoderH264::indexNalUnits(VideoDecodeBuffer * buffer)
 {
     Decode_Status status = DECODE_SUCCESS;
     H264ParserResult result;
     H264NalUnit nalu;
+    uint32_t nalLengthSize = 0;
+    size_t i;
+
+    if (!(buffer->flag & IS_STREAM_CHUNK) && (m_isAVC || buffer->flag & IS_AVCC))
+        nalLengthSize = m_nalLengthSize;
+    m_splitter.split(buffer, nalLengthSize);
+
+    const std::vector<NalUnitSplitter::Unit>& units = m_splitter.units();
+    m_nalIndex.clear();
+    for (i = 0; i < units.size(); i++) {
+        if (nalLengthSize)
+            result = h264_parser_identify_nalu_avc(m_parser.get(),
+                                                   units[i].data, 0, units[i].size,
+                                                   nalLengthSize, &nalu);
+        else
+            result = h264_parser_identify_nalu_unchecked(m_parser.get(),
+                                                         units[i].data, 0, units[i].size,
+                                                         &nalu);
+        status = getStatus(result);
+        if (status != DECODE_SUCCESS) {
+            ERROR("parser nalu uncheck failed code =%d", status);
+            break;
+        }
+        m_nalIndex.push_back(nalu);
+    }
+    return status;
+}
 
-    uint8_t *buf;
-    uint32_t bufSize = 0;
-    uint32_t i, naluSize, size;
-    int32_t ofs = 0;
-    uint32_t startCode;
+Decode_Status VaapiDecoderH264::decode(VideoDecodeBuffer * buffer)
+{
+    Decode_Status status, indexStatus;
     bool isEOS = false;
+    size_t i;
 
     m_currentPTS = buffer->timeStamp;
-    buf = buffer->data;
-    size = buffer->size;
 
-    DEBUG("H264: Decode(bufsize =%d, timestamp=%ld)", size, m_currentPTS);
-    if (buf == NULL && size == 0) { // got EOS
+    DEBUG("H264: Decode(bufsize =%d, timestamp=%ld)", buffer->size, m_currentPTS);
+    if (buffer->data == NULL && buffer->size == 0) { // got EOS
+        decodeStreamTail();
         INFO("flush-debug got EOS, set all frames output-able");
         flushOutport();
         return DECODE_SUCCESS;
     }
 
-    do {
-        if (m_isAVC || buffer->flag & IS_AVCC) {
-            if (size < m_nalLengthSize)
-                break;
-
-            naluSize = 0;
-            for (i = 0; i < m_nalLengthSize; i++)
-                naluSize = (naluSize << 8) | buf[i];
-
-            bufSize = m_nalLengthSize + naluSize;
-            if (size < bufSize)
-                break;
-
-            result = h264_parser_identify_nalu_avc(&m_parser,
-                                                   buf, 0, bufSize,
-                                                   m_nalLengthSize, &nalu);
-
-            size -= bufSize;
-            buf += bufSize;
-
-        } else {
-            if (size < 4)
-                break;
-
-            if (buffer->flag & IS_NAL_UNIT) {
-                bufSize = buffer->size;
-                size = 0;
-            } else {
-                /* skip the un-used bit before start code */
-                ofs = scanForStartCode(buf, 0, size, &startCode);
-                if (ofs < 0)
-                    break;
-
-                buf += ofs;
-                size -= ofs;
-
-                /* find the length of the nal */
-                ofs =
-                    (size < 7) ? -1 : scanForStartCode(buf, 3, size - 3, NULL);
-                if (ofs < 0) {
-                    ofs = size - 3;
-                }
-
-                bufSize = ofs + 3;
-                size -= (ofs + 3);
-            }
-
-            result = h264_parser_identify_nalu_unchecked(&m_parser,
-                                                         buf, 0, bufSize,
-                                                         &nalu);
-
-            buf += bufSize;
-        }
-
-        status = getStatus(result);
-        if (status == DECODE_SUCCESS) {
-            status = decodeNalu(&nalu);
-        } else {
-            ERROR("parser nalu uncheck failed code =%d", status);
-        }
-
-    } while (status == DECODE_SUCCESS);
+    /* NAL units in front of a broken one are still decoded */
+    indexStatus = indexNalUnits(buffer);
+
+    status = DECODE_SUCCESS;
+    for (i = 0; i < m_nalIndex.size() && status == DECODE_SUCCESS; i++)
+        status = decodeNalu(&m_nalIndex[i]);
+    // the chunk is not sent again, we go on from the unit which changed the format
+    if (status == DECODE_FORMAT_CHANGE && (buffer->flag & IS_STREAM_CHUNK))
+        m_splitter.hold(m_nalIndex[i - 1].data);
+    if (status == DECODE_SUCCESS)
+        status = indexStatus;
 
     if (isEOS && status == DECODE_SUCCESS)
         status = decodeSequenceEnd();
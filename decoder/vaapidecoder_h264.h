@@ -25,10 +25,13 @@
 #define vaapidecoder_h264_h
 
 #include "codecparsers/h264parser.h"
+#include "nalstreamassembler.h"
 #include "vaapidecoder_base.h"
 #include "vaapidecpicture.h"
 #include <limits>
 #include <list>
+#include <tr1/functional>
+#include <vector>
 
 //#define MAX_VIEW_NUM 2
 namespace YamiMediaCodec{
@@ -76,8 +79,7 @@ class VaapiDecPictureH264 : public VaapiDecPicture
 
     virtual ~VaapiDecPictureH264() {}
 
-  private:
-    //make this public after we move this to cpp.
+    // public for tests/h264dpbbench.cpp, which drives the DPB without a context
     VaapiDecPictureH264(ContextPtr context, const SurfacePtr& surface, int64_t timeStamp):
         VaapiDecPicture(context, surface, timeStamp),
         m_pps(NULL),
@@ -97,12 +99,14 @@ class VaapiDecPictureH264 : public VaapiDecPicture
         m_fieldPoc[1] = INVALID_POC;
     }
 
+  private:
     PicturePtr newField()
     {
         PicturePtr field(new VaapiDecPictureH264(m_context, m_surface, m_timeStamp));
         if (!field)
             return field;
         field->m_frameNum = m_frameNum;
+        field->setPackedSlices(isPackedSlices());
         return field;
     }
 
@@ -142,21 +146,34 @@ class VaapiDecPictureH264 : public VaapiDecPicture
     std::list<SliceHeaderPtr> m_headers;
 };
 
+/* what a frame store slot is used for, the slot is free when none is set */
+enum {
+    FRAME_STORE_IN_DPB = 0x01,      // in VaapiDecPicBufLayer::DPB[]
+    FRAME_STORE_WAIT_OUTPUT = 0x02, // non-reference field waiting for its pair before output
+    FRAME_STORE_CURRENT = 0x04,     // VaapiDecoderH264::m_prevFrame, may wait for a second field
+};
+
 class VaapiFrameStore {
     typedef VaapiDecPictureH264::PicturePtr PicturePtr;
   public:
-    typedef SharedPtr<VaapiFrameStore> Ptr;
-    VaapiFrameStore(const PicturePtr& pic);
+    VaapiFrameStore();
     ~VaapiFrameStore();
+    // frame stores are slots of VaapiDPBManager, handed out by newFrameStore()
+    void init(const PicturePtr& pic);
+    void clear();
     bool addPicture(const PicturePtr& pic);
     bool splitFields();
     bool hasFrame();
     bool hasReference();
+    void use(uint32_t usage);
+    // the pictures are released once the last usage is gone
+    void unuse(uint32_t usage);
 
     uint32_t m_structure;
     PicturePtr  m_buffers[2];
     uint32_t m_numBuffers;
     uint32_t m_outputNeeded;
+    uint32_t m_usage;
 
   private:
     DISALLOW_COPY_AND_ASSIGN(VaapiFrameStore);
@@ -166,10 +183,10 @@ struct VaapiDecPicBufLayer {
     typedef SharedPtr<VaapiDecPicBufLayer> Ptr;
     VaapiDecPicBufLayer(uint32_t size)
     {
-        memset(&DPBCount, 0, sizeof(*this) - offsetof(VaapiDecPicBufLayer, DPBCount));
+        memset(DPB, 0, sizeof(*this) - offsetof(VaapiDecPicBufLayer, DPB));
         DPBSize = size;
     }
-    VaapiFrameStore::Ptr DPB[16];
+    VaapiFrameStore* DPB[16];
     uint32_t DPBCount;
     uint32_t DPBSize;
     VaapiDecPictureH264 *shortRef[32];
@@ -192,17 +209,21 @@ class VaapiDPBManager {
     typedef SharedPtr<VaapiDPBManager> Ptr;
     typedef VaapiDecPictureH264::PicturePtr PicturePtr;
     typedef VaapiDecPictureH264::SliceHeaderPtr SliceHeaderPtr;
-    VaapiDPBManager(VaapiDecoderH264* decoder, uint32_t DPBSize);
+    typedef std::tr1::function<bool (const PicturePtr&)> OutputCallback;
+    VaapiDPBManager(const OutputCallback& output, uint32_t DPBSize);
     ~VaapiDPBManager();
 
     /* Decode Picture Buffer operations */
-    bool outputDPB(const VaapiFrameStore::Ptr &frameStore, const PicturePtr& pic);
+    bool outputDPB(VaapiFrameStore* frameStore, const PicturePtr& pic);
     void evictDPB(uint32_t i);
     bool bumpDPB();
+    bool bumpReorderedDPB();
+    void setMaxReorderFrames(uint32_t num);
     void clearDPB();
     void drainDPB();
     void flushDPB();
-    bool addDPB(const VaapiFrameStore::Ptr &newFrameStore, const PicturePtr& pic);
+    VaapiFrameStore* newFrameStore(const PicturePtr& pic);
+    bool addDPB(VaapiFrameStore* newFrameStore, const PicturePtr& pic);
     void resetDPB(H264SPS * sps);
     /* initialize and reorder reference list */
     void initPictureRefs(const PicturePtr& pic,
@@ -265,10 +286,14 @@ class VaapiDPBManager {
 
  public:
     VaapiDecPicBufLayer::Ptr DPBLayer;
-    VaapiFrameStore::Ptr m_prevFrameStore; // in case a non-ref B frame to be rendered immediate after decoding, but wait for the completion of the frame (both top and bottom field is ready)
+    VaapiFrameStore* m_prevFrameStore; // in case a non-ref B frame to be rendered immediate after decoding, but wait for the completion of the frame (both top and bottom field is ready)
 
  private:
-    VaapiDecoderH264* m_decoder;
+    OutputCallback m_output;
+    // frames allowed to wait for output in low delay mode
+    uint32_t m_maxReorderFrames;
+    // a full DPB, the frame waiting for output and the one being stored
+    VaapiFrameStore m_frameStores[16 + 2];
     DISALLOW_COPY_AND_ASSIGN(VaapiDPBManager);
 };
 
@@ -286,10 +311,10 @@ class VaapiDecoderH264:public VaapiDecoderBase {
     virtual void flushOutport(void);
 
     //FIXME: make this private
-    Decode_Status outputPicture(PicturePtr& picture);
+    bool outputPicture(const PicturePtr& picture);
 
   public:
-    VaapiFrameStore::Ptr m_prevFrame;
+    VaapiFrameStore* m_prevFrame;
     int32_t m_frameNum;         // frame_num (from slice_header())
     int32_t m_prevFrameNum;     // prevFrameNum
     bool m_prevPicHasMMCO5;     // prevMMCO5Pic
@@ -336,12 +361,18 @@ class VaapiDecoderH264:public VaapiDecoderBase {
     bool isNewPicture(H264NalUnit * nalu, const SliceHeaderPtr&);
 
     bool markingPicture(const PicturePtr& pic);
+    void setPrevFrame(VaapiFrameStore* frameStore);
     bool storeDecodedPicture(const PicturePtr pic);
     Decode_Status decodeCurrentPicture();
     Decode_Status decodePicture(H264NalUnit * nalu,
                                 const SliceHeaderPtr& sliceHdr);
     Decode_Status decodeSlice(H264NalUnit * nalu);
+    // WANT_KEY_FRAMES_ONLY and WANT_SKIP_NON_REFERENCE, decided on the NAL header alone
+    bool isSkippedSlice(H264NalUnit * nalu);
+    Decode_Status skipSlice(H264NalUnit * nalu);
     Decode_Status decodeNalu(H264NalUnit * nalu);
+    Decode_Status indexNalUnits(VideoDecodeBuffer * buffer);
+    void decodeStreamTail();
     bool decodeCodecData(uint8_t * buf, uint32_t bufSize);
     void updateFrameInfo();
     bool processForGapsInFrameNum(const PicturePtr& pic,
@@ -350,7 +381,13 @@ class VaapiDecoderH264:public VaapiDecoderBase {
   private:
     PicturePtr m_currentPicture;
     VaapiDPBManager::Ptr m_DPBManager;
-    H264NalParser m_parser;
+    typedef SharedPtr<H264NalParser> ParserPtr;
+    ParserPtr m_parser;
+    // pps the context was last checked against, NULL after a parameter set changed
+    H264PPS *m_contextPPS;
+    // NAL units of the buffer being decoded, kept to reuse its storage
+    std::vector<H264NalUnit> m_nalIndex;
+    NalUnitSplitter m_splitter;
     H264SPS m_lastSPS;
     H264PPS m_lastPPS;
     uint32_t m_mbWidth;
@@ -375,6 +412,7 @@ class VaapiDecoderH264:public VaapiDecoderBase {
 };
 
 uint32_t getMaxDecFrameBuffering(H264SPS * sps, uint32_t views);
+uint32_t getMaxReorderFrames(H264SPS * sps, uint32_t defaultNum);
 
 enum {
     H264_EXTRA_SURFACE_NUMBER = 11,
@@ -26,7 +26,6 @@
 #endif
 
 #include <assert.h>
-#include <stdlib.h>
 #include "vaapidecoder_h264.h"
 
 namespace YamiMediaCodec{
@@ -48,9 +47,6 @@ typedef VaapiDecPictureH264::SliceHeaderPtr SliceHeaderPtr;
       array##Count = size;\
     }while(0);
 
-#define SORT_REF_LIST(list, n, compareFunc) \
-    qsort(list, n, sizeof(*(list)), comparePicture##compareFunc)
-
 static uint32_t roundLog2(uint32_t value)
 {
     uint32_t ret = 0;
@@ -62,53 +58,51 @@ static uint32_t roundLog2(uint32_t value)
     return ret;
 }
 
-static int comparePicturePicNumDec(const void *a, const void *b)
-{
-    const VaapiDecPictureH264 *const picA = *(VaapiDecPictureH264 **) a;
-    const VaapiDecPictureH264 *const picB = *(VaapiDecPictureH264 **) b;
-
-    return picB->m_picNum - picA->m_picNum;
-}
-
-static int comparePictureLongTermPicNumInc(const void *a, const void *b)
-{
-    const VaapiDecPictureH264 *const picA = *(VaapiDecPictureH264 **) a;
-    const VaapiDecPictureH264 *const picB = *(VaapiDecPictureH264 **) b;
-
-    return picA->m_longTermPicNum - picB->m_longTermPicNum;
-}
-
-static int comparePicturePOCDec(const void *a, const void *b)
-{
-    const VaapiDecPictureH264 *const picA = *(VaapiDecPictureH264 **) a;
-    const VaapiDecPictureH264 *const picB = *(VaapiDecPictureH264 **) b;
-
-    return picB->m_POC - picA->m_POC;
-}
-
-static int comparePicturePOCInc(const void *a, const void *b)
-{
-    const VaapiDecPictureH264 *const picA = *(VaapiDecPictureH264 **) a;
-    const VaapiDecPictureH264 *const picB = *(VaapiDecPictureH264 **) b;
-
-    return picA->m_POC - picB->m_POC;
-}
-
-static int comparePictureFrameNumWrapDec(const void *a, const void *b)
-{
-    const VaapiDecPictureH264 *const picA = *(VaapiDecPictureH264 **) a;
-    const VaapiDecPictureH264 *const picB = *(VaapiDecPictureH264 **) b;
+/* a reference list under construction, every entry is placed by insertion
+   next to the sort key it was inserted with, which spares sorting the list
+   afterwards. the lists hold 32 entries at most, so this beats qsort and
+   keeps the order of equal keys, the two fields of a frame for example */
+class RefListBuilder {
+  public:
+    RefListBuilder(VaapiDecPictureH264 ** list, uint32_t * count)
+        : m_list(list + *count), m_count(count), m_size(0) {}
+    ~RefListBuilder() { *m_count += m_size; }
+
+    void insertInc(VaapiDecPictureH264 * pic, int32_t key)
+    {
+        uint32_t i;
+        for (i = m_size; i > 0 && m_keys[i - 1] > key; i--)
+            move(i);
+        set(i, pic, key);
+    }
 
-    return picB->m_frameNumWrap - picA->m_frameNumWrap;
-}
+    void insertDec(VaapiDecPictureH264 * pic, int32_t key)
+    {
+        uint32_t i;
+        for (i = m_size; i > 0 && m_keys[i - 1] < key; i--)
+            move(i);
+        set(i, pic, key);
+    }
 
-static int comparePictureLongTermFrameIdxInc(const void *a, const void *b)
-{
-    const VaapiDecPictureH264 *const picA = *(VaapiDecPictureH264 **) a;
-    const VaapiDecPictureH264 *const picB = *(VaapiDecPictureH264 **) b;
+  private:
+    void move(uint32_t i)
+    {
+        m_list[i] = m_list[i - 1];
+        m_keys[i] = m_keys[i - 1];
+    }
+    void set(uint32_t i, VaapiDecPictureH264 * pic, int32_t key)
+    {
+        m_list[i] = pic;
+        m_keys[i] = key;
+        m_size++;
+    }
 
-    return picA->m_longTermFrameIdx - picB->m_longTermFrameIdx;
-}
+    VaapiDecPictureH264 **m_list;
+    uint32_t *m_count;
+    uint32_t m_size;
+    int32_t m_keys[REF_LIST_SIZE];
+    DISALLOW_COPY_AND_ASSIGN(RefListBuilder);
+};
 
 static void
 setH264PictureReference(VaapiDecPictureH264* picture,
@@ -235,8 +229,25 @@ uint32_t getMaxDecFrameBuffering(H264SPS * sps, uint32_t views)
     return MAX(1, maxDecFrameBuffering);
 }
 
-VaapiDPBManager::VaapiDPBManager(VaapiDecoderH264* decoder, uint32_t DPBSize)
-    :m_decoder(decoder)
+/* frames that may precede another one in output order, C.4.5.3 */
+uint32_t getMaxReorderFrames(H264SPS * sps, uint32_t defaultNum)
+{
+    // POC type 2, output order is decoding order
+    if (sps->pic_order_cnt_type == 2)
+        return 0;
+    if (sps->vui_parameters_present_flag) {
+        H264VUIParams *const vuiParams = &sps->vui_parameters;
+        if (vuiParams->bitstream_restriction_flag)
+            return MIN(vuiParams->num_reorder_frames,
+                       vuiParams->max_dec_frame_buffering);
+    }
+    return defaultNum;
+}
+
+VaapiDPBManager::VaapiDPBManager(const OutputCallback& output, uint32_t DPBSize)
+    :m_prevFrameStore(NULL)
+    ,m_output(output)
+    ,m_maxReorderFrames(DPBSize)
 {
     DPBLayer.reset(new VaapiDecPicBufLayer(DPBSize));
 }
@@ -245,7 +256,7 @@ VaapiDPBManager::~VaapiDPBManager()
 {
 }
 
-bool VaapiDPBManager::outputDPB(const VaapiFrameStore::Ptr &frameStore,
+bool VaapiDPBManager::outputDPB(VaapiFrameStore* frameStore,
                                 const PicturePtr& picture)
 {
     picture->m_outputNeeded = false;
@@ -264,12 +275,12 @@ bool VaapiDPBManager::outputDPB(const VaapiFrameStore::Ptr &frameStore,
     if (!frameStore)
         picture->m_surfBuf->status &= ~SURFACE_DECODING;
 #endif
-    return m_decoder->outputPicture(frame) == DECODE_SUCCESS;
+    return m_output(frame);
 }
 
 void VaapiDPBManager::evictDPB(uint32_t idx)
 {
-    const VaapiFrameStore::Ptr&  frameStore = DPBLayer->DPB[idx];
+    VaapiFrameStore* frameStore = DPBLayer->DPB[idx];
     if (!frameStore->m_outputNeeded && !frameStore->hasReference())
         removeDPBIndex(idx);
 }
@@ -281,7 +292,7 @@ bool VaapiDPBManager::bumpDPB()
     bool success;
 
     for (i = 0; i < DPBLayer->DPBCount; i++) {
-        const VaapiFrameStore::Ptr& frameStore = DPBLayer->DPB[i];
+        VaapiFrameStore* frameStore = DPBLayer->DPB[i];
 
         if (!frameStore->m_outputNeeded)
             continue;
@@ -303,17 +314,61 @@ bool VaapiDPBManager::bumpDPB()
     return success;
 }
 
+/* low delay output: bump until no more than m_maxReorderFrames frames wait,
+   call it with complete frames only, a single field would be output alone */
+bool VaapiDPBManager::bumpReorderedDPB()
+{
+    uint32_t i, numWaiting;
+
+    if (m_prevFrameStore && m_prevFrameStore->hasFrame()
+        && !outputImmediateBFrame())
+        return false;
+
+    while (true) {
+        numWaiting = 0;
+        for (i = 0; i < DPBLayer->DPBCount; i++) {
+            if (DPBLayer->DPB[i]->m_outputNeeded)
+                numWaiting++;
+        }
+        if (numWaiting <= m_maxReorderFrames)
+            return true;
+        if (!bumpDPB())
+            return false;
+    }
+}
+
+void VaapiDPBManager::setMaxReorderFrames(uint32_t num)
+{
+    DEBUG("DPB: max reorder frames %d", num);
+    m_maxReorderFrames = num;
+}
+
 void VaapiDPBManager::clearDPB()
 {
     uint32_t i;
     if (DPBLayer) {
         for (i = 0; i < DPBLayer->DPBCount; i++) {
-            DPBLayer->DPB[i].reset();
+            DPBLayer->DPB[i]->unuse(FRAME_STORE_IN_DPB);
+            DPBLayer->DPB[i] = NULL;
         }
         DPBLayer->DPBCount = 0;
     }
 }
 
+VaapiFrameStore* VaapiDPBManager::newFrameStore(const PicturePtr& pic)
+{
+    uint32_t i;
+
+    for (i = 0; i < N_ELEMENTS(m_frameStores); i++) {
+        if (!m_frameStores[i].m_usage) {
+            m_frameStores[i].init(pic);
+            return &m_frameStores[i];
+        }
+    }
+    ERROR("DPB: no free frame store");
+    return NULL;
+}
+
 void VaapiDPBManager::flushDPB()
 {
     drainDPB(); // it's safe for internal reset: IDR, picture-marking etc.
@@ -329,7 +384,7 @@ void VaapiDPBManager::drainDPB()
 void VaapiDPBManager::debugDPBStatus()
 {
     int i;
-    VaapiFrameStore::Ptr frameStore;
+    VaapiFrameStore* frameStore;
 
     for (i = 0; i < DPBLayer->DPBCount; i++) {
         frameStore = DPBLayer->DPB[i];
@@ -351,11 +406,11 @@ void VaapiDPBManager::debugDPBStatus()
     }
 }
 
-bool VaapiDPBManager::addDPB(const VaapiFrameStore::Ptr& newFrameStore,
+bool VaapiDPBManager::addDPB(VaapiFrameStore* newFrameStore,
                              const PicturePtr& pic)
 {
     uint32_t i, j;
-    VaapiFrameStore::Ptr frameStore;
+    VaapiFrameStore* frameStore;
 
 #ifdef __ENABLE_DEBUG__
     debugDPBStatus();
@@ -381,6 +436,7 @@ bool VaapiDPBManager::addDPB(const VaapiFrameStore::Ptr& newFrameStore,
         }
 
         DPBLayer->DPB[DPBLayer->DPBCount++] = newFrameStore;
+        newFrameStore->use(FRAME_STORE_IN_DPB);
         if (pic->m_outputFlag) {
             pic->m_outputNeeded = true;
             newFrameStore->m_outputNeeded++;
@@ -407,6 +463,7 @@ bool VaapiDPBManager::addDPB(const VaapiFrameStore::Ptr& newFrameStore,
                     ret = outputDPB(newFrameStore, pic);
                 } else {
                     m_prevFrameStore = newFrameStore;   // wait for a complete frame to render
+                    m_prevFrameStore->use(FRAME_STORE_WAIT_OUTPUT);
                 }
                 return ret;
             }
@@ -415,6 +472,7 @@ bool VaapiDPBManager::addDPB(const VaapiFrameStore::Ptr& newFrameStore,
         }
 
         DPBLayer->DPB[DPBLayer->DPBCount++] = newFrameStore;
+        newFrameStore->use(FRAME_STORE_IN_DPB);
         pic->m_outputNeeded = true;
         newFrameStore->m_outputNeeded++;
     }
@@ -424,7 +482,11 @@ bool VaapiDPBManager::addDPB(const VaapiFrameStore::Ptr& newFrameStore,
 
 void VaapiDPBManager::resetDPB(H264SPS * sps)
 {
-    m_prevFrameStore.reset();
+    if (m_prevFrameStore) {
+        m_prevFrameStore->unuse(FRAME_STORE_WAIT_OUTPUT);
+        m_prevFrameStore = NULL;
+    }
+    clearDPB();
     uint32_t size = getMaxDecFrameBuffering(sps, 1);
     DPBLayer.reset(new VaapiDecPicBufLayer(size));
 }
@@ -440,11 +502,12 @@ bool VaapiDPBManager::outputImmediateBFrame()
     int i;
     int ret = true;
 
-    if (m_prevFrameStore.get()) {
+    if (m_prevFrameStore) {
         for (i = 0; i < m_prevFrameStore->m_numBuffers; i++) {
             ret &= outputDPB(m_prevFrameStore, m_prevFrameStore->m_buffers[i]);
         }
-        m_prevFrameStore.reset();
+        m_prevFrameStore->unuse(FRAME_STORE_WAIT_OUTPUT);
+        m_prevFrameStore = NULL;
     }
 
     return ret;
@@ -568,14 +631,13 @@ bool VaapiDPBManager::execDummyPictureMarking(const PicturePtr& dummyPic,
 void VaapiDPBManager::initPictureRefLists(const PicturePtr& pic)
 {
     uint32_t i, j, shortRefCount, longRefCount;
-    VaapiFrameStore::Ptr frameStore;
     VaapiDecPictureH264 *picture;
 
     shortRefCount = 0;
     longRefCount = 0;
     if (pic->m_structure == VAAPI_PICTURE_STRUCTURE_FRAME) {
         for (i = 0; i < DPBLayer->DPBCount; i++) {
-            frameStore = DPBLayer->DPB[i];
+            VaapiFrameStore* frameStore = DPBLayer->DPB[i];
             if (!frameStore->hasFrame())
                 continue;
             picture = frameStore->m_buffers[0].get();
@@ -588,7 +650,7 @@ void VaapiDPBManager::initPictureRefLists(const PicturePtr& pic)
         }
     } else {
         for (i = 0; i < DPBLayer->DPBCount; i++) {
-            frameStore = DPBLayer->DPB[i];
+            VaapiFrameStore* frameStore = DPBLayer->DPB[i];
             for (j = 0; j < frameStore->m_numBuffers; j++) {
                 picture = frameStore->m_buffers[j].get();
                 if (VAAPI_H264_PICTURE_IS_SHORT_TERM_REFERENCE(picture))
@@ -615,25 +677,19 @@ void VaapiDPBManager::initPictureRefLists(const PicturePtr& pic)
 void VaapiDPBManager::initPictureRefsPSlice(const PicturePtr& pic,
                                             const SliceHeaderPtr& sliceHdr)
 {
-    VaapiDecPictureH264 **refList;
     uint32_t i;
 
     if (pic->m_structure == VAAPI_PICTURE_STRUCTURE_FRAME) {
         /* 8.2.4.2.1 - P and SP slices in frames */
-        if (DPBLayer->shortRefCount > 0) {
-            refList = DPBLayer->refPicList0;
+        {
+            RefListBuilder list(DPBLayer->refPicList0, &DPBLayer->refPicList0Count);
             for (i = 0; i < DPBLayer->shortRefCount; i++)
-                refList[i] = DPBLayer->shortRef[i];
-            SORT_REF_LIST(refList, i, PicNumDec);
-            DPBLayer->refPicList0Count += i;
+                list.insertDec(DPBLayer->shortRef[i], DPBLayer->shortRef[i]->m_picNum);
         }
-
-        if (DPBLayer->longRefCount > 0) {
-            refList = &DPBLayer->refPicList0[DPBLayer->refPicList0Count];
+        {
+            RefListBuilder list(DPBLayer->refPicList0, &DPBLayer->refPicList0Count);
             for (i = 0; i < DPBLayer->longRefCount; i++)
-                refList[i] = DPBLayer->longRef[i];
-            SORT_REF_LIST(refList, i, LongTermPicNumInc);
-            DPBLayer->refPicList0Count += i;
+                list.insertInc(DPBLayer->longRef[i], DPBLayer->longRef[i]->m_longTermPicNum);
         }
     } else {
         /* 8.2.4.2.2 - P and SP slices in fields */
@@ -642,18 +698,15 @@ void VaapiDPBManager::initPictureRefsPSlice(const PicturePtr& pic,
         VaapiDecPictureH264 *longRef[32];
         uint32_t longRefCount = 0;
 
-        if (DPBLayer->shortRefCount > 0) {
+        {
+            RefListBuilder list(shortRef, &shortRefCount);
             for (i = 0; i < DPBLayer->shortRefCount; i++)
-                shortRef[i] = DPBLayer->shortRef[i];
-            SORT_REF_LIST(shortRef, i, FrameNumWrapDec);
-            shortRefCount = i;
+                list.insertDec(DPBLayer->shortRef[i], DPBLayer->shortRef[i]->m_frameNumWrap);
         }
-
-        if (DPBLayer->longRefCount > 0) {
+        {
+            RefListBuilder list(longRef, &longRefCount);
             for (i = 0; i < DPBLayer->longRefCount; i++)
-                longRef[i] = DPBLayer->longRef[i];
-            SORT_REF_LIST(longRef, i, LongTermFrameIdxInc);
-            longRefCount = i;
+                list.insertInc(DPBLayer->longRef[i], DPBLayer->longRef[i]->m_longTermFrameIdx);
         }
 
         initPictureRefsFields(pic,
@@ -667,68 +720,59 @@ void VaapiDPBManager::initPictureRefsPSlice(const PicturePtr& pic,
 void VaapiDPBManager::initPictureRefsBSlice(const PicturePtr& picture,
                                             const SliceHeaderPtr& sliceHdr)
 {
-    VaapiDecPictureH264 **refList;
-    uint32_t i, n;
+    uint32_t i;
 
     if (picture->m_structure == VAAPI_PICTURE_STRUCTURE_FRAME) {
         /* 8.2.4.2.3 - B slices in frames */
 
         /* refPicList0 */
-        if (DPBLayer->shortRefCount > 0) {
-            // 1. Short-term references
-            refList = DPBLayer->refPicList0;
-            for (n = 0, i = 0; i < DPBLayer->shortRefCount; i++) {
-                if (DPBLayer->shortRef[i]->m_POC < picture->m_POC)
-                    refList[n++] = DPBLayer->shortRef[i];
+        {
+            // 1. Short-term references, before the current picture first
+            RefListBuilder before(DPBLayer->refPicList0, &DPBLayer->refPicList0Count);
+            for (i = 0; i < DPBLayer->shortRefCount; i++) {
+                VaapiDecPictureH264 *const ref = DPBLayer->shortRef[i];
+                if (ref->m_POC < picture->m_POC)
+                    before.insertDec(ref, ref->m_POC);
             }
-            SORT_REF_LIST(refList, n, POCDec);
-            DPBLayer->refPicList0Count += n;
-
-            refList = &DPBLayer->refPicList0[DPBLayer->refPicList0Count];
-            for (n = 0, i = 0; i < DPBLayer->shortRefCount; i++) {
-                if (DPBLayer->shortRef[i]->m_POC >= picture->m_POC)
-                    refList[n++] = DPBLayer->shortRef[i];
+        }
+        {
+            RefListBuilder after(DPBLayer->refPicList0, &DPBLayer->refPicList0Count);
+            for (i = 0; i < DPBLayer->shortRefCount; i++) {
+                VaapiDecPictureH264 *const ref = DPBLayer->shortRef[i];
+                if (ref->m_POC >= picture->m_POC)
+                    after.insertInc(ref, ref->m_POC);
             }
-            SORT_REF_LIST(refList, n, POCInc);
-            DPBLayer->refPicList0Count += n;
         }
-
-        if (DPBLayer->longRefCount > 0) {
+        {
             // 2. Long-term references
-            refList = &DPBLayer->refPicList0[DPBLayer->refPicList0Count];
-            for (n = 0, i = 0; i < DPBLayer->longRefCount; i++)
-                refList[n++] = DPBLayer->longRef[i];
-            SORT_REF_LIST(refList, n, LongTermPicNumInc);
-            DPBLayer->refPicList0Count += n;
+            RefListBuilder list(DPBLayer->refPicList0, &DPBLayer->refPicList0Count);
+            for (i = 0; i < DPBLayer->longRefCount; i++)
+                list.insertInc(DPBLayer->longRef[i], DPBLayer->longRef[i]->m_longTermPicNum);
         }
 
         /* refPicList1 */
-        if (DPBLayer->shortRefCount > 0) {
-            // 1. Short-term references
-            refList = DPBLayer->refPicList1;
-            for (n = 0, i = 0; i < DPBLayer->shortRefCount; i++) {
-                if (DPBLayer->shortRef[i]->m_POC > picture->m_POC)
-                    refList[n++] = DPBLayer->shortRef[i];
+        {
+            // 1. Short-term references, after the current picture first
+            RefListBuilder after(DPBLayer->refPicList1, &DPBLayer->refPicList1Count);
+            for (i = 0; i < DPBLayer->shortRefCount; i++) {
+                VaapiDecPictureH264 *const ref = DPBLayer->shortRef[i];
+                if (ref->m_POC > picture->m_POC)
+                    after.insertInc(ref, ref->m_POC);
             }
-            SORT_REF_LIST(refList, n, POCInc);
-            DPBLayer->refPicList1Count += n;
-
-            refList = &DPBLayer->refPicList1[DPBLayer->refPicList1Count];
-            for (n = 0, i = 0; i < DPBLayer->shortRefCount; i++) {
-                if (DPBLayer->shortRef[i]->m_POC <= picture->m_POC)
-                    refList[n++] = DPBLayer->shortRef[i];
+        }
+        {
+            RefListBuilder before(DPBLayer->refPicList1, &DPBLayer->refPicList1Count);
+            for (i = 0; i < DPBLayer->shortRefCount; i++) {
+                VaapiDecPictureH264 *const ref = DPBLayer->shortRef[i];
+                if (ref->m_POC <= picture->m_POC)
+                    before.insertDec(ref, ref->m_POC);
             }
-            SORT_REF_LIST(refList, n, POCDec);
-            DPBLayer->refPicList1Count += n;
         }
-
-        if (DPBLayer->longRefCount > 0) {
+        {
             // 2. Long-term references
-            refList = &DPBLayer->refPicList1[DPBLayer->refPicList1Count];
-            for (n = 0, i = 0; i < DPBLayer->longRefCount; i++)
-                refList[n++] = DPBLayer->longRef[i];
-            SORT_REF_LIST(refList, n, LongTermPicNumInc);
-            DPBLayer->refPicList1Count += n;
+            RefListBuilder list(DPBLayer->refPicList1, &DPBLayer->refPicList1Count);
+            for (i = 0; i < DPBLayer->longRefCount; i++)
+                list.insertInc(DPBLayer->longRef[i], DPBLayer->longRef[i]->m_longTermPicNum);
         }
     } else {
         /* 8.2.4.2.4 - B slices in fields */
@@ -740,49 +784,46 @@ void VaapiDPBManager::initPictureRefsBSlice(const PicturePtr& picture,
         uint32_t longRefCount = 0;
 
         /* refFrameList0ShortTerm */
-        if (DPBLayer->shortRefCount > 0) {
-            refList = shortRef0;
-            for (n = 0, i = 0; i < DPBLayer->shortRefCount; i++) {
-                if (DPBLayer->shortRef[i]->m_POC <= picture->m_POC)
-                    refList[n++] = DPBLayer->shortRef[i];
+        {
+            RefListBuilder before(shortRef0, &shortRef0Count);
+            for (i = 0; i < DPBLayer->shortRefCount; i++) {
+                VaapiDecPictureH264 *const ref = DPBLayer->shortRef[i];
+                if (ref->m_POC <= picture->m_POC)
+                    before.insertDec(ref, ref->m_POC);
             }
-            SORT_REF_LIST(refList, n, POCDec);
-            shortRef0Count += n;
-
-            refList = &shortRef0[shortRef0Count];
-            for (n = 0, i = 0; i < DPBLayer->shortRefCount; i++) {
-                if (DPBLayer->shortRef[i]->m_POC > picture->m_POC)
-                    refList[n++] = DPBLayer->shortRef[i];
+        }
+        {
+            RefListBuilder after(shortRef0, &shortRef0Count);
+            for (i = 0; i < DPBLayer->shortRefCount; i++) {
+                VaapiDecPictureH264 *const ref = DPBLayer->shortRef[i];
+                if (ref->m_POC > picture->m_POC)
+                    after.insertInc(ref, ref->m_POC);
             }
-            SORT_REF_LIST(refList, n, POCInc);
-            shortRef0Count += n;
         }
 
         /* refFrameList1ShortTerm */
-        if (DPBLayer->shortRefCount > 0) {
-            refList = shortRef1;
-            for (n = 0, i = 0; i < DPBLayer->shortRefCount; i++) {
-                if (DPBLayer->shortRef[i]->m_POC > picture->m_POC)
-                    refList[n++] = DPBLayer->shortRef[i];
+        {
+            RefListBuilder after(shortRef1, &shortRef1Count);
+            for (i = 0; i < DPBLayer->shortRefCount; i++) {
+                VaapiDecPictureH264 *const ref = DPBLayer->shortRef[i];
+                if (ref->m_POC > picture->m_POC)
+                    after.insertInc(ref, ref->m_POC);
             }
-            SORT_REF_LIST(refList, n, POCInc);
-            shortRef1Count += n;
-
-            refList = &shortRef1[shortRef1Count];
-            for (n = 0, i = 0; i < DPBLayer->shortRefCount; i++) {
-                if (DPBLayer->shortRef[i]->m_POC <= picture->m_POC)
-                    refList[n++] = DPBLayer->shortRef[i];
+        }
+        {
+            RefListBuilder before(shortRef1, &shortRef1Count);
+            for (i = 0; i < DPBLayer->shortRefCount; i++) {
+                VaapiDecPictureH264 *const ref = DPBLayer->shortRef[i];
+                if (ref->m_POC <= picture->m_POC)
+                    before.insertDec(ref, ref->m_POC);
             }
-            SORT_REF_LIST(refList, n, POCDec);
-            shortRef1Count += n;
         }
 
         /* refFrameListLongTerm */
-        if (DPBLayer->longRefCount > 0) {
+        {
+            RefListBuilder list(longRef, &longRefCount);
             for (i = 0; i < DPBLayer->longRefCount; i++)
-                longRef[i] = DPBLayer->longRef[i];
-            SORT_REF_LIST(longRef, i, LongTermFrameIdxInc);
-            longRefCount = i;
+                list.insertInc(DPBLayer->longRef[i], DPBLayer->longRef[i]->m_longTermFrameIdx);
         }
 
         initPictureRefsFields(picture,
@@ -1291,8 +1332,9 @@ void VaapiDPBManager::removeDPBIndex(uint32_t index)
 {
     uint32_t i, numFrames = --DPBLayer->DPBCount;
 
-    /* delete the frame store */
-    DPBLayer->DPB[index].reset();
+    /* the surfaces go back now unless the decoder still holds the frame
+     * store as its previous frame */
+    DPBLayer->DPB[index]->unuse(FRAME_STORE_IN_DPB);
 
     if (USE_STRICT_DPB_ORDERING) {
         for (i = index; i < numFrames; i++)
@@ -1300,7 +1342,7 @@ void VaapiDPBManager::removeDPBIndex(uint32_t index)
     } else if (index != numFrames)
         DPBLayer->DPB[index] = DPBLayer->DPB[numFrames];
 
-    DPBLayer->DPB[numFrames].reset();
+    DPBLayer->DPB[numFrames] = NULL;
 
 }
 }
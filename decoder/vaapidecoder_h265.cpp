@@ -0,0 +1,832 @@
+/*
+ *  vaapidecoder_h265.cpp - h265 decoder
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <tr1/functional>
+#include "common/log.h"
+#include "vaapidecoder_h265.h"
+#include "vaapidecoder_factory.h"
+
+namespace YamiMediaCodec{
+typedef VaapiDecoderH265::PicturePtr PicturePtr;
+
+static Decode_Status getStatus(H265ParserResult result)
+{
+    Decode_Status status;
+
+    switch (result) {
+    case H265_PARSER_OK:
+        status = DECODE_SUCCESS;
+        break;
+    case H265_PARSER_NO_NAL_END:
+        status = DECODE_INVALID_DATA;
+        break;
+    case H265_PARSER_ERROR:
+        status = DECODE_PARSER_FAIL;
+        break;
+    default:
+        status = DECODE_FAIL;
+        break;
+    }
+    return status;
+}
+
+VaapiDecoderH265::VaapiDecoderH265()
+    : m_dpb(std::tr1::bind(&VaapiDecoderH265::outputPicture, this,
+                           std::tr1::placeholders::_1))
+    , m_lastSliceParam(NULL)
+    , m_refFrameCount(0)
+    , m_newStream(true)
+    , m_noRaslOutputFlag(true)
+    , m_gotSPS(false)
+    , m_isHEVC(false)
+    , m_nalLengthSize(4)
+{
+    m_parser.reset(h265_parser_new(), h265_parser_free);
+    memset(&m_lastSlice, 0, sizeof(m_lastSlice));
+    memset(m_refFrames, 0, sizeof(m_refFrames));
+}
+
+VaapiDecoderH265::~VaapiDecoderH265()
+{
+    stop();
+}
+
+Decode_Status VaapiDecoderH265::start(VideoConfigBuffer * buffer)
+{
+    DEBUG("H265: start()");
+
+    buffer->profile = VAProfileHEVCMain;
+    DEBUG("disable native graphics buffer");
+    buffer->flag &= ~USE_NATIVE_GRAPHIC_BUFFER;
+    m_configBuffer = *buffer;
+    m_configBuffer.data = NULL;
+    m_configBuffer.size = 0;
+
+    // the va context is created with the first picture, see ensureContext()
+    if (buffer->data && buffer->size) {
+        if (!decodeCodecData((uint8_t *) buffer->data, buffer->size)) {
+            ERROR("codec data has some error");
+            return DECODE_FAIL;
+        }
+    }
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderH265::reset(VideoConfigBuffer * buffer)
+{
+    DEBUG("H265: reset()");
+    m_splitter.reset();
+    return VaapiDecoderBase::reset(buffer);
+}
+
+void VaapiDecoderH265::stop(void)
+{
+    DEBUG("H265: stop()");
+    //release all pictures before we release surface pool
+    flush();
+    VaapiDecoderBase::stop();
+    m_splitter.reset();
+}
+
+void VaapiDecoderH265::flush(void)
+{
+    DEBUG("H265: flush()");
+    m_current.reset();
+    m_lastSliceParam = NULL;
+    m_dpb.clear();
+    m_newStream = true;
+    VaapiDecoderBase::flush();
+}
+
+void VaapiDecoderH265::flushOutport(void)
+{
+    // decodeSequenceEnd() drains dpb automatically
+    if (decodeSequenceEnd() != DECODE_SUCCESS)
+        ERROR("fail to decode current picture upon EOS");
+}
+
+bool VaapiDecoderH265::outputPicture(const PicturePtr& picture)
+{
+    return VaapiDecoderBase::outputPicture(picture->m_picture) == DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderH265::ensureContext(const H265SPS* sps)
+{
+    const uint8_t highestTid = sps->max_sub_layers_minus1;
+    const int32_t surfaceNumber = sps->max_dec_pic_buffering_minus1[highestTid] + 1
+                                   + H265_EXTRA_SURFACE_NUMBER;
+    Decode_Status status;
+
+    if (sps->chroma_format_idc != 1
+        || sps->bit_depth_luma_minus8 || sps->bit_depth_chroma_minus8) {
+        ERROR("unsupported stream, chroma_format_idc = %d, bit depth = %d",
+              sps->chroma_format_idc, sps->bit_depth_luma_minus8 + 8);
+        return DECODE_FAIL;
+    }
+
+    // only reset va context when there is a larger frame or a larger dpb
+    if (m_VAStarted
+        && m_configBuffer.width >= sps->width
+        && m_configBuffer.height >= sps->height
+        && m_configBuffer.surfaceNumber >= surfaceNumber) {
+        if (m_videoFormatInfo.width != sps->width
+            || m_videoFormatInfo.height != sps->height) {
+            // notify client of resolution change, no need to reset hw context
+            INFO("frame size changed, orig size %d x %d, new size: %d x %d",
+                 m_videoFormatInfo.width, m_videoFormatInfo.height, sps->width, sps->height);
+            m_videoFormatInfo.width = sps->width;
+            m_videoFormatInfo.height = sps->height;
+            return DECODE_FORMAT_CHANGE;
+        }
+        return DECODE_SUCCESS;
+    }
+
+    INFO("reconfig codec, size %d x %d, %d surfaces", sps->width, sps->height, surfaceNumber);
+    // pictures still waiting in the dpb are output through the old surface pool,
+    // reconfigure() keeps it until the client has them all back
+    m_dpb.flush();
+    m_configBuffer.profile = VAProfileHEVCMain;
+    m_configBuffer.width = sps->width;
+    m_configBuffer.height = sps->height;
+    m_configBuffer.surfaceWidth = ALIGN16(sps->width);
+    m_configBuffer.surfaceHeight = ALIGN16(sps->height);
+    m_configBuffer.surfaceNumber = surfaceNumber;
+    if (m_VAStarted)
+        status = VaapiDecoderBase::reconfigure(&m_configBuffer);
+    else
+        status = VaapiDecoderBase::start(&m_configBuffer);
+    if (status != DECODE_SUCCESS)
+        return status;
+    return DECODE_FORMAT_CHANGE;
+}
+
+void VaapiDecoderH265::fillReference(VAPictureHEVC* ref, const H265Picture* picture,
+                                     uint32_t flags)
+{
+    if (!picture) {
+        ref->picture_id = VA_INVALID_SURFACE;
+        ref->pic_order_cnt = 0;
+        ref->flags = VA_PICTURE_HEVC_INVALID;
+        return;
+    }
+    ref->picture_id = picture->m_picture->getSurfaceID();
+    ref->pic_order_cnt = picture->m_poc;
+    ref->flags = flags;
+    if (picture->m_isLongTerm)
+        ref->flags |= VA_PICTURE_HEVC_LONG_TERM_REFERENCE;
+}
+
+void VaapiDecoderH265::fillReferences(VAPictureParameterBufferHEVC* param)
+{
+    const struct {
+        const H265DPB::RefSet* set;
+        uint32_t flags;
+    } sets[] = {
+        { &m_dpb.m_stCurrBefore, VA_PICTURE_HEVC_RPS_ST_CURR_BEFORE },
+        { &m_dpb.m_stCurrAfter, VA_PICTURE_HEVC_RPS_ST_CURR_AFTER },
+        { &m_dpb.m_ltCurr, VA_PICTURE_HEVC_RPS_LT_CURR },
+        { &m_dpb.m_stFoll, 0 },
+        { &m_dpb.m_ltFoll, 0 },
+    };
+    uint32_t i, j;
+
+    m_refFrameCount = 0;
+    for (i = 0; i < N_ELEMENTS(sets); i++) {
+        const H265DPB::RefSet& set = *sets[i].set;
+        for (j = 0; j < set.size() && m_refFrameCount < H265_MAX_REFERENCES; j++) {
+            if (!set[j])
+                continue;
+            fillReference(&param->ReferenceFrames[m_refFrameCount], set[j], sets[i].flags);
+            m_refFrames[m_refFrameCount++] = set[j];
+        }
+    }
+    for (i = m_refFrameCount; i < H265_MAX_REFERENCES; i++) {
+        fillReference(&param->ReferenceFrames[i], NULL, 0);
+        m_refFrames[i] = NULL;
+    }
+}
+
+bool VaapiDecoderH265::fillPicture(const PicturePtr& picture, const H265NalUnit* nalu,
+                                   const H265SliceHdr* slice)
+{
+    VAPictureParameterBufferHEVC* param;
+    const H265PPS* pps = slice->pps;
+    const H265SPS* sps = pps->sps;
+    const uint8_t highestTid = sps->max_sub_layers_minus1;
+    uint32_t i;
+
+    if (!picture->m_picture->editPicture(param))
+        return false;
+
+    fillReference(&param->CurrPic, picture.get(), 0);
+    fillReferences(param);
+
+#define FILL_SPS_PIC_FIELD(field) param->pic_fields.bits.field = sps->field;
+#define FILL_PPS_PIC_FIELD(field) param->pic_fields.bits.field = pps->field;
+    FILL_SPS_PIC_FIELD(chroma_format_idc)
+    FILL_SPS_PIC_FIELD(separate_colour_plane_flag)
+    FILL_SPS_PIC_FIELD(pcm_enabled_flag)
+    FILL_SPS_PIC_FIELD(scaling_list_enabled_flag)
+    FILL_PPS_PIC_FIELD(transform_skip_enabled_flag)
+    FILL_SPS_PIC_FIELD(amp_enabled_flag)
+    FILL_SPS_PIC_FIELD(strong_intra_smoothing_enabled_flag)
+    FILL_PPS_PIC_FIELD(sign_data_hiding_enabled_flag)
+    FILL_PPS_PIC_FIELD(constrained_intra_pred_flag)
+    FILL_PPS_PIC_FIELD(cu_qp_delta_enabled_flag)
+    FILL_PPS_PIC_FIELD(weighted_pred_flag)
+    FILL_PPS_PIC_FIELD(weighted_bipred_flag)
+    FILL_PPS_PIC_FIELD(transquant_bypass_enabled_flag)
+    FILL_PPS_PIC_FIELD(tiles_enabled_flag)
+    FILL_PPS_PIC_FIELD(entropy_coding_sync_enabled_flag)
+    FILL_PPS_PIC_FIELD(loop_filter_across_tiles_enabled_flag)
+    FILL_SPS_PIC_FIELD(pcm_loop_filter_disabled_flag)
+#undef FILL_SPS_PIC_FIELD
+#undef FILL_PPS_PIC_FIELD
+    param->pic_fields.bits.pps_loop_filter_across_slices_enabled_flag
+        = pps->loop_filter_across_slices_enabled_flag;
+    param->pic_fields.bits.NoPicReorderingFlag = !sps->max_num_reorder_pics[highestTid];
+    param->pic_fields.bits.NoBiPredFlag = 0;
+
+#define FILL_SPS_FIELD(field) param->field = sps->field;
+    FILL_SPS_FIELD(pic_width_in_luma_samples)
+    FILL_SPS_FIELD(pic_height_in_luma_samples)
+    FILL_SPS_FIELD(bit_depth_luma_minus8)
+    FILL_SPS_FIELD(bit_depth_chroma_minus8)
+    FILL_SPS_FIELD(pcm_sample_bit_depth_luma_minus1)
+    FILL_SPS_FIELD(pcm_sample_bit_depth_chroma_minus1)
+    FILL_SPS_FIELD(log2_min_luma_coding_block_size_minus3)
+    FILL_SPS_FIELD(log2_diff_max_min_luma_coding_block_size)
+    FILL_SPS_FIELD(log2_min_transform_block_size_minus2)
+    FILL_SPS_FIELD(log2_diff_max_min_transform_block_size)
+    FILL_SPS_FIELD(log2_min_pcm_luma_coding_block_size_minus3)
+    FILL_SPS_FIELD(log2_diff_max_min_pcm_luma_coding_block_size)
+    FILL_SPS_FIELD(max_transform_hierarchy_depth_intra)
+    FILL_SPS_FIELD(max_transform_hierarchy_depth_inter)
+    FILL_SPS_FIELD(log2_max_pic_order_cnt_lsb_minus4)
+    FILL_SPS_FIELD(num_short_term_ref_pic_sets)
+#undef FILL_SPS_FIELD
+    param->sps_max_dec_pic_buffering_minus1 = sps->max_dec_pic_buffering_minus1[highestTid];
+    param->num_long_term_ref_pic_sps = sps->num_long_term_ref_pics_sps;
+
+#define FILL_PPS_FIELD(field) param->field = pps->field;
+    FILL_PPS_FIELD(init_qp_minus26)
+    FILL_PPS_FIELD(diff_cu_qp_delta_depth)
+    FILL_PPS_FIELD(log2_parallel_merge_level_minus2)
+    FILL_PPS_FIELD(num_tile_columns_minus1)
+    FILL_PPS_FIELD(num_tile_rows_minus1)
+    FILL_PPS_FIELD(num_ref_idx_l0_default_active_minus1)
+    FILL_PPS_FIELD(num_ref_idx_l1_default_active_minus1)
+    FILL_PPS_FIELD(num_extra_slice_header_bits)
+#undef FILL_PPS_FIELD
+    param->pps_cb_qp_offset = pps->cb_qp_offset;
+    param->pps_cr_qp_offset = pps->cr_qp_offset;
+    param->pps_beta_offset_div2 = pps->beta_offset_div2;
+    param->pps_tc_offset_div2 = pps->tc_offset_div2;
+
+    if (pps->tiles_enabled_flag) {
+        const uint32_t ctbLog2Size = sps->log2_min_luma_coding_block_size_minus3 + 3
+                                     + sps->log2_diff_max_min_luma_coding_block_size;
+        const uint32_t ctbSize = 1 << ctbLog2Size;
+        const uint32_t widthInCtbs = (sps->pic_width_in_luma_samples + ctbSize - 1) >> ctbLog2Size;
+        const uint32_t heightInCtbs = (sps->pic_height_in_luma_samples + ctbSize - 1) >> ctbLog2Size;
+        const uint32_t columns = pps->num_tile_columns_minus1 + 1;
+        const uint32_t rows = pps->num_tile_rows_minus1 + 1;
+
+        // (6-3) and (6-4), the parser keeps the explicit sizes only
+        for (i = 0; i < columns && i < N_ELEMENTS(param->column_width_minus1); i++) {
+            if (pps->uniform_spacing_flag)
+                param->column_width_minus1[i] = ((i + 1) * widthInCtbs) / columns
+                                                - (i * widthInCtbs) / columns - 1;
+            else
+                param->column_width_minus1[i] = pps->column_width_minus1[i];
+        }
+        for (i = 0; i < rows && i < N_ELEMENTS(param->row_height_minus1); i++) {
+            if (pps->uniform_spacing_flag)
+                param->row_height_minus1[i] = ((i + 1) * heightInCtbs) / rows
+                                              - (i * heightInCtbs) / rows - 1;
+            else
+                param->row_height_minus1[i] = pps->row_height_minus1[i];
+        }
+    }
+
+#define FILL_PPS_SLICE_FIELD(field) param->slice_parsing_fields.bits.field = pps->field;
+    FILL_PPS_SLICE_FIELD(lists_modification_present_flag)
+    FILL_PPS_SLICE_FIELD(cabac_init_present_flag)
+    FILL_PPS_SLICE_FIELD(output_flag_present_flag)
+    FILL_PPS_SLICE_FIELD(dependent_slice_segments_enabled_flag)
+    FILL_PPS_SLICE_FIELD(deblocking_filter_override_enabled_flag)
+    FILL_PPS_SLICE_FIELD(slice_segment_header_extension_present_flag)
+#undef FILL_PPS_SLICE_FIELD
+    param->slice_parsing_fields.bits.long_term_ref_pics_present_flag
+        = sps->long_term_ref_pics_present_flag;
+    param->slice_parsing_fields.bits.sps_temporal_mvp_enabled_flag
+        = sps->temporal_mvp_enabled_flag;
+    param->slice_parsing_fields.bits.sample_adaptive_offset_enabled_flag
+        = sps->sample_adaptive_offset_enabled_flag;
+    param->slice_parsing_fields.bits.pps_slice_chroma_qp_offsets_present_flag
+        = pps->slice_chroma_qp_offsets_present_flag;
+    param->slice_parsing_fields.bits.pps_disable_deblocking_filter_flag
+        = pps->deblocking_filter_disabled_flag;
+    param->slice_parsing_fields.bits.RapPicFlag = H265_NAL_IS_IRAP(nalu->type);
+    param->slice_parsing_fields.bits.IdrPicFlag = H265_NAL_IS_IDR(nalu->type);
+    param->slice_parsing_fields.bits.IntraPicFlag = H265_NAL_IS_IRAP(nalu->type);
+
+    param->st_rps_bits = slice->short_term_ref_pic_set_size;
+    return true;
+}
+
+bool VaapiDecoderH265::fillIqMatrix(const PicturePtr& picture, const H265SliceHdr* slice)
+{
+    const H265PPS* pps = slice->pps;
+    const H265SPS* sps = pps->sps;
+    const H265ScalingList* scalingList;
+    VAIQMatrixBufferHEVC* iqMatrix;
+    uint32_t i;
+
+    if (!sps->scaling_list_enabled_flag)
+        return true;
+
+    // the parser fills the pps lists with the sps ones or the default ones
+    if (pps->scaling_list_data_present_flag || !sps->scaling_list_data_present_flag)
+        scalingList = &pps->scaling_list;
+    else
+        scalingList = &sps->scaling_list;
+
+    if (!picture->m_picture->editIqMatrix(iqMatrix))
+        return false;
+
+    for (i = 0; i < N_ELEMENTS(iqMatrix->ScalingList4x4); i++) {
+        h265_quant_matrix_4x4_get_raster_from_uprightdiagonal(
+            iqMatrix->ScalingList4x4[i], scalingList->scaling_lists_4x4[i]);
+        h265_quant_matrix_8x8_get_raster_from_uprightdiagonal(
+            iqMatrix->ScalingList8x8[i], scalingList->scaling_lists_8x8[i]);
+        h265_quant_matrix_16x16_get_raster_from_uprightdiagonal(
+            iqMatrix->ScalingList16x16[i], scalingList->scaling_lists_16x16[i]);
+        iqMatrix->ScalingListDC16x16[i] = scalingList->scaling_list_dc_coef_minus8_16x16[i] + 8;
+    }
+    for (i = 0; i < N_ELEMENTS(iqMatrix->ScalingList32x32); i++) {
+        h265_quant_matrix_32x32_get_raster_from_uprightdiagonal(
+            iqMatrix->ScalingList32x32[i], scalingList->scaling_lists_32x32[i]);
+        iqMatrix->ScalingListDC32x32[i] = scalingList->scaling_list_dc_coef_minus8_32x32[i] + 8;
+    }
+    return true;
+}
+
+uint8_t VaapiDecoderH265::getRefIndex(const H265Picture* ref) const
+{
+    if (!ref)
+        return H265_INVALID_REF_INDEX;
+    for (uint32_t i = 0; i < m_refFrameCount; i++) {
+        if (m_refFrames[i] == ref)
+            return i;
+    }
+    return H265_INVALID_REF_INDEX;
+}
+
+void VaapiDecoderH265::fillRefPicList(VASliceParameterBufferHEVC* sliceParam,
+                                      const H265SliceHdr* slice)
+{
+    H265Picture* refPicList0[H265_MAX_REFERENCES];
+    H265Picture* refPicList1[H265_MAX_REFERENCES];
+
+    m_dpb.initRefPicLists(slice, refPicList0, refPicList1);
+    for (uint32_t i = 0; i < H265_MAX_REFERENCES; i++) {
+        sliceParam->RefPicList[0][i] = getRefIndex(refPicList0[i]);
+        sliceParam->RefPicList[1][i] = getRefIndex(refPicList1[i]);
+    }
+}
+
+/* ChromaOffsetL0/L1 of (7-56), for 8 bits samples */
+static int8_t getChromaOffset(int16_t deltaOffset, int8_t deltaWeight, uint8_t log2Denom)
+{
+    const int32_t weight = (1 << log2Denom) + deltaWeight;
+    const int32_t offset = 128 + deltaOffset - ((128 * weight) >> log2Denom);
+    return CLAMP(offset, -128, 127);
+}
+
+void VaapiDecoderH265::fillPredWeightTable(VASliceParameterBufferHEVC* sliceParam,
+                                           const H265SliceHdr* slice)
+{
+    const H265PredWeightTable& w = slice->pred_weight_table;
+    const H265PPS* pps = slice->pps;
+    uint8_t chromaLog2Denom;
+    uint32_t i, j;
+
+    if (!(pps->weighted_pred_flag && H265_IS_P_SLICE(slice))
+        && !(pps->weighted_bipred_flag && H265_IS_B_SLICE(slice)))
+        return;
+
+    sliceParam->luma_log2_weight_denom = w.luma_log2_weight_denom;
+    sliceParam->delta_chroma_log2_weight_denom = w.delta_chroma_log2_weight_denom;
+    chromaLog2Denom = w.luma_log2_weight_denom + w.delta_chroma_log2_weight_denom;
+
+#define FILL_WEIGHT_TABLE(n) \
+    for (i = 0; i <= slice->num_ref_idx_l##n##_active_minus1; i++) { \
+        if (w.luma_weight_l##n##_flag[i]) { \
+            sliceParam->delta_luma_weight_l##n[i] = w.delta_luma_weight_l##n[i]; \
+            sliceParam->luma_offset_l##n[i] = w.luma_offset_l##n[i]; \
+        } \
+        if (!w.chroma_weight_l##n##_flag[i]) \
+            continue; \
+        for (j = 0; j < 2; j++) { \
+            sliceParam->delta_chroma_weight_l##n[i][j] = w.delta_chroma_weight_l##n[i][j]; \
+            sliceParam->ChromaOffsetL##n[i][j] = getChromaOffset( \
+                w.delta_chroma_offset_l##n[i][j], w.delta_chroma_weight_l##n[i][j], \
+                chromaLog2Denom); \
+        } \
+    }
+
+    FILL_WEIGHT_TABLE(0)
+    if (H265_IS_B_SLICE(slice))
+        FILL_WEIGHT_TABLE(1)
+#undef FILL_WEIGHT_TABLE
+}
+
+bool VaapiDecoderH265::fillSlice(VASliceParameterBufferHEVC* sliceParam,
+                                 const H265NalUnit* nalu, const H265SliceHdr* slice)
+{
+    sliceParam->slice_data_byte_offset = nalu->header_bytes
+                                         + (slice->header_size + 7) / 8
+                                         - slice->n_emulation_prevention_bytes;
+    sliceParam->slice_segment_address = slice->segment_address;
+    fillRefPicList(sliceParam, slice);
+
+#define FILL_SLICE_FLAG(flag, field) sliceParam->LongSliceFlags.fields.flag = slice->field;
+    FILL_SLICE_FLAG(dependent_slice_segment_flag, dependent_slice_segment_flag)
+    FILL_SLICE_FLAG(slice_type, type)
+    FILL_SLICE_FLAG(color_plane_id, colour_plane_id)
+    FILL_SLICE_FLAG(slice_sao_luma_flag, sao_luma_flag)
+    FILL_SLICE_FLAG(slice_sao_chroma_flag, sao_chroma_flag)
+    FILL_SLICE_FLAG(mvd_l1_zero_flag, mvd_l1_zero_flag)
+    FILL_SLICE_FLAG(cabac_init_flag, cabac_init_flag)
+    FILL_SLICE_FLAG(slice_temporal_mvp_enabled_flag, temporal_mvp_enabled_flag)
+    FILL_SLICE_FLAG(slice_deblocking_filter_disabled_flag, deblocking_filter_disabled_flag)
+    FILL_SLICE_FLAG(collocated_from_l0_flag, collocated_from_l0_flag)
+    FILL_SLICE_FLAG(slice_loop_filter_across_slices_enabled_flag,
+                    loop_filter_across_slices_enabled_flag)
+#undef FILL_SLICE_FLAG
+    // set on the last slice once the picture is complete
+    sliceParam->LongSliceFlags.fields.LastSliceOfPic = 0;
+
+#define FILL_FIELD(field) sliceParam->field = slice->field;
+    FILL_FIELD(collocated_ref_idx)
+    FILL_FIELD(num_ref_idx_l0_active_minus1)
+    FILL_FIELD(num_ref_idx_l1_active_minus1)
+    FILL_FIELD(five_minus_max_num_merge_cand)
+#undef FILL_FIELD
+    sliceParam->slice_qp_delta = slice->qp_delta;
+    sliceParam->slice_cb_qp_offset = slice->cb_qp_offset;
+    sliceParam->slice_cr_qp_offset = slice->cr_qp_offset;
+    sliceParam->slice_beta_offset_div2 = slice->beta_offset_div2;
+    sliceParam->slice_tc_offset_div2 = slice->tc_offset_div2;
+
+    fillPredWeightTable(sliceParam, slice);
+    return true;
+}
+
+Decode_Status VaapiDecoderH265::decodeCurrentPicture()
+{
+    PicturePtr picture = m_current;
+
+    if (!picture)
+        return DECODE_SUCCESS;
+    m_current.reset();
+
+    if (m_lastSliceParam) {
+        m_lastSliceParam->LongSliceFlags.fields.LastSliceOfPic = 1;
+        m_lastSliceParam = NULL;
+    }
+    if (!picture->m_picture->decode()) {
+        ERROR("decode picture with poc %d failed", picture->m_poc);
+        return DECODE_FAIL;
+    }
+    m_dpb.finishPicture(picture);
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderH265::startPicture(H265NalUnit * nalu, const H265SliceHdr * slice)
+{
+    bool noRaslOutputFlag = m_noRaslOutputFlag;
+    Decode_Status status;
+
+    if (H265_NAL_IS_IRAP(nalu->type)) {
+        noRaslOutputFlag = H265_NAL_IS_IDR(nalu->type)
+                           || H265_NAL_IS_BLA(nalu->type) || m_newStream;
+    } else if (m_newStream) {
+        DEBUG("skip picture before the first irap picture, nal type %d", nalu->type);
+        return DECODE_SUCCESS;
+    }
+    // RASL pictures refer to pictures before the irap picture we started from
+    if (H265_NAL_IS_RASL(nalu->type) && noRaslOutputFlag) {
+        DEBUG("skip rasl picture");
+        return DECODE_SUCCESS;
+    }
+
+    // client resends the buffer on format change, so no state is updated before this
+    status = ensureContext(slice->pps->sps);
+    if (status != DECODE_SUCCESS)
+        return status;
+    m_newStream = false;
+    m_noRaslOutputFlag = noRaslOutputFlag;
+
+    VaapiDecoderBase::PicturePtr base = createPicture(m_currentPTS);
+    if (!base) {
+        ERROR("no surface available");
+        return DECODE_MEMORY_FAIL;
+    }
+    PicturePtr picture(new H265Picture);
+    picture->m_picture = base;
+    picture->m_outputNeeded = slice->pic_output_flag;
+
+    if (!m_dpb.startPicture(picture, nalu, slice, noRaslOutputFlag))
+        return DECODE_FAIL;
+    if (!fillPicture(picture, nalu, slice) || !fillIqMatrix(picture, slice))
+        return DECODE_FAIL;
+    m_current = picture;
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderH265::decodeSlice(H265NalUnit * nalu)
+{
+    H265SliceHdr slice;
+    H265ParserResult result;
+    VASliceParameterBufferHEVC* sliceParam;
+    Decode_Status status;
+
+    memset(&slice, 0, sizeof(slice));
+    result = h265_parser_parse_slice_hdr(m_parser.get(), nalu, &slice);
+    if (result == H265_PARSER_BROKEN_LINK) {
+        WARNING("skip slice without parameter sets");
+        return DECODE_SUCCESS;
+    }
+    if (result != H265_PARSER_OK)
+        return getStatus(result);
+    // entry points are not needed by the driver
+    h265_slice_hdr_free(&slice);
+
+    if (slice.dependent_slice_segment_flag) {
+        if (!m_current)
+            return DECODE_SUCCESS;
+        // a dependent slice segment inherits everything but its position
+        H265SliceHdr dependent = m_lastSlice;
+        dependent.dependent_slice_segment_flag = 1;
+        dependent.segment_address = slice.segment_address;
+        dependent.num_entry_point_offsets = slice.num_entry_point_offsets;
+        dependent.header_size = slice.header_size;
+        dependent.n_emulation_prevention_bytes = slice.n_emulation_prevention_bytes;
+        slice = dependent;
+    } else {
+        if (slice.first_slice_segment_in_pic_flag) {
+            status = decodeCurrentPicture();
+            if (status != DECODE_SUCCESS)
+                return status;
+            status = startPicture(nalu, &slice);
+            if (status != DECODE_SUCCESS)
+                return status;
+        }
+        // the picture is skipped or its first slice was lost
+        if (!m_current)
+            return DECODE_SUCCESS;
+        m_lastSlice = slice;
+    }
+
+    if (!m_current->m_picture->newSlice(sliceParam, nalu->data + nalu->offset, nalu->size))
+        return DECODE_FAIL;
+    if (!fillSlice(sliceParam, nalu, &slice))
+        return DECODE_FAIL;
+    m_lastSliceParam = sliceParam;
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderH265::decodeVPS(H265NalUnit * nalu)
+{
+    H265VPS vps;
+
+    memset(&vps, 0, sizeof(vps));
+    return getStatus(h265_parser_parse_vps(m_parser.get(), nalu, &vps));
+}
+
+Decode_Status VaapiDecoderH265::decodeSPS(H265NalUnit * nalu)
+{
+    H265SPS sps;
+    H265ParserResult result;
+
+    memset(&sps, 0, sizeof(sps));
+    result = h265_parser_parse_sps(m_parser.get(), nalu, &sps, true);
+    if (result != H265_PARSER_OK)
+        return getStatus(result);
+    m_gotSPS = true;
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderH265::decodePPS(H265NalUnit * nalu)
+{
+    H265PPS pps;
+
+    memset(&pps, 0, sizeof(pps));
+    return getStatus(h265_parser_parse_pps(m_parser.get(), nalu, &pps));
+}
+
+Decode_Status VaapiDecoderH265::decodeSequenceEnd()
+{
+    Decode_Status status = decodeCurrentPicture();
+
+    m_dpb.flush();
+    m_newStream = true;
+    return status;
+}
+
+Decode_Status VaapiDecoderH265::decodeNalu(H265NalUnit * nalu)
+{
+    Decode_Status status = DECODE_SUCCESS;
+
+    switch (nalu->type) {
+    case H265_NAL_VPS:
+        status = decodeVPS(nalu);
+        break;
+    case H265_NAL_SPS:
+        status = decodeSPS(nalu);
+        break;
+    case H265_NAL_PPS:
+        status = decodePPS(nalu);
+        break;
+    case H265_NAL_AUD:
+        status = decodeCurrentPicture();
+        break;
+    case H265_NAL_EOS:
+    case H265_NAL_EOB:
+        status = decodeSequenceEnd();
+        break;
+    case H265_NAL_FD:
+    case H265_NAL_PREFIX_SEI:
+    case H265_NAL_SUFFIX_SEI:
+        break;
+    default:
+        if (nalu->type <= H265_NAL_SLICE_RASL_R
+            || (nalu->type >= H265_NAL_SLICE_BLA_W_LP
+                && nalu->type <= H265_NAL_SLICE_CRA_NUT))
+            status = decodeSlice(nalu);
+        else
+            DEBUG("ignore NAL unit type %d", nalu->type);
+        break;
+    }
+    return status;
+}
+
+bool VaapiDecoderH265::decodeCodecData(uint8_t * buf, uint32_t bufSize)
+{
+    Decode_Status status;
+    H265NalUnit nalu;
+    H265ParserResult result;
+    uint32_t i, j, ofs, numArrays, numNalus;
+
+    DEBUG("H265: codec data detected");
+
+    if (!buf || bufSize == 0)
+        return false;
+
+    // no HEVCDecoderConfigurationRecord, parameter sets in annex B format
+    if (buf[0] != 1 || bufSize < 23) {
+        VideoDecodeBuffer buffer;
+        memset(&buffer, 0, sizeof(buffer));
+        buffer.data = buf;
+        buffer.size = bufSize;
+        status = decode(&buffer);
+        return status == DECODE_SUCCESS;
+    }
+
+    m_nalLengthSize = (buf[21] & 0x03) + 1;
+    numArrays = buf[22];
+    ofs = 23;
+
+    for (i = 0; i < numArrays; i++) {
+        if (ofs + 3 > bufSize)
+            return false;
+        numNalus = (buf[ofs + 1] << 8) | buf[ofs + 2];
+        ofs += 3;
+
+        for (j = 0; j < numNalus; j++) {
+            result = h265_parser_identify_nalu_hevc(m_parser.get(),
+                                                    buf, ofs, bufSize, 2,
+                                                    &nalu);
+            if (result != H265_PARSER_OK)
+                return false;
+
+            status = decodeNalu(&nalu);
+            if (status != DECODE_SUCCESS)
+                return false;
+            ofs = nalu.offset + nalu.size;
+        }
+    }
+
+    m_isHEVC = true;
+    return true;
+}
+
+/* the last NAL unit of a chunked stream only ends with the stream,
+ * units held on a format change which was not followed by a resend go first */
+void VaapiDecoderH265::decodeStreamTail()
+{
+    H265NalUnit nalu;
+    const uint8_t *data;
+    uint32_t size;
+
+    while (m_splitter.flush(data, size)) {
+        if (h265_parser_identify_nalu_unchecked(m_parser.get(), data, 0, size,
+                                                &nalu) == H265_PARSER_OK)
+            decodeNalu(&nalu);
+    }
+}
+
+Decode_Status VaapiDecoderH265::indexNalUnits(VideoDecodeBuffer * buffer)
+{
+    Decode_Status status = DECODE_SUCCESS;
+    H265ParserResult result;
+    H265NalUnit nalu;
+    uint32_t nalLengthSize = 0;
+    size_t i;
+
+    if (!(buffer->flag & IS_STREAM_CHUNK) && (m_isHEVC || buffer->flag & IS_AVCC))
+        nalLengthSize = m_nalLengthSize;
+    m_splitter.split(buffer, nalLengthSize);
+
+    const std::vector<NalUnitSplitter::Unit>& units = m_splitter.units();
+    m_nalIndex.clear();
+    for (i = 0; i < units.size(); i++) {
+        if (nalLengthSize)
+            result = h265_parser_identify_nalu_hevc(m_parser.get(),
+                                                    units[i].data, 0, units[i].size,
+                                                    nalLengthSize, &nalu);
+        else
+            result = h265_parser_identify_nalu_unchecked(m_parser.get(),
+                                                         units[i].data, 0, units[i].size,
+                                                         &nalu);
+        status = getStatus(result);
+        if (status != DECODE_SUCCESS) {
+            ERROR("parser nalu uncheck failed code =%d", status);
+            break;
+        }
+        m_nalIndex.push_back(nalu);
+    }
+    return status;
+}
+
+Decode_Status VaapiDecoderH265::decode(VideoDecodeBuffer * buffer)
+{
+    Decode_Status status, indexStatus;
+    size_t i;
+
+    m_currentPTS = buffer->timeStamp;
+
+    DEBUG("H265: Decode(bufsize =%d, timestamp=%ld)", buffer->size, m_currentPTS);
+    if (buffer->data == NULL && buffer->size == 0) { // got EOS
+        decodeStreamTail();
+        INFO("flush-debug got EOS, set all frames output-able");
+        flushOutport();
+        return DECODE_SUCCESS;
+    }
+
+    /* NAL units in front of a broken one are still decoded */
+    indexStatus = indexNalUnits(buffer);
+
+    status = DECODE_SUCCESS;
+    for (i = 0; i < m_nalIndex.size() && status == DECODE_SUCCESS; i++)
+        status = decodeNalu(&m_nalIndex[i]);
+    // the chunk is not sent again, we go on from the unit which changed the format
+    if (status == DECODE_FORMAT_CHANGE && (buffer->flag & IS_STREAM_CHUNK))
+        m_splitter.hold(m_nalIndex[i - 1].data);
+    if (status == DECODE_SUCCESS)
+        status = indexStatus;
+
+    return status;
+}
+
+const bool VaapiDecoderH265::s_registered =
+    VaapiDecoderFactory::register_<VaapiDecoderH265>(YAMI_MIME_H265)
+    && VaapiDecoderFactory::register_<VaapiDecoderH265>(YAMI_MIME_HEVC);
+
+}
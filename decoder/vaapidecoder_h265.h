@@ -0,0 +1,209 @@
+/*
+ *  vaapidecoder_h265.h - h265 decoder
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef vaapidecoder_h265_h
+#define vaapidecoder_h265_h
+
+#include "codecparsers/h265parser.h"
+#include "nalstreamassembler.h"
+#include "vaapidecoder_base.h"
+#include "vaapidecpicture.h"
+#include "va/va_dec_hevc.h"
+#include <tr1/functional>
+#include <vector>
+
+namespace YamiMediaCodec{
+
+#define H265_NAL_IS_IRAP(type) \
+    ((type) >= H265_NAL_SLICE_BLA_W_LP && (type) <= RESERVED_IRAP_NAL_TYPE_MAX)
+#define H265_NAL_IS_IDR(type) \
+    ((type) == H265_NAL_SLICE_IDR_W_RADL || (type) == H265_NAL_SLICE_IDR_N_LP)
+#define H265_NAL_IS_BLA(type) \
+    ((type) >= H265_NAL_SLICE_BLA_W_LP && (type) <= H265_NAL_SLICE_BLA_N_LP)
+#define H265_NAL_IS_RASL(type) \
+    ((type) == H265_NAL_SLICE_RASL_N || (type) == H265_NAL_SLICE_RASL_R)
+#define H265_NAL_IS_RADL(type) \
+    ((type) == H265_NAL_SLICE_RADL_N || (type) == H265_NAL_SLICE_RADL_R)
+// TRAIL_N, TSA_N, STSA_N, RADL_N, RASL_N and the reserved RSV_VCL_N10/12/14
+#define H265_NAL_IS_SUB_LAYER_NON_REF(type) \
+    ((type) <= 14 && !((type) & 1))
+
+enum {
+    H265_EXTRA_SURFACE_NUMBER = 5,
+    H265_MAX_REFERENCES = 15,
+    // index of a missing entry in VASliceParameterBufferHEVC::RefPicList
+    H265_INVALID_REF_INDEX = 0xff,
+};
+
+/**
+ * \class H265Picture
+ * \brief decoding state of one picture as seen by the DPB
+ * the VA resources are only carried along in m_picture, so the DPB
+ * can be driven without any VA context.
+ */
+class H265Picture
+{
+public:
+    typedef SharedPtr<H265Picture> Ptr;
+    H265Picture();
+
+    VaapiDecoderBase::PicturePtr m_picture;
+    int32_t m_poc;
+    bool m_isReference;
+    bool m_isLongTerm;
+    // PicOutputFlag, "needed for output" once the picture is in the DPB
+    bool m_outputNeeded;
+    uint32_t m_picLatencyCount;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(H265Picture);
+};
+
+/**
+ * \class H265DPB
+ * \brief picture order count, reference picture set and decoded picture buffer
+ * <pre>
+ * 1. startPicture() derives the POC (8.3.1) and the RPS (8.3.2) of a new picture,
+ *    then removes or bumps pictures out of the DPB (C.5.2.2).
+ * 2. initRefPicLists() builds RefPicList0/1 of a slice (8.3.4).
+ * 3. finishPicture() stores the decoded picture and bumps the pictures
+ *    exceeding the reorder or latency limits (C.5.2.3).
+ * pictures leave the DPB in output order through the output callback.
+ *</pre>
+ */
+class H265DPB
+{
+public:
+    typedef H265Picture::Ptr PicturePtr;
+    typedef std::tr1::function<bool (const PicturePtr&)> OutputCallback;
+    typedef std::vector<H265Picture*> RefSet;
+
+    H265DPB(const OutputCallback& output);
+    bool startPicture(const PicturePtr& picture, const H265NalUnit* nalu,
+                      const H265SliceHdr* slice, bool noRaslOutputFlag);
+    bool finishPicture(const PicturePtr& picture);
+    void initRefPicLists(const H265SliceHdr* slice,
+                         H265Picture* refPicList0[H265_MAX_REFERENCES],
+                         H265Picture* refPicList1[H265_MAX_REFERENCES]) const;
+    /// output all pictures and empty the dpb
+    void flush();
+    /// empty the dpb without output
+    void clear();
+
+    // RPS of the current picture, NULL for a missing reference
+    RefSet m_stCurrBefore;
+    RefSet m_stCurrAfter;
+    RefSet m_stFoll;
+    RefSet m_ltCurr;
+    RefSet m_ltFoll;
+
+private:
+    typedef std::vector<PicturePtr> PictureList;
+
+    int32_t calcPoc(const H265NalUnit* nalu, const H265SliceHdr* slice,
+                    bool noRaslOutputFlag);
+    void deriveRps(const PicturePtr& picture, const H265NalUnit* nalu,
+                   const H265SliceHdr* slice, bool noRaslOutputFlag);
+    H265Picture* findPoc(int32_t poc, int32_t mask, bool shortTermOnly) const;
+    void removeUnused();
+    bool needBumping(bool checkFullness) const;
+    bool bump();
+
+    OutputCallback m_output;
+    PictureList m_pictures;
+    int32_t m_prevTid0Poc;
+    // limits of the active SPS, C.5.2.2
+    uint32_t m_maxNumReorder;
+    uint32_t m_maxLatency;
+    uint32_t m_maxDecPicBuffering;
+
+    DISALLOW_COPY_AND_ASSIGN(H265DPB);
+};
+
+class VaapiDecoderH265:public VaapiDecoderBase {
+  public:
+    typedef H265Picture::Ptr PicturePtr;
+    VaapiDecoderH265();
+    virtual ~ VaapiDecoderH265();
+    virtual Decode_Status start(VideoConfigBuffer * buffer);
+    virtual Decode_Status reset(VideoConfigBuffer * buffer);
+    virtual void stop(void);
+    virtual void flush(void);
+    virtual Decode_Status decode(VideoDecodeBuffer * buffer);
+    virtual void flushOutport(void);
+
+  private:
+    Decode_Status decodeNalu(H265NalUnit * nalu);
+    Decode_Status decodeVPS(H265NalUnit * nalu);
+    Decode_Status decodeSPS(H265NalUnit * nalu);
+    Decode_Status decodePPS(H265NalUnit * nalu);
+    Decode_Status decodeSlice(H265NalUnit * nalu);
+    Decode_Status decodeSequenceEnd();
+    Decode_Status startPicture(H265NalUnit * nalu, const H265SliceHdr * slice);
+    Decode_Status decodeCurrentPicture();
+    Decode_Status ensureContext(const H265SPS * sps);
+    bool decodeCodecData(uint8_t * buf, uint32_t bufSize);
+    Decode_Status indexNalUnits(VideoDecodeBuffer * buffer);
+    void decodeStreamTail();
+
+    /* fill vaapi parameters */
+    void fillReference(VAPictureHEVC * ref, const H265Picture * picture,
+                       uint32_t flags);
+    void fillReferences(VAPictureParameterBufferHEVC * param);
+    bool fillPicture(const PicturePtr & picture, const H265NalUnit * nalu,
+                     const H265SliceHdr * slice);
+    bool fillIqMatrix(const PicturePtr & picture, const H265SliceHdr * slice);
+    uint8_t getRefIndex(const H265Picture * ref) const;
+    void fillRefPicList(VASliceParameterBufferHEVC * sliceParam,
+                        const H265SliceHdr * slice);
+    void fillPredWeightTable(VASliceParameterBufferHEVC * sliceParam,
+                             const H265SliceHdr * slice);
+    bool fillSlice(VASliceParameterBufferHEVC * sliceParam,
+                   const H265NalUnit * nalu, const H265SliceHdr * slice);
+    bool outputPicture(const PicturePtr & picture);
+
+    typedef SharedPtr<H265Parser> ParserPtr;
+    ParserPtr m_parser;
+    H265DPB m_dpb;
+    PicturePtr m_current;
+    // slice header of the last independent slice segment
+    H265SliceHdr m_lastSlice;
+    // slice parameters are completed once the next picture starts
+    VASliceParameterBufferHEVC *m_lastSliceParam;
+    // ReferenceFrames[] of the current picture parameters
+    H265Picture *m_refFrames[H265_MAX_REFERENCES];
+    uint32_t m_refFrameCount;
+    // next IRAP picture starts a new coded video sequence
+    bool m_newStream;
+    // NoRaslOutputFlag of the last IRAP picture
+    bool m_noRaslOutputFlag;
+    bool m_gotSPS;
+    bool m_isHEVC;
+    uint32_t m_nalLengthSize;
+    std::vector<H265NalUnit> m_nalIndex;
+    NalUnitSplitter m_splitter;
+
+    static const bool s_registered; // VaapiDecoderFactory registration result
+};
+
+};
+
+#endif
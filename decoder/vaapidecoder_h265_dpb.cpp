@@ -0,0 +1,352 @@
+/*
+ *  vaapidecoder_h265_dpb.cpp - h265 decoded picture buffer
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "common/log.h"
+#include "vaapidecoder_h265.h"
+#include <algorithm>
+
+namespace YamiMediaCodec{
+
+H265Picture::H265Picture()
+    : m_poc(0)
+    , m_isReference(false)
+    , m_isLongTerm(false)
+    , m_outputNeeded(false)
+    , m_picLatencyCount(0)
+{
+}
+
+H265DPB::H265DPB(const OutputCallback& output)
+    : m_output(output)
+    , m_prevTid0Poc(0)
+    , m_maxNumReorder(0)
+    , m_maxLatency(0)
+    , m_maxDecPicBuffering(0)
+{
+}
+
+/* 8.3.1 */
+int32_t H265DPB::calcPoc(const H265NalUnit* nalu, const H265SliceHdr* slice,
+                         bool noRaslOutputFlag)
+{
+    const H265SPS* sps = slice->pps->sps;
+    const int32_t maxPocLsb = 1 << (sps->log2_max_pic_order_cnt_lsb_minus4 + 4);
+    const int32_t pocLsb = slice->pic_order_cnt_lsb;
+    int32_t prevPocLsb, prevPocMsb, pocMsb, poc;
+
+    if (H265_NAL_IS_IRAP(nalu->type) && noRaslOutputFlag) {
+        pocMsb = 0;
+    } else {
+        prevPocLsb = m_prevTid0Poc & (maxPocLsb - 1);
+        prevPocMsb = m_prevTid0Poc - prevPocLsb;
+        if (pocLsb < prevPocLsb && prevPocLsb - pocLsb >= maxPocLsb / 2)
+            pocMsb = prevPocMsb + maxPocLsb;
+        else if (pocLsb > prevPocLsb && pocLsb - prevPocLsb > maxPocLsb / 2)
+            pocMsb = prevPocMsb - maxPocLsb;
+        else
+            pocMsb = prevPocMsb;
+    }
+    poc = pocMsb + pocLsb;
+
+    if (nalu->temporal_id_plus1 == 1
+        && !H265_NAL_IS_RASL(nalu->type)
+        && !H265_NAL_IS_RADL(nalu->type)
+        && !H265_NAL_IS_SUB_LAYER_NON_REF(nalu->type))
+        m_prevTid0Poc = poc;
+    return poc;
+}
+
+H265Picture* H265DPB::findPoc(int32_t poc, int32_t mask, bool shortTermOnly) const
+{
+    for (size_t i = 0; i < m_pictures.size(); i++) {
+        H265Picture* picture = m_pictures[i].get();
+        if (!picture->m_isReference)
+            continue;
+        if (shortTermOnly && picture->m_isLongTerm)
+            continue;
+        if ((picture->m_poc & mask) == (poc & mask))
+            return picture;
+    }
+    return NULL;
+}
+
+/* 8.3.2 */
+void H265DPB::deriveRps(const PicturePtr& picture, const H265NalUnit* nalu,
+                        const H265SliceHdr* slice, bool noRaslOutputFlag)
+{
+    const H265SPS* sps = slice->pps->sps;
+    const H265ShortTermRefPicSet* stRps;
+    const int32_t maxPocLsb = 1 << (sps->log2_max_pic_order_cnt_lsb_minus4 + 4);
+    const int32_t poc = picture->m_poc;
+    int32_t deltaPocMsbCycleLt = 0;
+    uint32_t i, numLongTerm;
+
+    m_stCurrBefore.clear();
+    m_stCurrAfter.clear();
+    m_stFoll.clear();
+    m_ltCurr.clear();
+    m_ltFoll.clear();
+
+    if (H265_NAL_IS_IRAP(nalu->type) && noRaslOutputFlag) {
+        for (i = 0; i < m_pictures.size(); i++)
+            m_pictures[i]->m_isReference = false;
+    }
+    if (H265_NAL_IS_IDR(nalu->type))
+        return;
+
+    // long-term pictures are looked up first, they may still be short-term ones
+    numLongTerm = slice->num_long_term_sps + slice->num_long_term_pics;
+    for (i = 0; i < numLongTerm; i++) {
+        int32_t pocLt, mask = maxPocLsb - 1;
+        bool used;
+
+        if (i < slice->num_long_term_sps) {
+            pocLt = sps->lt_ref_pic_poc_lsb_sps[slice->lt_idx_sps[i]];
+            used = sps->used_by_curr_pic_lt_sps_flag[slice->lt_idx_sps[i]];
+        } else {
+            pocLt = slice->poc_lsb_lt[i];
+            used = slice->used_by_curr_pic_lt_flag[i];
+        }
+        if (i == 0 || i == slice->num_long_term_sps)
+            deltaPocMsbCycleLt = slice->delta_poc_msb_cycle_lt[i];
+        else
+            deltaPocMsbCycleLt += slice->delta_poc_msb_cycle_lt[i];
+
+        if (slice->delta_poc_msb_present_flag[i]) {
+            pocLt += poc - deltaPocMsbCycleLt * maxPocLsb - (poc & (maxPocLsb - 1));
+            mask = -1;
+        }
+        H265Picture* ref = findPoc(pocLt, mask, false);
+        if (ref)
+            ref->m_isLongTerm = true;
+        if (used)
+            m_ltCurr.push_back(ref);
+        else
+            m_ltFoll.push_back(ref);
+    }
+
+    if (slice->short_term_ref_pic_set_sps_flag)
+        stRps = &sps->short_term_ref_pic_set[slice->short_term_ref_pic_set_idx];
+    else
+        stRps = &slice->short_term_ref_pic_sets;
+    for (i = 0; i < stRps->NumNegativePics; i++) {
+        H265Picture* ref = findPoc(poc + stRps->DeltaPocS0[i], -1, true);
+        if (stRps->UsedByCurrPicS0[i])
+            m_stCurrBefore.push_back(ref);
+        else
+            m_stFoll.push_back(ref);
+    }
+    for (i = 0; i < stRps->NumPositivePics; i++) {
+        H265Picture* ref = findPoc(poc + stRps->DeltaPocS1[i], -1, true);
+        if (stRps->UsedByCurrPicS1[i])
+            m_stCurrAfter.push_back(ref);
+        else
+            m_stFoll.push_back(ref);
+    }
+
+    // everything outside the RPS is gone for good
+    for (i = 0; i < m_pictures.size(); i++) {
+        H265Picture* pic = m_pictures[i].get();
+        if (std::count(m_stCurrBefore.begin(), m_stCurrBefore.end(), pic)
+            || std::count(m_stCurrAfter.begin(), m_stCurrAfter.end(), pic)
+            || std::count(m_stFoll.begin(), m_stFoll.end(), pic)
+            || std::count(m_ltCurr.begin(), m_ltCurr.end(), pic)
+            || std::count(m_ltFoll.begin(), m_ltFoll.end(), pic))
+            continue;
+        pic->m_isReference = false;
+    }
+
+    if (std::count(m_stCurrBefore.begin(), m_stCurrBefore.end(), (H265Picture*)NULL)
+        || std::count(m_stCurrAfter.begin(), m_stCurrAfter.end(), (H265Picture*)NULL)
+        || std::count(m_ltCurr.begin(), m_ltCurr.end(), (H265Picture*)NULL))
+        WARNING("reference picture missing for poc %d", poc);
+}
+
+void H265DPB::removeUnused()
+{
+    size_t i = 0;
+    while (i < m_pictures.size()) {
+        const PicturePtr& picture = m_pictures[i];
+        if (!picture->m_outputNeeded && !picture->m_isReference)
+            m_pictures.erase(m_pictures.begin() + i);
+        else
+            i++;
+    }
+}
+
+bool H265DPB::needBumping(bool checkFullness) const
+{
+    uint32_t numOutput = 0;
+    bool latency = false;
+
+    for (size_t i = 0; i < m_pictures.size(); i++) {
+        const H265Picture* picture = m_pictures[i].get();
+        if (!picture->m_outputNeeded)
+            continue;
+        numOutput++;
+        if (m_maxLatency && picture->m_picLatencyCount >= m_maxLatency)
+            latency = true;
+    }
+    if (numOutput > m_maxNumReorder || latency)
+        return true;
+    return checkFullness && m_pictures.size() >= m_maxDecPicBuffering;
+}
+
+/* C.5.2.4, output the picture with the smallest poc */
+bool H265DPB::bump()
+{
+    PicturePtr picture;
+
+    for (size_t i = 0; i < m_pictures.size(); i++) {
+        const PicturePtr& candidate = m_pictures[i];
+        if (candidate->m_outputNeeded
+            && (!picture || candidate->m_poc < picture->m_poc))
+            picture = candidate;
+    }
+    if (!picture)
+        return false;
+
+    picture->m_outputNeeded = false;
+    if (!m_output(picture))
+        ERROR("output picture with poc %d failed", picture->m_poc);
+    removeUnused();
+    return true;
+}
+
+/* C.5.2.2 */
+bool H265DPB::startPicture(const PicturePtr& picture, const H265NalUnit* nalu,
+                           const H265SliceHdr* slice, bool noRaslOutputFlag)
+{
+    const H265SPS* sps = slice->pps->sps;
+    const uint8_t highestTid = sps->max_sub_layers_minus1;
+    const uint32_t latencyIncrease = sps->max_latency_increase_plus1[highestTid];
+
+    picture->m_poc = calcPoc(nalu, slice, noRaslOutputFlag);
+    deriveRps(picture, nalu, slice, noRaslOutputFlag);
+
+    m_maxNumReorder = sps->max_num_reorder_pics[highestTid];
+    m_maxLatency = latencyIncrease ? m_maxNumReorder + latencyIncrease - 1 : 0;
+    m_maxDecPicBuffering = sps->max_dec_pic_buffering_minus1[highestTid] + 1;
+
+    if (H265_NAL_IS_IRAP(nalu->type) && noRaslOutputFlag) {
+        if (slice->no_output_of_prior_pics_flag)
+            clear();
+        else
+            flush();
+        return true;
+    }
+
+    removeUnused();
+    while (needBumping(true)) {
+        // only references left, nothing can be bumped
+        if (!bump())
+            break;
+    }
+    return true;
+}
+
+/* C.5.2.3 */
+bool H265DPB::finishPicture(const PicturePtr& picture)
+{
+    for (size_t i = 0; i < m_pictures.size(); i++) {
+        if (m_pictures[i]->m_outputNeeded)
+            m_pictures[i]->m_picLatencyCount++;
+    }
+
+    picture->m_isReference = true;
+    picture->m_isLongTerm = false;
+    picture->m_picLatencyCount = 0;
+    m_pictures.push_back(picture);
+
+    while (needBumping(false)) {
+        if (!bump())
+            break;
+    }
+    return true;
+}
+
+static void initRefPicList(H265Picture* refPicList[H265_MAX_REFERENCES],
+                           uint32_t numActive,
+                           const H265DPB::RefSet* sets[], uint32_t numSets,
+                           bool modified, const uint32_t listEntry[])
+{
+    // NumRpsCurrTempList is at most 16 for conforming streams
+    H265Picture* temp[32];
+    uint32_t numTemp = 0, numTotal = 0, i, j;
+
+    for (i = 0; i < numSets; i++)
+        numTotal += sets[i]->size();
+    if (numTotal) {
+        const uint32_t size = std::min<uint32_t>(std::max(numActive, numTotal), N_ELEMENTS(temp));
+        while (numTemp < size) {
+            for (i = 0; i < numSets; i++) {
+                for (j = 0; j < sets[i]->size() && numTemp < size; j++)
+                    temp[numTemp++] = (*sets[i])[j];
+            }
+        }
+    }
+
+    for (i = 0; i < H265_MAX_REFERENCES; i++) {
+        uint32_t idx = modified ? listEntry[i] : i;
+        refPicList[i] = (i < numActive && idx < numTemp) ? temp[idx] : NULL;
+    }
+}
+
+/* 8.3.4 */
+void H265DPB::initRefPicLists(const H265SliceHdr* slice,
+                              H265Picture* refPicList0[H265_MAX_REFERENCES],
+                              H265Picture* refPicList1[H265_MAX_REFERENCES]) const
+{
+    const H265RefPicListModification& modification = slice->ref_pic_list_modification;
+    const RefSet* sets0[] = { &m_stCurrBefore, &m_stCurrAfter, &m_ltCurr };
+    const RefSet* sets1[] = { &m_stCurrAfter, &m_stCurrBefore, &m_ltCurr };
+    uint32_t numActive0 = 0, numActive1 = 0;
+
+    if (!H265_IS_I_SLICE(slice))
+        numActive0 = slice->num_ref_idx_l0_active_minus1 + 1;
+    if (H265_IS_B_SLICE(slice))
+        numActive1 = slice->num_ref_idx_l1_active_minus1 + 1;
+
+    initRefPicList(refPicList0, numActive0, sets0, N_ELEMENTS(sets0),
+                   modification.ref_pic_list_modification_flag_l0,
+                   modification.list_entry_l0);
+    initRefPicList(refPicList1, numActive1, sets1, N_ELEMENTS(sets1),
+                   modification.ref_pic_list_modification_flag_l1,
+                   modification.list_entry_l1);
+}
+
+void H265DPB::flush()
+{
+    while (bump())
+        ;
+    clear();
+}
+
+void H265DPB::clear()
+{
+    m_pictures.clear();
+}
+
+}
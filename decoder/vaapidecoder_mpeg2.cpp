@@ -0,0 +1,571 @@
+/*
+ *  vaapidecoder_mpeg2.cpp - mpeg2 decoder
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "common/log.h"
+#include "vaapidecoder_mpeg2.h"
+#include "vaapidecoder_factory.h"
+
+namespace YamiMediaCodec{
+typedef VaapiDecoderMPEG2::PicturePtr PicturePtr;
+
+// size of the start code prefix plus the start code value
+#define MPEG2_START_CODE_SIZE 4
+
+VaapiDecoderMPEG2::VaapiDecoderMPEG2()
+    : m_gotSequenceHdr(false)
+    , m_gotSequenceExt(false)
+    , m_gotScalableExt(false)
+    , m_quantMatrixChanged(false)
+    , m_pictureStarted(false)
+    , m_closedGop(false)
+    , m_brokenLink(false)
+    , m_frameType(0)
+    , m_firstFieldStructure(0)
+{
+    memset(&m_sequenceHdr, 0, sizeof(m_sequenceHdr));
+    memset(&m_sequenceExt, 0, sizeof(m_sequenceExt));
+    memset(&m_scalableExt, 0, sizeof(m_scalableExt));
+    memset(&m_pictureHdr, 0, sizeof(m_pictureHdr));
+    memset(&m_pictureExt, 0, sizeof(m_pictureExt));
+    memset(&m_quantMatrix, 0, sizeof(m_quantMatrix));
+}
+
+VaapiDecoderMPEG2::~VaapiDecoderMPEG2()
+{
+    stop();
+}
+
+Decode_Status VaapiDecoderMPEG2::start(VideoConfigBuffer * buffer)
+{
+    DEBUG("MPEG2: start()");
+
+    buffer->profile = VAProfileMPEG2Main;
+    DEBUG("disable native graphics buffer");
+    buffer->flag &= ~USE_NATIVE_GRAPHIC_BUFFER;
+    m_configBuffer = *buffer;
+    m_configBuffer.data = NULL;
+    m_configBuffer.size = 0;
+
+    // the va context is created with the first picture, see ensureContext()
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderMPEG2::reset(VideoConfigBuffer * buffer)
+{
+    DEBUG("MPEG2: reset()");
+    return VaapiDecoderBase::reset(buffer);
+}
+
+void VaapiDecoderMPEG2::stop(void)
+{
+    DEBUG("MPEG2: stop()");
+    flush();
+    VaapiDecoderBase::stop();
+}
+
+void VaapiDecoderMPEG2::flush(void)
+{
+    DEBUG("MPEG2: flush()");
+    m_current.reset();
+    m_frame.reset();
+    m_firstFieldStructure = 0;
+    m_forward.reset();
+    m_backward.reset();
+    m_pictureStarted = false;
+    m_brokenLink = false;
+    VaapiDecoderBase::flush();
+}
+
+void VaapiDecoderMPEG2::flushOutport(void)
+{
+    // decodeSequenceEnd() outputs the pending anchor picture
+    if (decodeSequenceEnd() != DECODE_SUCCESS)
+        ERROR("fail to decode current picture upon EOS");
+}
+
+Decode_Status VaapiDecoderMPEG2::ensureContext()
+{
+    const int32_t width = m_sequenceHdr.width;
+    const int32_t height = m_sequenceHdr.height;
+    // references plus the picture being decoded
+    const int32_t surfaceNumber = MPEG2_MAX_REFERENCES + 1
+                                  + MPEG2_EXTRA_SURFACE_NUMBER;
+    Decode_Status status;
+
+    if (!m_gotSequenceExt) {
+        ERROR("mpeg-1 stream is not supported");
+        return DECODE_FAIL;
+    }
+    if (m_sequenceExt.chroma_format != MPEG_VIDEO_CHROMA_420) {
+        ERROR("unsupported chroma format %d", m_sequenceExt.chroma_format);
+        return DECODE_FAIL;
+    }
+
+    // only reset va context when there is a larger frame
+    if (m_VAStarted
+        && m_configBuffer.width >= width
+        && m_configBuffer.height >= height) {
+        if (m_videoFormatInfo.width != width
+            || m_videoFormatInfo.height != height) {
+            // notify client of resolution change, no need to reset hw context
+            INFO("frame size changed, orig size %d x %d, new size: %d x %d",
+                 m_videoFormatInfo.width, m_videoFormatInfo.height, width, height);
+            m_videoFormatInfo.width = width;
+            m_videoFormatInfo.height = height;
+            return DECODE_FORMAT_CHANGE;
+        }
+        return DECODE_SUCCESS;
+    }
+
+    INFO("reconfig codec, size %d x %d", width, height);
+    // the last anchor picture is output through the old surface pool,
+    // reconfigure() keeps it until the client has it back
+    decodeSequenceEnd();
+    m_configBuffer.profile = VAProfileMPEG2Main;
+    m_configBuffer.width = width;
+    m_configBuffer.height = height;
+    // a field macroblock covers 32 lines of the frame
+    m_configBuffer.surfaceWidth = ALIGN16(width);
+    m_configBuffer.surfaceHeight = ALIGN32(height);
+    m_configBuffer.surfaceNumber = surfaceNumber;
+    if (m_VAStarted)
+        status = VaapiDecoderBase::reconfigure(&m_configBuffer);
+    else
+        status = VaapiDecoderBase::start(&m_configBuffer);
+    if (status != DECODE_SUCCESS)
+        return status;
+    // a new context knows nothing about the matrices
+    m_quantMatrixChanged = true;
+    return DECODE_FORMAT_CHANGE;
+}
+
+bool VaapiDecoderMPEG2::fillPicture(const PicturePtr& picture, bool isFirstField)
+{
+    VAPictureParameterBufferMPEG2* param;
+
+    if (!picture->editPicture(param))
+        return false;
+
+    param->horizontal_size = m_sequenceHdr.width;
+    param->vertical_size = m_sequenceHdr.height;
+    param->forward_reference_picture = VA_INVALID_SURFACE;
+    param->backward_reference_picture = VA_INVALID_SURFACE;
+    switch (m_pictureHdr.pic_type) {
+    case MPEG_VIDEO_PICTURE_TYPE_B:
+        param->backward_reference_picture = m_backward->getSurfaceID();
+        // a closed gop has nothing before its I picture
+        param->forward_reference_picture = m_forward ?
+            m_forward->getSurfaceID() : m_backward->getSurfaceID();
+        break;
+    case MPEG_VIDEO_PICTURE_TYPE_P:
+        // the P field of an I/P field pair only refers to its first field
+        param->forward_reference_picture = m_forward ?
+            m_forward->getSurfaceID() : picture->getSurfaceID();
+        break;
+    default:
+        break;
+    }
+
+    param->picture_coding_type = m_pictureHdr.pic_type;
+    param->f_code = (m_pictureExt.f_code[0][0] << 12)
+                    | (m_pictureExt.f_code[0][1] << 8)
+                    | (m_pictureExt.f_code[1][0] << 4)
+                    | m_pictureExt.f_code[1][1];
+
+#define FILL_PIC_EXT(field) \
+    param->picture_coding_extension.bits.field = m_pictureExt.field;
+    FILL_PIC_EXT(intra_dc_precision)
+    FILL_PIC_EXT(picture_structure)
+    FILL_PIC_EXT(top_field_first)
+    FILL_PIC_EXT(frame_pred_frame_dct)
+    FILL_PIC_EXT(concealment_motion_vectors)
+    FILL_PIC_EXT(q_scale_type)
+    FILL_PIC_EXT(intra_vlc_format)
+    FILL_PIC_EXT(alternate_scan)
+    FILL_PIC_EXT(repeat_first_field)
+    FILL_PIC_EXT(progressive_frame)
+#undef FILL_PIC_EXT
+    param->picture_coding_extension.bits.is_first_field = isFirstField;
+    return true;
+}
+
+bool VaapiDecoderMPEG2::fillIqMatrix(const PicturePtr& picture)
+{
+    VAIQMatrixBufferMPEG2* iqMatrix;
+
+    // the driver keeps the matrices of the context until new ones are sent
+    if (!m_quantMatrixChanged)
+        return true;
+    if (!picture->editIqMatrix(iqMatrix))
+        return false;
+
+#define FILL_MATRIX(matrix) \
+    do { \
+        iqMatrix->load_##matrix = m_quantMatrix.load_##matrix; \
+        memcpy(iqMatrix->matrix, m_quantMatrix.matrix, sizeof(iqMatrix->matrix)); \
+    } while (0)
+    // both sides use zigzag scan order
+    FILL_MATRIX(intra_quantiser_matrix);
+    FILL_MATRIX(non_intra_quantiser_matrix);
+    FILL_MATRIX(chroma_intra_quantiser_matrix);
+    FILL_MATRIX(chroma_non_intra_quantiser_matrix);
+#undef FILL_MATRIX
+    m_quantMatrixChanged = false;
+    return true;
+}
+
+bool VaapiDecoderMPEG2::fillSlice(const PicturePtr& picture,
+                                  const MpegVideoPacket* packet,
+                                  const MpegVideoSliceHdr* slice)
+{
+    VASliceParameterBufferMPEG2* sliceParam;
+
+    // the driver wants the slice start code too
+    if (!picture->newSlice(sliceParam,
+                           packet->data + packet->offset - MPEG2_START_CODE_SIZE,
+                           packet->size + MPEG2_START_CODE_SIZE))
+        return false;
+    sliceParam->macroblock_offset = slice->header_size + MPEG2_START_CODE_SIZE * 8;
+    sliceParam->slice_horizontal_position = slice->mb_column;
+    sliceParam->slice_vertical_position = slice->mb_row;
+    sliceParam->quantiser_scale_code = slice->quantiser_scale_code;
+    sliceParam->intra_slice_flag = slice->intra_slice;
+    return true;
+}
+
+void VaapiDecoderMPEG2::finishFrame()
+{
+    if (!m_frame)
+        return;
+    // anchor pictures wait for the next anchor, see startPicture()
+    if (m_frameType == MPEG_VIDEO_PICTURE_TYPE_B)
+        outputPicture(m_frame);
+    m_frame.reset();
+    m_firstFieldStructure = 0;
+}
+
+Decode_Status VaapiDecoderMPEG2::decodeCurrentPicture()
+{
+    PicturePtr picture = m_current;
+
+    if (!picture)
+        return DECODE_SUCCESS;
+    m_current.reset();
+
+    if (!picture->decode()) {
+        ERROR("decode picture failed, type %d", m_pictureHdr.pic_type);
+        return DECODE_FAIL;
+    }
+    if (m_pictureExt.picture_structure != MPEG_VIDEO_PICTURE_STRUCTURE_FRAME
+        && !m_firstFieldStructure) {
+        m_firstFieldStructure = m_pictureExt.picture_structure;
+        return DECODE_SUCCESS;
+    }
+    finishFrame();
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderMPEG2::startPicture()
+{
+    const uint8_t structure = m_pictureExt.picture_structure;
+    const uint8_t type = m_pictureHdr.pic_type;
+    bool isFirstField = true;
+    Decode_Status status;
+
+    // client resends the buffer on format change, so no state is updated before this
+    status = ensureContext();
+    if (status != DECODE_SUCCESS)
+        return status;
+    m_pictureStarted = false;
+
+    if (!structure) {
+        WARNING("skip picture without picture coding extension");
+        return DECODE_SUCCESS;
+    }
+
+    if (m_frame && m_firstFieldStructure
+        && structure != MPEG_VIDEO_PICTURE_STRUCTURE_FRAME
+        && structure != m_firstFieldStructure) {
+        // second field, decoded into the surface of the first one
+        m_current = createPicture(m_frame->getSurface(), m_frame->m_timeStamp);
+        isFirstField = false;
+    } else {
+        if (m_frame) {
+            WARNING("second field is missing");
+            finishFrame();
+        }
+        if ((type == MPEG_VIDEO_PICTURE_TYPE_P && !m_backward)
+            || (type == MPEG_VIDEO_PICTURE_TYPE_B
+                && (!m_backward || (!m_forward && !m_closedGop)))) {
+            DEBUG("skip picture type %d without reference", type);
+            return DECODE_SUCCESS;
+        }
+
+        PicturePtr picture = createPicture(m_currentPTS);
+        if (!picture) {
+            ERROR("no surface available");
+            return DECODE_MEMORY_FAIL;
+        }
+        if (type != MPEG_VIDEO_PICTURE_TYPE_B) {
+            // B pictures in front of this one are all out
+            if (m_backward)
+                outputPicture(m_backward);
+            m_forward = m_backward;
+            m_backward = picture;
+            if (type == MPEG_VIDEO_PICTURE_TYPE_I && m_brokenLink) {
+                m_forward.reset();
+                m_brokenLink = false;
+            }
+        }
+        m_frame = picture;
+        m_frameType = type;
+        m_current = picture;
+    }
+
+    if (!fillPicture(m_current, isFirstField) || !fillIqMatrix(m_current))
+        return DECODE_FAIL;
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderMPEG2::decodeSlice(const MpegVideoPacket * packet)
+{
+    MpegVideoSliceHdr slice;
+    Decode_Status status;
+
+    // the picture is skipped or its header was lost
+    if (!m_current && !m_pictureStarted)
+        return DECODE_SUCCESS;
+
+    memset(&slice, 0, sizeof(slice));
+    if (!mpeg_video_packet_parse_slice_header(packet, &slice, &m_sequenceHdr,
+            m_gotScalableExt ? &m_scalableExt : NULL))
+        return DECODE_PARSER_FAIL;
+
+    if (!m_current) {
+        status = startPicture();
+        if (status != DECODE_SUCCESS)
+            return status;
+        if (!m_current)
+            return DECODE_SUCCESS;
+    }
+    if (!fillSlice(m_current, packet, &slice))
+        return DECODE_FAIL;
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderMPEG2::decodePicture(const MpegVideoPacket * packet)
+{
+    Decode_Status status = decodeCurrentPicture();
+
+    m_pictureStarted = false;
+    if (status != DECODE_SUCCESS)
+        return status;
+    if (!m_gotSequenceHdr) {
+        DEBUG("skip picture before the first sequence header");
+        return DECODE_SUCCESS;
+    }
+    if (!mpeg_video_packet_parse_picture_header(packet, &m_pictureHdr))
+        return DECODE_PARSER_FAIL;
+    if (m_pictureHdr.pic_type > MPEG_VIDEO_PICTURE_TYPE_B) {
+        WARNING("skip picture type %d", m_pictureHdr.pic_type);
+        return DECODE_SUCCESS;
+    }
+    // filled by the picture coding extension
+    memset(&m_pictureExt, 0, sizeof(m_pictureExt));
+    m_pictureStarted = true;
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderMPEG2::decodeSequence(const MpegVideoPacket * packet)
+{
+    Decode_Status status = decodeCurrentPicture();
+
+    if (status != DECODE_SUCCESS)
+        return status;
+    if (!mpeg_video_packet_parse_sequence_header(packet, &m_sequenceHdr))
+        return DECODE_PARSER_FAIL;
+    m_gotSequenceHdr = true;
+    m_gotSequenceExt = false;
+    m_gotScalableExt = false;
+
+    // a sequence header resets all the matrices, chroma uses the luma ones
+    memset(&m_quantMatrix, 0, sizeof(m_quantMatrix));
+    m_quantMatrix.load_intra_quantiser_matrix = 1;
+    m_quantMatrix.load_non_intra_quantiser_matrix = 1;
+    m_quantMatrix.load_chroma_intra_quantiser_matrix = 1;
+    m_quantMatrix.load_chroma_non_intra_quantiser_matrix = 1;
+    memcpy(m_quantMatrix.intra_quantiser_matrix,
+           m_sequenceHdr.intra_quantizer_matrix, 64);
+    memcpy(m_quantMatrix.non_intra_quantiser_matrix,
+           m_sequenceHdr.non_intra_quantizer_matrix, 64);
+    memcpy(m_quantMatrix.chroma_intra_quantiser_matrix,
+           m_sequenceHdr.intra_quantizer_matrix, 64);
+    memcpy(m_quantMatrix.chroma_non_intra_quantiser_matrix,
+           m_sequenceHdr.non_intra_quantizer_matrix, 64);
+    m_quantMatrixChanged = true;
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderMPEG2::decodeExtension(const MpegVideoPacket * packet)
+{
+    MpegVideoQuantMatrixExt quant;
+
+    if (packet->size < 1 || !m_gotSequenceHdr)
+        return DECODE_SUCCESS;
+
+    switch (packet->data[packet->offset] >> 4) {
+    case MPEG_VIDEO_PACKET_EXT_SEQUENCE:
+        if (!mpeg_video_packet_parse_sequence_extension(packet, &m_sequenceExt))
+            return DECODE_PARSER_FAIL;
+        // only adds the size extension bits, so a resent buffer does no harm
+        mpeg_video_finalise_mpeg2_sequence_header(&m_sequenceHdr, &m_sequenceExt, NULL);
+        m_gotSequenceExt = true;
+        break;
+    case MPEG_VIDEO_PACKET_EXT_SEQUENCE_SCALABLE:
+        if (!mpeg_video_packet_parse_sequence_scalable_extension(packet, &m_scalableExt))
+            return DECODE_PARSER_FAIL;
+        m_gotScalableExt = true;
+        break;
+    case MPEG_VIDEO_PACKET_EXT_QUANT_MATRIX:
+        memset(&quant, 0, sizeof(quant));
+        if (!mpeg_video_packet_parse_quant_matrix_extension(packet, &quant))
+            return DECODE_PARSER_FAIL;
+        // a luma matrix replaces the chroma one as well, 6.3.11
+        if (quant.load_intra_quantiser_matrix) {
+            memcpy(m_quantMatrix.intra_quantiser_matrix,
+                   quant.intra_quantiser_matrix, 64);
+            memcpy(m_quantMatrix.chroma_intra_quantiser_matrix,
+                   quant.intra_quantiser_matrix, 64);
+        }
+        if (quant.load_non_intra_quantiser_matrix) {
+            memcpy(m_quantMatrix.non_intra_quantiser_matrix,
+                   quant.non_intra_quantiser_matrix, 64);
+            memcpy(m_quantMatrix.chroma_non_intra_quantiser_matrix,
+                   quant.non_intra_quantiser_matrix, 64);
+        }
+        if (quant.load_chroma_intra_quantiser_matrix)
+            memcpy(m_quantMatrix.chroma_intra_quantiser_matrix,
+                   quant.chroma_intra_quantiser_matrix, 64);
+        if (quant.load_chroma_non_intra_quantiser_matrix)
+            memcpy(m_quantMatrix.chroma_non_intra_quantiser_matrix,
+                   quant.chroma_non_intra_quantiser_matrix, 64);
+        m_quantMatrixChanged = true;
+        break;
+    case MPEG_VIDEO_PACKET_EXT_PICTURE:
+        if (!m_pictureStarted)
+            break;
+        if (!mpeg_video_packet_parse_picture_extension(packet, &m_pictureExt))
+            return DECODE_PARSER_FAIL;
+        break;
+    default:
+        break;
+    }
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderMPEG2::decodeGOP(const MpegVideoPacket * packet)
+{
+    MpegVideoGop gop;
+    Decode_Status status = decodeCurrentPicture();
+
+    if (status != DECODE_SUCCESS)
+        return status;
+    memset(&gop, 0, sizeof(gop));
+    if (!mpeg_video_packet_parse_gop(packet, &gop))
+        return DECODE_PARSER_FAIL;
+    m_closedGop = gop.closed_gop;
+    if (gop.broken_link)
+        m_brokenLink = true;
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderMPEG2::decodeSequenceEnd()
+{
+    Decode_Status status = decodeCurrentPicture();
+
+    finishFrame();
+    if (m_backward)
+        outputPicture(m_backward);
+    m_forward.reset();
+    m_backward.reset();
+    return status;
+}
+
+Decode_Status VaapiDecoderMPEG2::decodePacket(const MpegVideoPacket * packet)
+{
+    switch (packet->type) {
+    case MPEG_VIDEO_PACKET_PICTURE:
+        return decodePicture(packet);
+    case MPEG_VIDEO_PACKET_SEQUENCE:
+        return decodeSequence(packet);
+    case MPEG_VIDEO_PACKET_EXTENSION:
+        return decodeExtension(packet);
+    case MPEG_VIDEO_PACKET_GOP:
+        return decodeGOP(packet);
+    case MPEG_VIDEO_PACKET_SEQUENCE_END:
+        return decodeSequenceEnd();
+    default:
+        break;
+    }
+    if (MPEG_VIDEO_PACKET_IS_SLICE(packet->type))
+        return decodeSlice(packet);
+    DEBUG("skip packet type 0x%x", packet->type);
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderMPEG2::decode(VideoDecodeBuffer * buffer)
+{
+    MpegVideoPacket packet;
+    uint32_t offset = 0;
+    Decode_Status status;
+
+    m_currentPTS = buffer->timeStamp;
+
+    DEBUG("MPEG2: Decode(bufsize =%d, timestamp=%ld)", buffer->size, m_currentPTS);
+    if (buffer->data == NULL && buffer->size == 0) { // got EOS
+        INFO("flush-debug got EOS, set all frames output-able");
+        flushOutport();
+        return DECODE_SUCCESS;
+    }
+
+    // a picture ends with the next picture, gop or sequence header,
+    // so the input may be split at any start code
+    while (mpeg_video_parse(&packet, buffer->data, buffer->size, offset)) {
+        if (packet.size < 0)
+            packet.size = buffer->size - packet.offset;
+        status = decodePacket(&packet);
+        if (status != DECODE_SUCCESS)
+            return status;
+        offset = packet.offset + packet.size;
+    }
+    return DECODE_SUCCESS;
+}
+
+const bool VaapiDecoderMPEG2::s_registered =
+    VaapiDecoderFactory::register_<VaapiDecoderMPEG2>(YAMI_MIME_MPEG2);
+
+}
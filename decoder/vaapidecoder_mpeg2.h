@@ -0,0 +1,113 @@
+/*
+ *  vaapidecoder_mpeg2.h - mpeg2 decoder
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef vaapidecoder_mpeg2_h
+#define vaapidecoder_mpeg2_h
+
+#include "codecparsers/mpegvideoparser.h"
+#include "vaapidecoder_base.h"
+#include "vaapidecpicture.h"
+
+namespace YamiMediaCodec{
+
+enum {
+    // forward and backward anchor
+    MPEG2_MAX_REFERENCES = 2,
+    MPEG2_EXTRA_SURFACE_NUMBER = 5,
+};
+
+/**
+ * \class VaapiDecoderMPEG2
+ * \brief mpeg2 video decoder
+ * <pre>
+ * a picture is sent to the driver once the next picture, sequence or gop
+ * header shows up, so the input may be split at any start code.
+ * the two fields of a field picture pair are decoded into one surface.
+ * I and P pictures are held back until the next I or P picture arrives,
+ * B pictures are output as soon as they are complete.
+ *</pre>
+ */
+class VaapiDecoderMPEG2:public VaapiDecoderBase {
+  public:
+    typedef SharedPtr<VaapiDecPicture> PicturePtr;
+    VaapiDecoderMPEG2();
+    virtual ~ VaapiDecoderMPEG2();
+    virtual Decode_Status start(VideoConfigBuffer * buffer);
+    virtual Decode_Status reset(VideoConfigBuffer * buffer);
+    virtual void stop(void);
+    virtual void flush(void);
+    virtual Decode_Status decode(VideoDecodeBuffer * buffer);
+    virtual void flushOutport(void);
+
+  private:
+    Decode_Status decodePacket(const MpegVideoPacket * packet);
+    Decode_Status decodeSequence(const MpegVideoPacket * packet);
+    Decode_Status decodeExtension(const MpegVideoPacket * packet);
+    Decode_Status decodeGOP(const MpegVideoPacket * packet);
+    Decode_Status decodePicture(const MpegVideoPacket * packet);
+    Decode_Status decodeSlice(const MpegVideoPacket * packet);
+    Decode_Status decodeSequenceEnd();
+    Decode_Status startPicture();
+    Decode_Status decodeCurrentPicture();
+    Decode_Status ensureContext();
+    void finishFrame();
+
+    /* fill vaapi parameters */
+    bool fillPicture(const PicturePtr & picture, bool isFirstField);
+    bool fillIqMatrix(const PicturePtr & picture);
+    bool fillSlice(const PicturePtr & picture, const MpegVideoPacket * packet,
+                   const MpegVideoSliceHdr * slice);
+
+    MpegVideoSequenceHdr m_sequenceHdr;
+    MpegVideoSequenceExt m_sequenceExt;
+    MpegVideoSequenceScalableExt m_scalableExt;
+    MpegVideoPictureHdr m_pictureHdr;
+    MpegVideoPictureExt m_pictureExt;
+    // quantiser matrices in effect, in zigzag scan order
+    MpegVideoQuantMatrixExt m_quantMatrix;
+    bool m_gotSequenceHdr;
+    bool m_gotSequenceExt;
+    bool m_gotScalableExt;
+    bool m_quantMatrixChanged;
+    // slices of the current picture header are expected
+    bool m_pictureStarted;
+    // B pictures of a closed gop may only refer to the following anchor
+    bool m_closedGop;
+    // B pictures after the next I picture miss their forward reference
+    bool m_brokenLink;
+
+    // picture being filled, either a frame or a field
+    PicturePtr m_current;
+    // frame the current picture belongs to, waits for its second field
+    PicturePtr m_frame;
+    uint8_t m_frameType;
+    // structure of the field decoded into m_frame, 0 for none
+    uint8_t m_firstFieldStructure;
+    // anchor pictures, m_backward is the latest one and not output yet
+    PicturePtr m_forward;
+    PicturePtr m_backward;
+
+    static const bool s_registered; // VaapiDecoderFactory registration result
+};
+
+};
+
+#endif
@@ -0,0 +1,924 @@
+/*
+ *  vaapidecoder_vc1.cpp - vc1 decoder
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "common/log.h"
+#include "vaapidecoder_vc1.h"
+#include "vaapidecoder_factory.h"
+#include "vaapi/vaapiimage.h"
+#include "vaapi/vaapisurface.h"
+
+namespace YamiMediaCodec{
+typedef VaapiDecoderVC1::PicturePtr PicturePtr;
+
+// size of the start code prefix plus the BDU type
+#define VC1_START_CODE_SIZE 4
+
+static VAProfile getProfile(VC1Profile profile)
+{
+    switch (profile) {
+    case VC1_PROFILE_SIMPLE:
+        return VAProfileVC1Simple;
+    case VC1_PROFILE_MAIN:
+        return VAProfileVC1Main;
+    default:
+        break;
+    }
+    return VAProfileVC1Advanced;
+}
+
+// VA numbers picture types in coding order, the parser does not
+static uint8_t getPictureType(uint8_t ptype)
+{
+    switch (ptype) {
+    case VC1_PICTURE_TYPE_I:
+        return 0;
+    case VC1_PICTURE_TYPE_P:
+        return 1;
+    case VC1_PICTURE_TYPE_B:
+        return 2;
+    case VC1_PICTURE_TYPE_BI:
+        return 3;
+    default:
+        break;
+    }
+    // skipped P picture
+    return 4;
+}
+
+static uint8_t getMvMode(uint8_t mvmode)
+{
+    static const uint8_t vaMvMode[] = {
+        VAMvMode1MvHalfPelBilinear, // VC1_MVMODE_1MV_HPEL_BILINEAR
+        VAMvMode1Mv,                // VC1_MVMODE_1MV
+        VAMvMode1MvHalfPel,         // VC1_MVMODE_1MV_HPEL
+        VAMvModeMixedMv,            // VC1_MVMODE_MIXED_MV
+        VAMvModeIntensityCompensation, // VC1_MVMODE_INTENSITY_COMP
+    };
+
+    if (mvmode >= N_ELEMENTS(vaMvMode))
+        return VAMvMode1Mv;
+    return vaMvMode[mvmode];
+}
+
+// BFRACTION code of table 40, the parser keeps the fraction itself
+static uint8_t getBFraction(uint16_t bfraction)
+{
+    static const uint16_t fractions[] = {
+        VC1_BFRACTION_BASIS / 2, VC1_BFRACTION_BASIS / 3,
+        (VC1_BFRACTION_BASIS * 2) / 3, VC1_BFRACTION_BASIS / 4,
+        (VC1_BFRACTION_BASIS * 3) / 4, VC1_BFRACTION_BASIS / 5,
+        (VC1_BFRACTION_BASIS * 2) / 5, (VC1_BFRACTION_BASIS * 3) / 5,
+        (VC1_BFRACTION_BASIS * 4) / 5, VC1_BFRACTION_BASIS / 6,
+        (VC1_BFRACTION_BASIS * 5) / 6, VC1_BFRACTION_BASIS / 7,
+        (VC1_BFRACTION_BASIS * 2) / 7, (VC1_BFRACTION_BASIS * 3) / 7,
+        (VC1_BFRACTION_BASIS * 4) / 7, (VC1_BFRACTION_BASIS * 5) / 7,
+        (VC1_BFRACTION_BASIS * 6) / 7, VC1_BFRACTION_BASIS / 8,
+        (VC1_BFRACTION_BASIS * 3) / 8, (VC1_BFRACTION_BASIS * 5) / 8,
+        (VC1_BFRACTION_BASIS * 7) / 8, VC1_BFRACTION_RESERVED,
+        VC1_BFRACTION_PTYPE_BI,
+    };
+
+    if (!bfraction)
+        return 0;
+    for (uint8_t i = 0; i < N_ELEMENTS(fractions); i++) {
+        if (fractions[i] == bfraction)
+            return i;
+    }
+    // reserved
+    return 21;
+}
+
+VaapiDecoderVC1::VaapiDecoderVC1()
+    : m_width(0)
+    , m_height(0)
+    , m_gotSequenceHdr(false)
+    , m_gotEntryPoint(false)
+    , m_closedEntry(false)
+    , m_brokenLink(false)
+    , m_rndCtrl(0)
+    , m_currentType(VC1_PICTURE_TYPE_I)
+{
+    m_bitPlanes.reset(vc1_bitplanes_new(), vc1_bitplanes_free);
+    memset(&m_sequenceHdr, 0, sizeof(m_sequenceHdr));
+    memset(&m_frameHdr, 0, sizeof(m_frameHdr));
+}
+
+VaapiDecoderVC1::~VaapiDecoderVC1()
+{
+    stop();
+}
+
+Decode_Status VaapiDecoderVC1::start(VideoConfigBuffer * buffer)
+{
+    DEBUG("VC1: start()");
+
+    buffer->profile = VAProfileVC1Advanced;
+    DEBUG("disable native graphics buffer");
+    buffer->flag &= ~USE_NATIVE_GRAPHIC_BUFFER;
+    m_configBuffer = *buffer;
+    m_configBuffer.data = NULL;
+    m_configBuffer.size = 0;
+
+    // the va context is created with the first picture, see ensureContext()
+    if (buffer->data && buffer->size) {
+        if (!decodeCodecData(buffer->data, buffer->size)) {
+            ERROR("codec data has some error");
+            return DECODE_FAIL;
+        }
+    }
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderVC1::reset(VideoConfigBuffer * buffer)
+{
+    DEBUG("VC1: reset()");
+    return VaapiDecoderBase::reset(buffer);
+}
+
+void VaapiDecoderVC1::stop(void)
+{
+    DEBUG("VC1: stop()");
+    flush();
+    m_repeatImage.reset();
+    VaapiDecoderBase::stop();
+}
+
+void VaapiDecoderVC1::flush(void)
+{
+    DEBUG("VC1: flush()");
+    m_current.reset();
+    m_forward.reset();
+    m_backward.reset();
+    m_brokenLink = false;
+    VaapiDecoderBase::flush();
+}
+
+void VaapiDecoderVC1::flushOutport(void)
+{
+    // decodeSequenceEnd() outputs the pending anchor picture
+    if (decodeSequenceEnd() != DECODE_SUCCESS)
+        ERROR("fail to decode current picture upon EOS");
+}
+
+Decode_Status VaapiDecoderVC1::ensureContext()
+{
+    const VAProfile profile = getProfile(m_sequenceHdr.profile);
+    // references plus the picture being decoded
+    const int32_t surfaceNumber = VC1_MAX_REFERENCES + 1
+                                  + VC1_EXTRA_SURFACE_NUMBER;
+    const int32_t width = m_width;
+    const int32_t height = m_height;
+    Decode_Status status;
+
+    // only reset va context when there is a larger frame
+    if (m_VAStarted
+        && m_configBuffer.profile == profile
+        && m_configBuffer.width >= width
+        && m_configBuffer.height >= height) {
+        if (m_videoFormatInfo.width != width
+            || m_videoFormatInfo.height != height) {
+            // notify client of resolution change, no need to reset hw context
+            INFO("frame size changed, orig size %d x %d, new size: %d x %d",
+                 m_videoFormatInfo.width, m_videoFormatInfo.height, width, height);
+            m_videoFormatInfo.width = width;
+            m_videoFormatInfo.height = height;
+            return DECODE_FORMAT_CHANGE;
+        }
+        return DECODE_SUCCESS;
+    }
+
+    INFO("reconfig codec, profile %d, size %d x %d", m_sequenceHdr.profile, width, height);
+    // the last anchor picture is output through the old surface pool,
+    // reconfigure() keeps it until the client has it back
+    decodeSequenceEnd();
+    m_configBuffer.profile = profile;
+    m_configBuffer.width = width;
+    m_configBuffer.height = height;
+    m_configBuffer.surfaceWidth = ALIGN16(width);
+    m_configBuffer.surfaceHeight = ALIGN16(height);
+    m_configBuffer.surfaceNumber = surfaceNumber;
+    if (m_VAStarted)
+        status = VaapiDecoderBase::reconfigure(&m_configBuffer);
+    else
+        status = VaapiDecoderBase::start(&m_configBuffer);
+    if (status != DECODE_SUCCESS)
+        return status;
+    return DECODE_FORMAT_CHANGE;
+}
+
+bool VaapiDecoderVC1::ensureBitPlanes(uint32_t width, uint32_t height)
+{
+    if (!width || !height) {
+        ERROR("unknown coded size");
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+    // the parser leaves this to us for simple and main profile
+    m_sequenceHdr.mb_width = (width + 15) >> 4;
+    m_sequenceHdr.mb_height = (height + 15) >> 4;
+    m_sequenceHdr.mb_stride = m_sequenceHdr.mb_width + 1;
+    return vc1_bitplanes_ensure_size(m_bitPlanes.get(), &m_sequenceHdr);
+}
+
+const uint8_t* VaapiDecoderVC1::unescape(const uint8_t* data, uint32_t size,
+                                         uint32_t& rbduSize)
+{
+    uint32_t zeros = 0;
+
+    rbduSize = 0;
+    if (!size)
+        return NULL;
+    // 0x03 following two zero bytes is dropped when a byte below 4 comes next
+    m_rbdu.resize(size);
+    for (uint32_t i = 0; i < size; i++) {
+        if (zeros >= 2 && data[i] == 0x03
+            && (i + 1 == size || data[i + 1] <= 0x03)) {
+            zeros = 0;
+            continue;
+        }
+        zeros = data[i] ? 0 : zeros + 1;
+        m_rbdu[rbduSize++] = data[i];
+    }
+    return &m_rbdu[0];
+}
+
+// a bitplane is only sent when it is coded in the picture header
+// instead of the macroblock layer
+static bool hasMvTypeMbBitPlane(const VC1SeqHdr* seq, const VC1FrameHdr* frame)
+{
+    uint8_t mvmode, mvmode2;
+
+    if (frame->ptype != VC1_PICTURE_TYPE_P)
+        return false;
+    if (seq->profile == VC1_PROFILE_ADVANCED) {
+        const VC1PicAdvanced* pic = &frame->pic.advanced;
+        if (pic->fcm != VC1_FRAME_PROGRESSIVE || pic->mvtypemb)
+            return false;
+        mvmode = pic->mvmode;
+        mvmode2 = pic->mvmode2;
+    } else {
+        const VC1PicSimpleMain* pic = &frame->pic.simple;
+        if (pic->mvtypemb)
+            return false;
+        mvmode = pic->mvmode;
+        mvmode2 = pic->mvmode2;
+    }
+    return mvmode == VC1_MVMODE_MIXED_MV
+           || (mvmode == VC1_MVMODE_INTENSITY_COMP && mvmode2 == VC1_MVMODE_MIXED_MV);
+}
+
+static bool hasSkipMbBitPlane(const VC1SeqHdr* seq, const VC1FrameHdr* frame)
+{
+    if (frame->ptype != VC1_PICTURE_TYPE_P && frame->ptype != VC1_PICTURE_TYPE_B)
+        return false;
+    if (seq->profile == VC1_PROFILE_ADVANCED)
+        return !frame->pic.advanced.skipmb;
+    return !frame->pic.simple.skipmb;
+}
+
+static bool hasDirectMbBitPlane(const VC1SeqHdr* seq, const VC1FrameHdr* frame)
+{
+    if (frame->ptype != VC1_PICTURE_TYPE_B)
+        return false;
+    if (seq->profile == VC1_PROFILE_ADVANCED)
+        return !frame->pic.advanced.directmb;
+    return !frame->pic.simple.directmb;
+}
+
+static bool hasFieldTxBitPlane(const VC1SeqHdr* seq, const VC1FrameHdr* frame)
+{
+    const VC1PicAdvanced* pic = &frame->pic.advanced;
+
+    if (seq->profile != VC1_PROFILE_ADVANCED)
+        return false;
+    if (frame->ptype != VC1_PICTURE_TYPE_I && frame->ptype != VC1_PICTURE_TYPE_BI)
+        return false;
+    return pic->fcm == VC1_FRAME_INTERLACE && !pic->fieldtx;
+}
+
+static bool hasAcPredBitPlane(const VC1SeqHdr* seq, const VC1FrameHdr* frame)
+{
+    if (seq->profile != VC1_PROFILE_ADVANCED)
+        return false;
+    if (frame->ptype != VC1_PICTURE_TYPE_I && frame->ptype != VC1_PICTURE_TYPE_BI)
+        return false;
+    return !frame->pic.advanced.acpred;
+}
+
+static bool hasOverFlagsBitPlane(const VC1SeqHdr* seq, const VC1FrameHdr* frame)
+{
+    const VC1PicAdvanced* pic = &frame->pic.advanced;
+
+    if (seq->profile != VC1_PROFILE_ADVANCED)
+        return false;
+    if (frame->ptype != VC1_PICTURE_TYPE_I && frame->ptype != VC1_PICTURE_TYPE_BI)
+        return false;
+    return seq->advanced.entrypoint.overlap && frame->pquant <= 8
+           && pic->condover == VC1_CONDOVER_SELECT && !pic->overflags;
+}
+
+void VaapiDecoderVC1::fillPictureStructC(VAPictureParameterBufferVC1* param)
+{
+    const VC1SeqStructC* structc = &m_sequenceHdr.struct_c;
+    const VC1PicSimpleMain* pic = &m_frameHdr.pic.simple;
+
+    param->sequence_fields.bits.finterpflag = structc->finterpflag;
+    param->sequence_fields.bits.multires = structc->multires;
+    param->sequence_fields.bits.overlap = structc->overlap;
+    param->sequence_fields.bits.syncmarker = structc->syncmarker;
+    param->sequence_fields.bits.rangered = structc->rangered;
+    param->sequence_fields.bits.max_b_frames = structc->maxbframes;
+    param->fast_uvmc_flag = structc->fastuvmc;
+
+    param->b_picture_fraction = getBFraction(pic->bfraction);
+    param->cbp_table = pic->cbptab;
+    param->range_reduction_frame = pic->rangeredfrm;
+    param->picture_resolution_index = pic->respic;
+    param->luma_scale = pic->lumscale;
+    param->luma_shift = pic->lumshift;
+
+    // 8.3.7, reset by I and BI pictures and toggled by P pictures
+    if (m_frameHdr.ptype == VC1_PICTURE_TYPE_I || m_frameHdr.ptype == VC1_PICTURE_TYPE_BI)
+        m_rndCtrl = 1;
+    else if (m_frameHdr.ptype == VC1_PICTURE_TYPE_P)
+        m_rndCtrl ^= 1;
+    param->rounding_control = m_rndCtrl;
+
+    param->raw_coding.flags.mv_type_mb = pic->mvtypemb;
+    param->raw_coding.flags.direct_mb = pic->directmb;
+    param->raw_coding.flags.skip_mb = pic->skipmb;
+
+    if (m_frameHdr.ptype == VC1_PICTURE_TYPE_P || m_frameHdr.ptype == VC1_PICTURE_TYPE_B) {
+        param->mv_fields.bits.mv_mode = getMvMode(pic->mvmode);
+        if (pic->mvmode == VC1_MVMODE_INTENSITY_COMP) {
+            param->mv_fields.bits.mv_mode2 = getMvMode(pic->mvmode2);
+            param->picture_fields.bits.intensity_compensation = 1;
+        }
+    }
+    param->mv_fields.bits.mv_table = pic->mvtab;
+    param->mv_fields.bits.extended_mv_flag = structc->extended_mv;
+    param->mv_fields.bits.extended_mv_range = pic->mvrange;
+
+    param->pic_quantizer_fields.bits.dquant = structc->dquant;
+    param->pic_quantizer_fields.bits.quantizer = structc->quantizer;
+
+    param->transform_fields.bits.variable_sized_transform_flag = structc->vstransform;
+    param->transform_fields.bits.mb_level_transform_type_flag = pic->ttmbf;
+    param->transform_fields.bits.frame_level_transform_type = pic->ttfrm;
+    param->transform_fields.bits.transform_ac_codingset_idx2 = pic->transacfrm2;
+}
+
+void VaapiDecoderVC1::fillPictureAdvanced(VAPictureParameterBufferVC1* param)
+{
+    const VC1AdvancedSeqHdr* advanced = &m_sequenceHdr.advanced;
+    const VC1EntryPointHdr* entry = &advanced->entrypoint;
+    const VC1PicAdvanced* pic = &m_frameHdr.pic.advanced;
+    const bool progressive = pic->fcm == VC1_FRAME_PROGRESSIVE;
+
+    param->sequence_fields.bits.pulldown = advanced->pulldown;
+    param->sequence_fields.bits.interlace = advanced->interlace;
+    param->sequence_fields.bits.tfcntrflag = advanced->tfcntrflag;
+    param->sequence_fields.bits.finterpflag = advanced->finterpflag;
+    param->sequence_fields.bits.psf = advanced->psf;
+    param->sequence_fields.bits.overlap = entry->overlap;
+
+    param->entrypoint_fields.bits.broken_link = entry->broken_link;
+    param->entrypoint_fields.bits.closed_entry = entry->closed_entry;
+    param->entrypoint_fields.bits.panscan_flag = entry->panscan_flag;
+    param->entrypoint_fields.bits.loopfilter = entry->loopfilter;
+    param->conditional_overlap_flag = pic->condover;
+    param->fast_uvmc_flag = entry->fastuvmc;
+    param->range_mapping_fields.bits.luma_flag = entry->range_mapy_flag;
+    param->range_mapping_fields.bits.luma = entry->range_mapy;
+    param->range_mapping_fields.bits.chroma_flag = entry->range_mapuv_flag;
+    param->range_mapping_fields.bits.chroma = entry->range_mapuv;
+
+    param->b_picture_fraction = getBFraction(pic->bfraction);
+    // interlaced frames use their own vlc tables
+    param->cbp_table = progressive ? pic->cbptab : pic->icbptab;
+    param->mb_mode_table = pic->mbmodetab;
+    param->rounding_control = pic->rndctrl;
+    param->post_processing = pic->postproc;
+    param->luma_scale = pic->lumscale;
+    param->luma_shift = pic->lumshift;
+
+    param->picture_fields.bits.frame_coding_mode = pic->fcm;
+    param->picture_fields.bits.top_field_first = pic->tff;
+    param->picture_fields.bits.is_first_field = 1;
+
+    param->raw_coding.flags.mv_type_mb = pic->mvtypemb;
+    param->raw_coding.flags.direct_mb = pic->directmb;
+    param->raw_coding.flags.skip_mb = pic->skipmb;
+    param->raw_coding.flags.field_tx = pic->fieldtx;
+    param->raw_coding.flags.ac_pred = pic->acpred;
+    param->raw_coding.flags.overflags = pic->overflags;
+
+    param->reference_fields.bits.reference_distance_flag = entry->refdist_flag;
+
+    if (m_frameHdr.ptype == VC1_PICTURE_TYPE_P || m_frameHdr.ptype == VC1_PICTURE_TYPE_B) {
+        if (progressive) {
+            param->mv_fields.bits.mv_mode = getMvMode(pic->mvmode);
+            if (pic->mvmode == VC1_MVMODE_INTENSITY_COMP) {
+                param->mv_fields.bits.mv_mode2 = getMvMode(pic->mvmode2);
+                param->picture_fields.bits.intensity_compensation = 1;
+            }
+        } else {
+            param->picture_fields.bits.intensity_compensation = pic->intcomp;
+        }
+    }
+    param->mv_fields.bits.mv_table = progressive ? pic->mvtab : pic->imvtab;
+    param->mv_fields.bits.two_mv_block_pattern_table = pic->mvbptab2;
+    param->mv_fields.bits.four_mv_switch = pic->mvswitch4;
+    param->mv_fields.bits.four_mv_block_pattern_table = pic->mvbptab4;
+    param->mv_fields.bits.extended_mv_flag = entry->extended_mv;
+    param->mv_fields.bits.extended_mv_range = pic->mvrange;
+    param->mv_fields.bits.extended_dmv_flag = entry->extended_dmv;
+    param->mv_fields.bits.extended_dmv_range = pic->dmvrange;
+
+    param->pic_quantizer_fields.bits.dquant = entry->dquant;
+    param->pic_quantizer_fields.bits.quantizer = entry->quantizer;
+
+    param->transform_fields.bits.variable_sized_transform_flag = entry->vstransform;
+    param->transform_fields.bits.mb_level_transform_type_flag = pic->ttmbf;
+    param->transform_fields.bits.frame_level_transform_type = pic->ttfrm;
+    param->transform_fields.bits.transform_ac_codingset_idx2 = pic->transacfrm2;
+}
+
+bool VaapiDecoderVC1::fillPicture(const PicturePtr& picture)
+{
+    const VC1VopDquant* dquant = &m_frameHdr.vopdquant;
+    VAPictureParameterBufferVC1* param;
+
+    if (!picture->editPicture(param))
+        return false;
+
+    param->forward_reference_picture = VA_INVALID_SURFACE;
+    param->backward_reference_picture = VA_INVALID_SURFACE;
+    param->inloop_decoded_picture = VA_INVALID_SURFACE;
+    switch (m_frameHdr.ptype) {
+    case VC1_PICTURE_TYPE_B:
+        param->backward_reference_picture = m_backward->getSurfaceID();
+        // a closed entry point has nothing before its I picture
+        param->forward_reference_picture = m_forward ?
+            m_forward->getSurfaceID() : m_backward->getSurfaceID();
+        break;
+    case VC1_PICTURE_TYPE_P:
+        param->forward_reference_picture = m_forward->getSurfaceID();
+        break;
+    default:
+        break;
+    }
+
+    param->sequence_fields.bits.profile = m_sequenceHdr.profile;
+    param->coded_width = m_width;
+    param->coded_height = m_height;
+    param->picture_fields.bits.picture_type = getPictureType(m_frameHdr.ptype);
+
+    param->pic_quantizer_fields.bits.half_qp = m_frameHdr.halfqp;
+    param->pic_quantizer_fields.bits.pic_quantizer_scale = m_frameHdr.pquant;
+    param->pic_quantizer_fields.bits.pic_quantizer_type = m_frameHdr.pquantizer;
+    param->pic_quantizer_fields.bits.dq_frame = dquant->dquantfrm;
+    param->pic_quantizer_fields.bits.dq_profile = dquant->dqprofile;
+    if (dquant->dqprofile == VC1_DQPROFILE_SINGLE_EDGE)
+        param->pic_quantizer_fields.bits.dq_sb_edge = dquant->dqbedge;
+    else if (dquant->dqprofile == VC1_DQPROFILE_DOUBLE_EDGES)
+        param->pic_quantizer_fields.bits.dq_db_edge = dquant->dqbedge;
+    param->pic_quantizer_fields.bits.dq_binary_level = dquant->dqbilevel;
+    param->pic_quantizer_fields.bits.alt_pic_quantizer = dquant->altpquant;
+
+    param->transform_fields.bits.transform_ac_codingset_idx1 = m_frameHdr.transacfrm;
+    param->transform_fields.bits.intra_transform_dc_table = m_frameHdr.transdctab;
+
+    if (m_sequenceHdr.profile == VC1_PROFILE_ADVANCED)
+        fillPictureAdvanced(param);
+    else
+        fillPictureStructC(param);
+
+    param->bitplane_present.flags.bp_mv_type_mb = hasMvTypeMbBitPlane(&m_sequenceHdr, &m_frameHdr);
+    param->bitplane_present.flags.bp_direct_mb = hasDirectMbBitPlane(&m_sequenceHdr, &m_frameHdr);
+    param->bitplane_present.flags.bp_skip_mb = hasSkipMbBitPlane(&m_sequenceHdr, &m_frameHdr);
+    param->bitplane_present.flags.bp_field_tx = hasFieldTxBitPlane(&m_sequenceHdr, &m_frameHdr);
+    param->bitplane_present.flags.bp_ac_pred = hasAcPredBitPlane(&m_sequenceHdr, &m_frameHdr);
+    param->bitplane_present.flags.bp_overflags = hasOverFlagsBitPlane(&m_sequenceHdr, &m_frameHdr);
+    return fillBitPlane(picture, param);
+}
+
+bool VaapiDecoderVC1::fillBitPlane(const PicturePtr& picture,
+                                   const VAPictureParameterBufferVC1* param)
+{
+    const VC1BitPlanes* bitPlanes = m_bitPlanes.get();
+    const uint8_t* planes[3] = { NULL, NULL, NULL };
+    const uint32_t stride = m_sequenceHdr.mb_stride;
+    uint8_t* data;
+    uint32_t n = 0;
+
+    if (!param->bitplane_present.value)
+        return true;
+
+#define BITPLANE(present, plane) \
+    (param->bitplane_present.flags.present ? bitPlanes->plane : NULL)
+    // three bits per macroblock, see the VA bitplane buffer layout
+    switch (m_frameHdr.ptype) {
+    case VC1_PICTURE_TYPE_I:
+    case VC1_PICTURE_TYPE_BI:
+        planes[0] = BITPLANE(bp_field_tx, fieldtx);
+        planes[1] = BITPLANE(bp_ac_pred, acpred);
+        planes[2] = BITPLANE(bp_overflags, overflags);
+        break;
+    case VC1_PICTURE_TYPE_P:
+        planes[0] = BITPLANE(bp_direct_mb, directmb);
+        planes[1] = BITPLANE(bp_skip_mb, skipmb);
+        planes[2] = BITPLANE(bp_mv_type_mb, mvtypemb);
+        break;
+    case VC1_PICTURE_TYPE_B:
+        planes[0] = BITPLANE(bp_direct_mb, directmb);
+        planes[1] = BITPLANE(bp_skip_mb, skipmb);
+        planes[2] = BITPLANE(bp_forward_mb, forwardmb);
+        break;
+    default:
+        break;
+    }
+#undef BITPLANE
+
+    if (!picture->editBitPlane(data, (m_sequenceHdr.mb_width * m_sequenceHdr.mb_height + 1) / 2))
+        return false;
+    // two macroblocks per byte, drivers read the first one from the high nibble
+    for (uint32_t y = 0; y < m_sequenceHdr.mb_height; y++) {
+        for (uint32_t x = 0; x < m_sequenceHdr.mb_width; x++, n++) {
+            const uint32_t src = y * stride + x;
+            uint8_t v = 0;
+            if (planes[0])
+                v |= planes[0][src];
+            if (planes[1])
+                v |= planes[1][src] << 1;
+            if (planes[2])
+                v |= planes[2][src] << 2;
+            data[n / 2] = (data[n / 2] << 4) | v;
+        }
+    }
+    if (n & 1)
+        data[n / 2] <<= 4;
+    return true;
+}
+
+bool VaapiDecoderVC1::fillSlice(const PicturePtr& picture, const uint8_t* data,
+                                uint32_t size, uint32_t macroblockOffset,
+                                uint32_t verticalPosition)
+{
+    VASliceParameterBufferVC1* sliceParam;
+
+    if (!picture->newSlice(sliceParam, data, size))
+        return false;
+    // in bits of the unescaped data, the driver skips emulation prevention bytes
+    sliceParam->macroblock_offset = macroblockOffset;
+    sliceParam->slice_vertical_position = verticalPosition;
+    return true;
+}
+
+Decode_Status VaapiDecoderVC1::decodeCurrentPicture()
+{
+    PicturePtr picture = m_current;
+
+    if (!picture)
+        return DECODE_SUCCESS;
+    m_current.reset();
+
+    if (!picture->decode()) {
+        ERROR("decode picture failed, type %d", m_currentType);
+        return DECODE_FAIL;
+    }
+    // anchor pictures wait for the next anchor, see decodeFrame()
+    if (m_currentType == VC1_PICTURE_TYPE_B || m_currentType == VC1_PICTURE_TYPE_BI)
+        outputPicture(picture);
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderVC1::decodeFrame(const uint8_t* data, uint32_t size,
+                                           uint32_t startCodeSize)
+{
+    const bool advanced = m_sequenceHdr.profile == VC1_PROFILE_ADVANCED;
+    const uint8_t* rbdu = data + startCodeSize;
+    uint32_t rbduSize = size - startCodeSize;
+    Decode_Status status;
+    uint8_t type;
+
+    status = decodeCurrentPicture();
+    if (status != DECODE_SUCCESS)
+        return status;
+    if (!m_gotSequenceHdr || (advanced && !m_gotEntryPoint)) {
+        DEBUG("skip frame before the sequence header or entry point");
+        return DECODE_SUCCESS;
+    }
+
+    memset(&m_frameHdr, 0, sizeof(m_frameHdr));
+    if (!advanced && rbduSize <= 1) {
+        // simple and main profile code skipped frames as empty ones
+        m_frameHdr.ptype = VC1_PICTURE_TYPE_SKIPPED;
+    } else {
+        if (advanced)
+            rbdu = unescape(rbdu, rbduSize, rbduSize);
+        if (!rbdu)
+            return DECODE_PARSER_FAIL;
+        if (vc1_parse_frame_header(rbdu, rbduSize, &m_frameHdr, &m_sequenceHdr,
+                                   m_bitPlanes.get()) != VC1_PARSER_OK)
+            return DECODE_PARSER_FAIL;
+        if (advanced && m_frameHdr.pic.advanced.fcm == VC1_FIELD_INTERLACE) {
+            WARNING("skip field interlaced frame");
+            return DECODE_SUCCESS;
+        }
+    }
+
+    // client resends the buffer on format change, so no state is updated before this
+    status = ensureContext();
+    if (status != DECODE_SUCCESS)
+        return status;
+
+    type = m_frameHdr.ptype;
+    if (((type == VC1_PICTURE_TYPE_P || type == VC1_PICTURE_TYPE_SKIPPED) && !m_backward)
+        || (type == VC1_PICTURE_TYPE_B
+            && (!m_backward || (!m_forward && !m_closedEntry)))) {
+        DEBUG("skip picture type %d without reference", type);
+        return DECODE_SUCCESS;
+    }
+
+    PicturePtr picture = createPicture(m_currentPTS);
+    if (!picture) {
+        ERROR("no surface available");
+        return DECODE_MEMORY_FAIL;
+    }
+    if (type != VC1_PICTURE_TYPE_B && type != VC1_PICTURE_TYPE_BI) {
+        // B pictures in front of this one are all out
+        outputPicture(m_backward);
+        m_forward = m_backward;
+        m_backward = picture;
+        if (type == VC1_PICTURE_TYPE_I && m_brokenLink) {
+            m_forward.reset();
+            m_brokenLink = false;
+        }
+    }
+    // nothing to decode, the copy is the new anchor
+    if (type == VC1_PICTURE_TYPE_SKIPPED)
+        return repeatPicture(picture, m_forward) ? DECODE_SUCCESS : DECODE_FAIL;
+
+    if (!fillPicture(picture))
+        return DECODE_FAIL;
+    if (!fillSlice(picture, data, size, startCodeSize * 8 + m_frameHdr.header_size, 0))
+        return DECODE_FAIL;
+    m_current = picture;
+    m_currentType = type;
+    return DECODE_SUCCESS;
+}
+
+/* a skipped P picture repeats the previous anchor. the surface pool can not
+ * output one surface twice, so the anchor is copied into the new surface */
+bool VaapiDecoderVC1::repeatPicture(const PicturePtr& picture, const PicturePtr& anchor)
+{
+    SurfacePtr src = anchor->getSurface();
+    SurfacePtr dest = picture->getSurface();
+    uint32_t width = src->getWidth();
+    uint32_t height = src->getHeight();
+
+    if (!m_repeatImage || m_repeatImage->getWidth() != width
+        || m_repeatImage->getHeight() != height) {
+        m_repeatImage = VaapiImage::create(m_display, VA_FOURCC_NV12, width, height);
+        if (!m_repeatImage) {
+            ERROR("no image to repeat the anchor picture");
+            return false;
+        }
+    }
+    // vaGetImage() waits for the anchor to be decoded
+    if (!src->getImage(m_repeatImage) || !dest->putImage(m_repeatImage)) {
+        ERROR("repeat anchor picture failed");
+        return false;
+    }
+    return true;
+}
+
+Decode_Status VaapiDecoderVC1::decodeSlice(const uint8_t* data, uint32_t size)
+{
+    VC1SliceHdr slice;
+    const uint8_t* rbdu;
+    uint32_t rbduSize;
+
+    // the picture is skipped or its frame header was lost
+    if (!m_current)
+        return DECODE_SUCCESS;
+
+    rbdu = unescape(data + VC1_START_CODE_SIZE, size - VC1_START_CODE_SIZE, rbduSize);
+    if (!rbdu)
+        return DECODE_PARSER_FAIL;
+    memset(&slice, 0, sizeof(slice));
+    if (vc1_parse_slice_header(rbdu, rbduSize, &slice, &m_sequenceHdr) != VC1_PARSER_OK)
+        return DECODE_PARSER_FAIL;
+    if (!fillSlice(m_current, data, size,
+                   VC1_START_CODE_SIZE * 8 + slice.header_size, slice.slice_addr))
+        return DECODE_FAIL;
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderVC1::decodeSequence(const uint8_t* data, uint32_t size)
+{
+    const uint8_t* rbdu;
+    uint32_t rbduSize;
+    Decode_Status status = decodeCurrentPicture();
+
+    if (status != DECODE_SUCCESS)
+        return status;
+    rbdu = unescape(data, size, rbduSize);
+    memset(&m_sequenceHdr, 0, sizeof(m_sequenceHdr));
+    m_gotSequenceHdr = false;
+    m_gotEntryPoint = false;
+    if (!rbdu)
+        return DECODE_PARSER_FAIL;
+    if (vc1_parse_sequence_header(rbdu, rbduSize, &m_sequenceHdr) != VC1_PARSER_OK)
+        return DECODE_PARSER_FAIL;
+    if (m_sequenceHdr.profile != VC1_PROFILE_ADVANCED) {
+        ERROR("sequence layer of profile %d is not supported", m_sequenceHdr.profile);
+        return DECODE_FAIL;
+    }
+    if (!ensureBitPlanes(m_sequenceHdr.advanced.max_coded_width,
+                         m_sequenceHdr.advanced.max_coded_height))
+        return DECODE_FAIL;
+    m_gotSequenceHdr = true;
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderVC1::decodeEntryPoint(const uint8_t* data, uint32_t size)
+{
+    VC1EntryPointHdr entry;
+    const uint8_t* rbdu;
+    uint32_t rbduSize;
+    Decode_Status status = decodeCurrentPicture();
+
+    if (status != DECODE_SUCCESS)
+        return status;
+    if (!m_gotSequenceHdr) {
+        DEBUG("skip entry point before the sequence header");
+        return DECODE_SUCCESS;
+    }
+    rbdu = unescape(data, size, rbduSize);
+    if (!rbdu)
+        return DECODE_PARSER_FAIL;
+    memset(&entry, 0, sizeof(entry));
+    if (vc1_parse_entry_point_header(rbdu, rbduSize, &entry, &m_sequenceHdr) != VC1_PARSER_OK)
+        return DECODE_PARSER_FAIL;
+    if (entry.coded_size_flag) {
+        if (!ensureBitPlanes(entry.coded_width, entry.coded_height))
+            return DECODE_FAIL;
+    }
+    m_closedEntry = entry.closed_entry;
+    if (entry.broken_link)
+        m_brokenLink = true;
+    m_gotEntryPoint = true;
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderVC1::decodeSequenceEnd()
+{
+    Decode_Status status = decodeCurrentPicture();
+
+    if (m_backward)
+        outputPicture(m_backward);
+    m_forward.reset();
+    m_backward.reset();
+    return status;
+}
+
+Decode_Status VaapiDecoderVC1::decodeBDU(const VC1BDU* bdu)
+{
+    const uint8_t* data = bdu->data + bdu->offset;
+
+    switch (bdu->type) {
+    case VC1_SEQUENCE:
+        return decodeSequence(data, bdu->size);
+    case VC1_ENTRYPOINT:
+        return decodeEntryPoint(data, bdu->size);
+    case VC1_FRAME:
+        return decodeFrame(data - VC1_START_CODE_SIZE, bdu->size + VC1_START_CODE_SIZE,
+                           VC1_START_CODE_SIZE);
+    case VC1_SLICE:
+        return decodeSlice(data - VC1_START_CODE_SIZE, bdu->size + VC1_START_CODE_SIZE);
+    case VC1_END_OF_SEQ:
+        return decodeSequenceEnd();
+    case VC1_FIELD:
+        // second field of a field interlaced frame, which is skipped
+        break;
+    default:
+        DEBUG("skip bdu type 0x%x", bdu->type);
+        break;
+    }
+    return DECODE_SUCCESS;
+}
+
+Decode_Status VaapiDecoderVC1::decodeBDUs(const uint8_t* data, uint32_t size)
+{
+    VC1BDU bdu;
+    VC1ParserResult result;
+    uint32_t offset = 0;
+    Decode_Status status;
+
+    while (offset < size) {
+        result = vc1_identify_next_bdu(data + offset, size - offset, &bdu);
+        if (result == VC1_PARSER_NO_BDU_END)
+            bdu.size = size - offset - bdu.offset;
+        else if (result != VC1_PARSER_OK)
+            break;
+        // containers may strip the start code of a frame
+        if (!offset && bdu.sc_offset) {
+            status = decodeFrame(data, bdu.sc_offset, 0);
+            if (status != DECODE_SUCCESS)
+                return status;
+        }
+        status = decodeBDU(&bdu);
+        if (status != DECODE_SUCCESS)
+            return status;
+        offset += bdu.offset + bdu.size;
+    }
+    if (!offset && size)
+        return decodeFrame(data, size, 0);
+    return DECODE_SUCCESS;
+}
+
+bool VaapiDecoderVC1::decodeCodecData(const uint8_t* data, uint32_t size)
+{
+    VC1BDU bdu;
+    VC1ParserResult result;
+
+    // advanced profile codec data carries sequence and entry point BDUs
+    result = vc1_identify_next_bdu(data, size, &bdu);
+    if (result == VC1_PARSER_OK || result == VC1_PARSER_NO_BDU_END)
+        return decodeBDUs(data, size) == DECODE_SUCCESS && m_gotSequenceHdr;
+
+    // STRUCT_C of simple and main profile, the size comes from the container
+    memset(&m_sequenceHdr, 0, sizeof(m_sequenceHdr));
+    if (vc1_parse_sequence_header_struct_c(data, size, &m_sequenceHdr.struct_c) != VC1_PARSER_OK)
+        return false;
+    m_sequenceHdr.profile = m_sequenceHdr.struct_c.profile;
+    if (m_sequenceHdr.profile != VC1_PROFILE_SIMPLE
+        && m_sequenceHdr.profile != VC1_PROFILE_MAIN) {
+        ERROR("unsupported profile %d", m_sequenceHdr.profile);
+        return false;
+    }
+    if (m_sequenceHdr.struct_c.wmvp) {
+        if (!ensureBitPlanes(m_sequenceHdr.struct_c.coded_width,
+                             m_sequenceHdr.struct_c.coded_height))
+            return false;
+    } else if (!ensureBitPlanes(m_configBuffer.width, m_configBuffer.height)) {
+        return false;
+    }
+    m_gotSequenceHdr = true;
+    return true;
+}
+
+Decode_Status VaapiDecoderVC1::decode(VideoDecodeBuffer * buffer)
+{
+    Decode_Status status;
+
+    m_currentPTS = buffer->timeStamp;
+
+    DEBUG("VC1: Decode(bufsize =%d, timestamp=%ld)", buffer->size, m_currentPTS);
+    if (buffer->data == NULL && buffer->size == 0) { // got EOS
+        INFO("flush-debug got EOS, set all frames output-able");
+        flushOutport();
+        return DECODE_SUCCESS;
+    }
+
+    if (!m_gotSequenceHdr || m_sequenceHdr.profile == VC1_PROFILE_ADVANCED)
+        return decodeBDUs(buffer->data, buffer->size);
+
+    // one frame per buffer, without any start code
+    status = decodeFrame(buffer->data, buffer->size, 0);
+    if (status != DECODE_SUCCESS)
+        return status;
+    return decodeCurrentPicture();
+}
+
+const bool VaapiDecoderVC1::s_registered =
+    VaapiDecoderFactory::register_<VaapiDecoderVC1>(YAMI_MIME_VC1);
+
+}
@@ -0,0 +1,123 @@
+/*
+ *  vaapidecoder_vc1.h - vc1 decoder
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef vaapidecoder_vc1_h
+#define vaapidecoder_vc1_h
+
+#include "codecparsers/vc1parser.h"
+#include "vaapidecoder_base.h"
+#include "vaapidecpicture.h"
+#include <vector>
+
+namespace YamiMediaCodec{
+
+enum {
+    // forward and backward anchor
+    VC1_MAX_REFERENCES = 2,
+    VC1_EXTRA_SURFACE_NUMBER = 5,
+};
+
+/**
+ * \class VaapiDecoderVC1
+ * \brief vc1 decoder for simple, main and advanced profile
+ * <pre>
+ * simple and main profile streams need the STRUCT_C sequence header as
+ * codec data and carry one frame per buffer.
+ * advanced profile streams are split into bitstream data units (BDUs) by
+ * their start codes, a picture is sent to the driver once the next frame,
+ * sequence or entry point BDU arrives.
+ * I and P pictures are held back until the next I or P picture arrives,
+ * B and BI pictures are output as soon as they are decoded.
+ * a skipped P picture is a copy of the previous anchor and becomes the new anchor.
+ *</pre>
+ */
+class VaapiDecoderVC1:public VaapiDecoderBase {
+  public:
+    typedef SharedPtr<VaapiDecPicture> PicturePtr;
+    VaapiDecoderVC1();
+    virtual ~ VaapiDecoderVC1();
+    virtual Decode_Status start(VideoConfigBuffer * buffer);
+    virtual Decode_Status reset(VideoConfigBuffer * buffer);
+    virtual void stop(void);
+    virtual void flush(void);
+    virtual Decode_Status decode(VideoDecodeBuffer * buffer);
+    virtual void flushOutport(void);
+
+  private:
+    bool decodeCodecData(const uint8_t * data, uint32_t size);
+    Decode_Status decodeBDUs(const uint8_t * data, uint32_t size);
+    Decode_Status decodeBDU(const VC1BDU * bdu);
+    Decode_Status decodeSequence(const uint8_t * data, uint32_t size);
+    Decode_Status decodeEntryPoint(const uint8_t * data, uint32_t size);
+    Decode_Status decodeFrame(const uint8_t * data, uint32_t size,
+                              uint32_t startCodeSize);
+    Decode_Status decodeSlice(const uint8_t * data, uint32_t size);
+    Decode_Status decodeSequenceEnd();
+    Decode_Status decodeCurrentPicture();
+    bool repeatPicture(const PicturePtr & picture, const PicturePtr & anchor);
+    Decode_Status ensureContext();
+    bool ensureBitPlanes(uint32_t width, uint32_t height);
+    /// drops emulation prevention bytes, NULL for an empty BDU
+    const uint8_t *unescape(const uint8_t * data, uint32_t size,
+                            uint32_t & rbduSize);
+
+    /* fill vaapi parameters */
+    void fillPictureStructC(VAPictureParameterBufferVC1 * param);
+    void fillPictureAdvanced(VAPictureParameterBufferVC1 * param);
+    bool fillPicture(const PicturePtr & picture);
+    bool fillBitPlane(const PicturePtr & picture,
+                      const VAPictureParameterBufferVC1 * param);
+    bool fillSlice(const PicturePtr & picture, const uint8_t * data,
+                   uint32_t size, uint32_t macroblockOffset,
+                   uint32_t verticalPosition);
+
+    typedef SharedPtr<VC1BitPlanes> BitPlanesPtr;
+    BitPlanesPtr m_bitPlanes;
+    VC1SeqHdr m_sequenceHdr;
+    VC1FrameHdr m_frameHdr;
+    // coded size of the pictures
+    uint32_t m_width;
+    uint32_t m_height;
+    bool m_gotSequenceHdr;
+    bool m_gotEntryPoint;
+    // B pictures of a closed entry point may only refer to the following anchor
+    bool m_closedEntry;
+    // B pictures after the next I picture miss their forward reference
+    bool m_brokenLink;
+    // rounding control of simple and main profile, 8.3.7
+    uint8_t m_rndCtrl;
+    // advanced profile headers without emulation prevention bytes
+    std::vector<uint8_t> m_rbdu;
+
+    PicturePtr m_current;
+    uint8_t m_currentType;
+    // anchor pictures, m_backward is the latest one and not output yet
+    PicturePtr m_forward;
+    PicturePtr m_backward;
+    // copies the anchor into the surface of a skipped picture
+    ImagePtr m_repeatImage;
+
+    static const bool s_registered; // VaapiDecoderFactory registration result
+};
+
+};
+
+#endif
@@ -112,12 +112,13 @@ Decode_Status VaapiDecoderVP8::ensureContext()
             m_configBuffer.graphicBufferHeight = m_configBuffer.height;
         }
 
-        if (m_hasContext)
-            status = VaapiDecoderBase::terminateVA();
-        m_hasContext = false;
-
-        if (status != DECODE_SUCCESS)
-            return status;
+        if (m_hasContext) {
+            // surfaces which are big enough are kept
+            status = VaapiDecoderBase::reconfigure(&m_configBuffer);
+            if (status != DECODE_SUCCESS)
+                return status;
+            return DECODE_FORMAT_CHANGE;
+        }
     } else if (m_videoFormatInfo.width != m_frameHdr.width
         || m_videoFormatInfo.height != m_frameHdr.height) {
         // notify client of resolution change, no need to reset hw context
@@ -334,6 +335,16 @@ bool VaapiDecoderVP8::ensureProbabilityTable(const PicturePtr&  pic)
     return true;
 }
 
+bool VaapiDecoderVP8::isReferenceFrame()
+{
+    return m_frameHdr.key_frame
+        || m_frameHdr.refresh_last
+        || m_frameHdr.refresh_golden_frame
+        || m_frameHdr.refresh_alternate_frame
+        || m_frameHdr.copy_buffer_to_golden
+        || m_frameHdr.copy_buffer_to_alternate;
+}
+
 void VaapiDecoderVP8::updateReferencePictures()
 {
     const PicturePtr& picture = m_currentPicture;
@@ -557,6 +568,10 @@ Decode_Status VaapiDecoderVP8::decode(VideoDecodeBuffer * buffer)
             break;
         }
 
+        // bit 0 of the frame tag is 0 for key frames, skip the others before the header parse
+        if ((m_configBuffer.flag & WANT_KEY_FRAMES_ONLY) && (m_buffer[0] & 0x01))
+            return DECODE_SUCCESS;
+
         memset(&m_frameHdr, 0, sizeof(m_frameHdr));
         result =
             vp8_parser_parse_frame_header(&m_parser, &m_frameHdr, m_buffer, m_frameSize);
@@ -569,6 +584,9 @@ Decode_Status VaapiDecoderVP8::decode(VideoDecodeBuffer * buffer)
             status = ensureContext();
             if (status != DECODE_SUCCESS)
                 return status;
+        } else if ((m_configBuffer.flag & WANT_SKIP_NON_REFERENCE) && !isReferenceFrame()) {
+            // the parser kept its probabilities, nothing else depends on this frame
+            return DECODE_SUCCESS;
         }
 #if __PSB_CACHE_DRAIN_FOR_FIRST_FRAME__
         int ii = 0;
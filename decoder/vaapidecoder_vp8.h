@@ -64,6 +64,7 @@ class VaapiDecoderVP8:public VaapiDecoderBase {
     Decode_Status ensureContext();
     /* decoding functions */
     Decode_Status decodePicture();
+    bool isReferenceFrame();
     void updateReferencePictures();
   private:
     PicturePtr m_currentPicture;
@@ -94,14 +94,12 @@ Decode_Status VaapiDecoderVP9::ensureContext(const Vp9FrameHdr* hdr)
         || m_configBuffer.height <  hdr->height) {
         INFO("frame size changed, reconfig codec. orig size %d x %d, new size: %d x %d",
                 m_configBuffer.width, m_configBuffer.height, hdr->width, hdr->height);
-        Decode_Status status = VaapiDecoderBase::terminateVA();
-        if (status != DECODE_SUCCESS)
-            return status;
         m_configBuffer.width = hdr->width;
         m_configBuffer.height = hdr->height;
         m_configBuffer.surfaceWidth = ALIGN8(hdr->width);
         m_configBuffer.surfaceHeight = ALIGN32(hdr->height);
-        status = VaapiDecoderBase::start(&m_configBuffer);
+        // surfaces which are big enough are kept
+        Decode_Status status = VaapiDecoderBase::reconfigure(&m_configBuffer);
         if (status != DECODE_SUCCESS)
             return status;
         return DECODE_FORMAT_CHANGE;
@@ -279,6 +277,17 @@ Decode_Status VaapiDecoderVP9::decode(const Vp9FrameHdr* hdr, const uint8_t* dat
     return DECODE_SUCCESS;
 }
 
+bool VaapiDecoderVP9::isSkippedFrame(const Vp9FrameHdr* hdr)
+{
+    if (m_configBuffer.flag & WANT_KEY_FRAMES_ONLY)
+        return hdr->show_existing_frame || hdr->frame_type != VP9_KEY_FRAME;
+    // the driver keeps the probability contexts, so a frame refreshing one is a reference too
+    if (m_configBuffer.flag & WANT_SKIP_NON_REFERENCE)
+        return !hdr->show_existing_frame && hdr->frame_type != VP9_KEY_FRAME
+            && !hdr->refresh_frame_flags && !hdr->refresh_frame_context;
+    return false;
+}
+
 static bool parse_super_frame(std::vector<uint32_t>& frameSize, const uint8_t* data, const int32_t size)
 {
     if (!data || !size)
@@ -341,6 +350,9 @@ Decode_Status VaapiDecoderVP9::decode(const uint8_t* data, uint32_t size, uint64
         return DECODE_INVALID_DATA;
     if (hdr.first_partition_size + hdr.frame_header_length_in_bytes > size)
         return DECODE_INVALID_DATA;
+    // the parser always sees the header, it keeps loop filter and segmentation state across frames
+    if (isSkippedFrame(&hdr))
+        return DECODE_SUCCESS;
     return decode(&hdr, data, size, timeStamp);
 }
 
@@ -49,6 +49,7 @@ class VaapiDecoderVP9:public VaapiDecoderBase {
     Decode_Status ensureContext(const Vp9FrameHdr* );
     Decode_Status decode(const uint8_t* data, uint32_t size, uint64_t timeStamp);
     Decode_Status decode(const Vp9FrameHdr* hdr, const uint8_t* data, uint32_t size, uint64_t timeStamp);
+    bool isSkippedFrame(const Vp9FrameHdr* hdr);
     bool ensureSlice(const PicturePtr& , const void* data, int size);
     bool ensurePicture(const PicturePtr& , const Vp9FrameHdr* );
     //reference related
@@ -26,14 +26,58 @@
 #include "vaapidecpicture.h"
 
 #include "log.h"
+#include <string.h>
 
 namespace YamiMediaCodec{
 VaapiDecPicture::VaapiDecPicture(const ContextPtr& context,
                                  const SurfacePtr& surface, int64_t timeStamp)
     :VaapiPicture(context, surface, timeStamp)
+    , m_packedSlices(false)
+    , m_packedSliceParamSize(0)
+    , m_packedSliceDataPtr(NULL)
+    , m_packedSliceDataSize(0)
 {
 }
 
+bool VaapiDecPicture::appendPackedSliceData(const void* data, uint32_t size, uint32_t& offset)
+{
+    offset = m_packedSliceDataSize;
+    if (!size)
+        return true;
+    if (!m_packedSliceData || m_packedSliceData->getSize() - offset < size) {
+        // the pool rounds slice data up to a power of 2, so this doubles at least
+        uint32_t capacity = m_packedSliceData ? m_packedSliceData->getSize() * 2 : 0;
+        uint8_t* mapped;
+        if (capacity < offset + size)
+            capacity = offset + size;
+        BufObjectPtr grown = createBufferObject(VASliceDataBufferType, capacity, NULL,
+                                                (void**)&mapped);
+        if (!grown) {
+            ERROR("grow packed slice data to %d bytes failed", capacity);
+            return false;
+        }
+        if (offset)
+            memcpy(mapped, m_packedSliceDataPtr, offset);
+        m_packedSliceData = grown;
+        m_packedSliceDataPtr = mapped;
+    }
+    memcpy(m_packedSliceDataPtr + offset, data, size);
+    m_packedSliceDataSize += size;
+    return true;
+}
+
+bool VaapiDecPicture::editBitPlane(uint8_t*& plane, uint32_t size)
+{
+    /* already set? It's only one time offer*/
+    if (m_bitPlane)
+        return false;
+    m_bitPlane = createBufferObject(VABitPlaneBufferType, size, NULL, (void**)&plane);
+    if (!m_bitPlane)
+        return false;
+    memset(plane, 0, size);
+    return true;
+}
+
 bool VaapiDecPicture::decode()
 {
     return render();
@@ -47,6 +91,33 @@ bool VaapiDecPicture::doRender()
     RENDER_OBJECT(m_bitPlane);
     RENDER_OBJECT(m_hufTable);
     RENDER_OBJECT(m_slices);
+    return renderPackedSlices();
+}
+
+bool VaapiDecPicture::renderPackedSlices()
+{
+    BufObjectPtr param;
+    uint8_t* params;
+
+    if (m_packedSliceParams.empty())
+        return true;
+
+    param = createArrayObject(VASliceParameterBufferType, m_packedSliceParamSize,
+                              m_packedSliceParams.size() / m_packedSliceParamSize,
+                              (void**)&params);
+    if (!param) {
+        ERROR("create packed slice parameters failed");
+        return false;
+    }
+    memcpy(params, &m_packedSliceParams[0], m_packedSliceParams.size());
+    m_packedSliceParams.clear();
+    m_packedSliceParamSize = 0;
+    m_packedSliceDataPtr = NULL;
+    m_packedSliceDataSize = 0;
+
+    RENDER_OBJECT(param);
+    // render() unmaps it, NULL if all slices were empty
+    RENDER_OBJECT(m_packedSliceData);
     return true;
 }
 }
@@ -23,6 +23,7 @@
 #define vaapidecpicture_h
 
 #include "vaapi/vaapipicture.h"
+#include <vector>
 
 namespace YamiMediaCodec{
 class VaapiDecPicture : public VaapiPicture
@@ -41,6 +42,9 @@ public:
     template <class T>
     bool editBitPlane(T*& plane);
 
+    /// bitplane whose size depends on the stream, such as vc1's
+    bool editBitPlane(uint8_t*& plane, uint32_t size);
+
     template <class T>
     bool editHufTable(T*& hufTable);
 
@@ -52,8 +56,20 @@ public:
 
     bool decode();
 
+    /// append slices to one data buffer with real offsets instead of a
+    /// data buffer per slice, the parameters go out as one array too.
+    /// a packed slice parameter is only valid until the next newSlice() or decode()
+    void setPackedSlices(bool packed) { m_packedSlices = packed; }
+    bool isPackedSlices() const { return m_packedSlices; }
+
 private:
     virtual bool doRender();
+    bool renderPackedSlices();
+
+    template <class T>
+    bool newPackedSlice(T*& sliceParam, const void* sliceData, uint32_t sliceSize);
+    /// copy to the end of the mapped slice data buffer, a bigger one replaces it when it is full
+    bool appendPackedSliceData(const void* data, uint32_t size, uint32_t& offset);
 
     BufObjectPtr m_picture;
     BufObjectPtr m_iqMatrix;
@@ -61,6 +77,15 @@ private:
     BufObjectPtr m_hufTable;
     BufObjectPtr m_probTable;
     std::vector<std::pair<BufObjectPtr, BufObjectPtr> > m_slices;
+
+    bool m_packedSlices;
+    // the parameters of all packed slices back to back, sizeof one of them in
+    // m_packedSliceParamSize, growing moves them
+    std::vector<uint8_t> m_packedSliceParams;
+    uint32_t m_packedSliceParamSize;
+    BufObjectPtr m_packedSliceData;
+    uint8_t* m_packedSliceDataPtr;
+    uint32_t m_packedSliceDataSize;
 };
 
 template<class T>
@@ -96,6 +121,9 @@ bool VaapiDecPicture::editProbTable(T*& probTable)
 template <class T>
 bool VaapiDecPicture::newSlice(T*& sliceParam, const void* sliceData, uint32_t sliceSize)
 {
+    if (m_packedSlices)
+        return newPackedSlice(sliceParam, sliceData, sliceSize);
+
     BufObjectPtr data = createBufferObject(VASliceDataBufferType, sliceSize, sliceData, NULL);
     BufObjectPtr param = createBufferObject(VASliceParameterBufferType, sliceParam);
 
@@ -107,5 +135,26 @@ bool VaapiDecPicture::newSlice(T*& sliceParam, const void* sliceData, uint32_t s
     }
     return ret;
 }
+
+template <class T>
+bool VaapiDecPicture::newPackedSlice(T*& sliceParam, const void* sliceData, uint32_t sliceSize)
+{
+    uint32_t offset;
+    size_t paramOffset = m_packedSliceParams.size();
+
+    // all elements of a parameter array have the same type
+    if (m_packedSliceParamSize && m_packedSliceParamSize != sizeof(T))
+        return false;
+    if (!appendPackedSliceData(sliceData, sliceSize, offset))
+        return false;
+    m_packedSliceParamSize = sizeof(T);
+    m_packedSliceParams.resize(paramOffset + sizeof(T));
+    sliceParam = reinterpret_cast<T*>(&m_packedSliceParams[paramOffset]);
+
+    sliceParam->slice_data_size = sliceSize;
+    sliceParam->slice_data_offset = offset;
+    sliceParam->slice_data_flag = VA_SLICE_DATA_FLAG_ALL;
+    return true;
+}
 }
 #endif //#ifndef vaapidecpicture_h
@@ -28,14 +28,18 @@
 #include "common/log.h"
 #include "vaapi/vaapidisplay.h"
 #include "vaapi/vaapisurface.h"
+#include "vaapi/vaapisurfacearena.h"
+#include "vaapi/vaapicopythreads.h"
 #include "vaapi/vaapiimagepool.h"
 #include <string.h>
 #include <assert.h>
 
 namespace YamiMediaCodec{
 const uint32_t IMAGE_POOL_SIZE = 8;
+const uint32_t INVALID_SLOT = ~0u;
 
-DecSurfacePoolPtr VaapiDecSurfacePool::create(const DisplayPtr& display, VideoConfigBuffer* config)
+DecSurfacePoolPtr VaapiDecSurfacePool::create(const DisplayPtr& display, VideoConfigBuffer* config,
+                                              const DecSurfacePoolPtr& previous)
 {
     DecSurfacePoolPtr pool;
     std::vector<SurfacePtr> surfaces;
@@ -44,37 +48,121 @@ DecSurfacePoolPtr VaapiDecSurfacePool::create(const DisplayPtr& display, VideoCo
     assert(!(config->flag & WANT_SURFACE_PROTECTION));
     assert(!(config->flag & USE_NATIVE_GRAPHIC_BUFFER));
     assert(!(config->flag & WANT_RAW_OUTPUT));
-    for (size_t i = 0; i < size; ++i) {
-        SurfacePtr s = VaapiSurface::create(display, VAAPI_CHROMA_TYPE_YUV420,
-                                   config->surfaceWidth,config->surfaceHeight,NULL,0);
+    if (previous) {
+        previous->takeFreeSurfaces(surfaces, size, config);
+        DEBUG("reuse %d surfaces of the previous pool", (int)surfaces.size());
+    }
+    // shared with the other decoders on the display
+    SurfaceArenaPtr arena = VaapiSurfaceArena::get(display);
+    for (size_t i = surfaces.size(); i < size; ++i) {
+        SurfacePtr s = arena->borrow(VAAPI_CHROMA_TYPE_YUV420,
+                                     config->surfaceWidth, config->surfaceHeight);
         if (!s)
             return pool;
         s->resize(config->width, config->height);
         surfaces.push_back(s);
     }
     pool.reset(new VaapiDecSurfacePool(display, surfaces));
+    pool->m_async = config->flag & WANT_ASYNC_OUTPUT;
+    pool->m_maxInFlight = config->maxInFlightFrames;
+    if (previous && previous->m_copyThreads
+        && previous->m_copyThreads->getThreads()
+            == VaapiCopyThreads::clampThreads(config->copyThreads))
+        pool->m_copyThreads = previous->m_copyThreads;
+    else
+        pool->m_copyThreads = VaapiCopyThreads::create(config->copyThreads);
+    if (previous && !previous->isDrained())
+        pool->m_previous = previous;
     return pool;
 }
 
+DecSurfacePoolPtr VaapiDecSurfacePool::create(const DisplayPtr& display,
+                                              const std::vector<SurfacePtr>& surfaces)
+{
+    return DecSurfacePoolPtr(new VaapiDecSurfacePool(display, surfaces));
+}
+
+void VaapiDecSurfacePool::takeFreeSurfaces(std::vector<SurfacePtr>& surfaces, size_t size,
+                                           const VideoConfigBuffer* config)
+{
+    AutoLock lock(m_lock);
+    std::deque<uint32_t>::iterator it = m_freed.begin();
+    while (it != m_freed.end() && surfaces.size() < size) {
+        SurfacePtr& s = m_surfaces[*it];
+        //resize fails if the surface was allocated smaller
+        if (!s->resize(config->surfaceWidth, config->surfaceHeight)) {
+            ++it;
+            continue;
+        }
+        s->resize(config->width, config->height);
+        surfaces.push_back(s);
+        //the slot stays out of m_freed, it's never used again
+        s.reset();
+        it = m_freed.erase(it);
+    }
+}
+
+bool VaapiDecSurfacePool::hasOutput() const
+{
+    return m_output.size();
+}
+
+bool VaapiDecSurfacePool::isDrained()
+{
+    if (getPrevious() || hasOutput())
+        return false;
+    AutoLock lock(m_lock);
+    return !m_allocated;
+}
+
+DecSurfacePoolPtr VaapiDecSurfacePool::getPrevious()
+{
+    AutoLock lock(m_previousLock);
+    if (m_previous && m_previous->isDrained()) {
+        DEBUG("previous surface pool is drained");
+        m_previous.reset();
+    }
+    return m_previous;
+}
+
 VaapiDecSurfacePool::VaapiDecSurfacePool(const DisplayPtr& display, std::vector<SurfacePtr> surfaces):
     m_display(display),
+    m_minID(0),
+    m_allocated(0),
     m_cond(m_lock),
-    m_flushing(false)
+    m_flushing(false),
+    m_output(surfaces.size()),
+    m_async(false),
+    m_maxInFlight(0)
 {
     size_t size = surfaces.size();
+    VASurfaceID maxID = 0;
     m_surfaces.swap(surfaces);
     m_renderBuffers.resize(size);
+    m_states.resize(size, SURFACE_FREE);
     for (size_t i = 0; i < size; ++i) {
-        const SurfacePtr& s = m_surfaces[i];
         VASurfaceID id = m_surfaces[i]->getID();
-        m_renderBuffers[i].display = display->getID();
+        m_renderBuffers[i].display = display ? display->getID() : NULL;
         m_renderBuffers[i].surface = id;
         m_renderBuffers[i].timeStamp = 0;
 
-        m_renderMap[id] = &m_renderBuffers[i];
-        m_surfaceMap[id] = s.get();
-        m_freed.push_back(id);
+        if (!i || id < m_minID)
+            m_minID = id;
+        if (id > maxID)
+            maxID = id;
+        m_freed.push_back(i);
     }
+    if (size)
+        m_slots.resize(maxID - m_minID + 1, INVALID_SLOT);
+    for (size_t i = 0; i < size; ++i)
+        m_slots[m_renderBuffers[i].surface - m_minID] = i;
+}
+
+uint32_t VaapiDecSurfacePool::getSlot(VASurfaceID id) const
+{
+    if (id < m_minID || id - m_minID >= m_slots.size())
+        return INVALID_SLOT;
+    return m_slots[id - m_minID];
 }
 
 void VaapiDecSurfacePool::getSurfaceIDs(std::vector<VASurfaceID>& ids)
@@ -91,7 +179,7 @@ void VaapiDecSurfacePool::getSurfaceIDs(std::vector<VASurfaceID>& ids)
 struct VaapiDecSurfacePool::SurfaceRecycler
 {
     SurfaceRecycler(const DecSurfacePoolPtr& pool): m_pool(pool) {}
-    void operator()(VaapiSurface* surface) { m_pool->recycle(surface->getID(), SURFACE_DECODING);}
+    void operator()(VaapiSurface* surface) { m_pool->recycle(m_pool->getSlot(surface->getID()), SURFACE_DECODING);}
 private:
     DecSurfacePoolPtr m_pool;
 };
@@ -111,45 +199,76 @@ SurfacePtr VaapiDecSurfacePool::acquireWithWait()
     }
 
     assert(!m_freed.empty());
-    VASurfaceID id = m_freed.front();
+    uint32_t slot = m_freed.front();
     m_freed.pop_front();
-    m_allocated[id] = SURFACE_DECODING;
-    VaapiSurface* s = m_surfaceMap[id];
-    surface.reset(s, SurfaceRecycler(shared_from_this()));
+    m_allocated++;
+    //nobody else touches a free slot
+    m_states[slot] = SURFACE_DECODING;
+    surface.reset(m_surfaces[slot].get(), SurfaceRecycler(shared_from_this()));
     return surface;
 }
 
 bool VaapiDecSurfacePool::output(const SurfacePtr& surface, int64_t timeStamp)
 {
-    VASurfaceID id = surface->getID();
+    uint32_t slot = getSlot(surface->getID());
 
-    AutoLock lock(m_lock);
-    const Allocated::iterator it = m_allocated.find(id);
-    if (it == m_allocated.end())
+    if (slot == INVALID_SLOT) {
+        //decoded before a resolution change
+        DecSurfacePoolPtr previous = getPrevious();
+        return previous && previous->output(surface, timeStamp);
+    }
+    //the caller holds the surface, SURFACE_DECODING can't go away under us
+    if (m_states[slot] == SURFACE_FREE)
         return false;
-    assert(it->second == SURFACE_DECODING);
-    it->second |= SURFACE_TO_RENDER;
-    VideoRenderBuffer* buffer = m_renderMap[id];
-    buffer->timeStamp = timeStamp;
+    assert(m_states[slot] == SURFACE_DECODING);
+    m_renderBuffers[slot].timeStamp = timeStamp;
+    __sync_fetch_and_or(&m_states[slot], SURFACE_TO_RENDER);
     DEBUG("surface=0x%x is output-able with timeStamp=%ld", surface->getID(), timeStamp);
-    m_output.push_back(buffer);
+    //can't be full, it has a place for every surface
+    m_output.push(slot);
     return true;
 }
 
-VideoRenderBuffer* VaapiDecSurfacePool::getOutput()
+VideoRenderBuffer* VaapiDecSurfacePool::getOutput(bool draining)
 {
-    AutoLock lock(m_lock);
-    if (m_output.empty())
-        return NULL;
-    VideoRenderBuffer* buffer = m_output.front();
-    m_output.pop_front();
-    const Allocated::iterator it = m_allocated.find(buffer->surface);
-    assert(it != m_allocated.end());
-    assert(it->second & SURFACE_TO_RENDER);
-    assert(!(it->second & SURFACE_RENDERING));
-    //clear SURFACE_TO_RENDER and set SURFACE_RENDERING
-    it->second ^= SURFACE_RENDERING | SURFACE_TO_RENDER;
-    return buffer;
+    //frames of the previous pool go first
+    DecSurfacePoolPtr previous = getPrevious();
+    if (previous && previous->hasOutput())
+        return previous->getOutput(draining);
+    return popOutput(draining);
+}
+
+VideoRenderBuffer* VaapiDecSurfacePool::popOutput(bool draining)
+{
+    uint32_t slot;
+    VaapiSurface* surface;
+    bool wait = m_async && !draining;
+    if (wait) {
+        //the next acquireWithWait() blocks until a frame comes back, a client decoding
+        //and rendering on one thread would never get it
+        AutoLock lock(m_lock);
+        wait = !m_freed.empty();
+    }
+    {
+        AutoLock lock(m_outputLock);
+        if (!m_output.front(slot))
+            return NULL;
+        surface = m_surfaces[slot].get();
+        if (wait && m_output.size() <= m_maxInFlight) {
+            VaapiSurfaceStatus status;
+            if (surface->queryStatus(&status) && (status & VAAPI_SURFACE_STATUS_RENDERING))
+                return NULL;
+        }
+        m_output.pop();
+        //clear SURFACE_TO_RENDER and set SURFACE_RENDERING
+        uint32_t state = __sync_fetch_and_xor(&m_states[slot], SURFACE_RENDERING | SURFACE_TO_RENDER);
+        assert(state & SURFACE_TO_RENDER);
+        assert(!(state & SURFACE_RENDERING));
+    }
+    //the only place we wait for the hardware in async mode, do it without the lock
+    if (m_async && !surface->sync())
+        WARNING("sync surface 0x%x failed", surface->getID());
+    return &m_renderBuffers[slot];
 }
 
 struct VaapiDecSurfacePool::SurfaceRecyclerRender
@@ -189,7 +308,7 @@ bool VaapiDecSurfacePool::exportFrame(ImagePtr image, VideoFrameRawData &frame,
     if (!rawImage)
         return false;
     if (memoryType == VIDEO_DATA_MEMORY_TYPE_RAW_COPY) {
-        return rawImage->copyTo((uint8_t *)frame.handle, frame.offset, frame.pitch);
+        return rawImage->copyTo((uint8_t *)frame.handle, frame.offset, frame.pitch, m_copyThreads);
     }
     if (!rawImage->getHandle(frame.handle, frame.offset, frame.pitch))
         return false;
@@ -210,18 +329,22 @@ bool VaapiDecSurfacePool::exportFrame(ImagePtr image, VideoFrameRawData &frame,
     return true;
 }
 
-bool VaapiDecSurfacePool::getOutput(VideoFrameRawData* frame)
+bool VaapiDecSurfacePool::getOutput(VideoFrameRawData* frame, bool draining)
 {
     if (!frame)
         return false;
 
-    VideoRenderBuffer *buffer = getOutput();
+    DecSurfacePoolPtr previous = getPrevious();
+    if (previous && previous->hasOutput())
+        return previous->getOutput(frame, draining);
+
+    VideoRenderBuffer *buffer = popOutput(draining);
 
     if (!buffer)
         return false;
 
     SurfacePtr surface;
-    VaapiSurface *srf = m_surfaceMap[buffer->surface];
+    VaapiSurface *srf = m_surfaces[buffer - &m_renderBuffers[0]].get();
     ASSERT(srf);
     surface.reset(srf, SurfaceRecyclerRender(shared_from_this(), buffer));
 
@@ -300,10 +423,12 @@ bool VaapiDecSurfacePool::populateOutputHandles(VideoFrameRawData *frames, uint3
 
 void VaapiDecSurfacePool::setWaitable(bool waitable)
 {
-    m_flushing = !waitable;
-
-    if (!waitable) {
-        m_cond.signal();
+    {
+        //under the lock, or acquireWithWait may miss the signal between its check and wait
+        AutoLock lock(m_lock);
+        m_flushing = !waitable;
+        if (!waitable)
+            m_cond.signal();
     }
     if (m_imagePool)
         m_imagePool->setWaitable(waitable);
@@ -311,58 +436,73 @@ void VaapiDecSurfacePool::setWaitable(bool waitable)
 
 void VaapiDecSurfacePool::flush()
 {
-    AutoLock lock(m_lock);
-    for (OutputQueue::iterator it = m_output.begin();
-        it != m_output.end(); ++it) {
-        recycleLocked((*it)->surface, SURFACE_TO_RENDER);
+    DecSurfacePoolPtr previous = getPrevious();
+    if (previous)
+        previous->flush();
+    {
+        AutoLock lock(m_outputLock);
+        uint32_t slot;
+        while (m_output.front(slot)) {
+            m_output.pop();
+            recycle(slot, SURFACE_TO_RENDER);
+        }
     }
-    m_output.clear();
+    AutoLock lock(m_lock);
     //still have unreleased surface
-    if (!m_allocated.empty())
+    if (m_allocated)
         m_flushing = true;
 }
 
-void VaapiDecSurfacePool::recycleLocked(VASurfaceID id, SurfaceState flag)
+void VaapiDecSurfacePool::recycle(uint32_t slot, SurfaceState flag)
 {
-    const Allocated::iterator it = m_allocated.find(id);
-    if (it == m_allocated.end()) {
-        ERROR("try to recycle %u from state %d, it's not an allocated buffer", id, flag);
+    if (slot >= m_states.size()) {
+        ERROR("try to recycle slot %u from state %d, it's not a buffer of the pool", slot, flag);
         return;
     }
-    it->second &= ~flag;
-    if (it->second == SURFACE_FREE) {
-        m_allocated.erase(it);
-        m_freed.push_back(id);
-        if (m_flushing && m_allocated.size() == 0)
-            m_flushing = false;
-        m_cond.signal();
+    uint32_t state = __sync_fetch_and_and(&m_states[slot], ~flag);
+    if (!(state & flag)) {
+        ERROR("try to recycle 0x%x from state %d, it's not in that state",
+              m_renderBuffers[slot].surface, flag);
+        return;
     }
-}
-
-void VaapiDecSurfacePool::recycle(VASurfaceID id, SurfaceState flag)
-{
+    //the last user of the slot takes the lock, the others don't need it
+    if (state != (uint32_t)flag)
+        return;
     AutoLock lock(m_lock);
-    recycleLocked(id,flag);
+    m_allocated--;
+    m_freed.push_back(slot);
+    if (m_flushing && !m_allocated)
+        m_flushing = false;
+    m_cond.signal();
 }
 
 void VaapiDecSurfacePool::recycle(const VideoRenderBuffer * renderBuf)
 {
     if (renderBuf < &m_renderBuffers[0]
         || renderBuf >= &m_renderBuffers[m_renderBuffers.size()]) {
-        ERROR("recycle invalid render buffer");
+        DecSurfacePoolPtr previous = getPrevious();
+        if (previous)
+            previous->recycle(renderBuf);
+        else
+            ERROR("recycle invalid render buffer");
         return;
     }
-    recycle(renderBuf->surface, SURFACE_RENDERING);
+    recycle(renderBuf - &m_renderBuffers[0], SURFACE_RENDERING);
 }
 
 void VaapiDecSurfacePool::recycle(VideoFrameRawData* frame)
 {
-    AutoLock lock(m_exportFramesLock);
-
     if (!frame || frame->memoryType == VIDEO_DATA_MEMORY_TYPE_RAW_COPY)
         return;
 
-    m_exportFrames.erase(frame->internalID);
+    {
+        AutoLock lock(m_exportFramesLock);
+        if (m_exportFrames.erase(frame->internalID))
+            return;
+    }
+    DecSurfacePoolPtr previous = getPrevious();
+    if (previous)
+        previous->recycle(frame);
 }
 
 } //namespace YamiMediaCodec
@@ -27,6 +27,7 @@
 #include "common/condition.h"
 #include "common/common_def.h"
 #include "common/lock.h"
+#include "common/spscring.h"
 #include "vaapi/vaapiptrs.h"
 #include "vaapi/vaapitypes.h"
 #include "interface/VideoDecoderDefs.h"
@@ -51,8 +52,17 @@ namespace YamiMediaCodec{
  *  if no flag is set, the buffer/surface can be reused -- associate with a new VaapiPicture
  * 2. the free surface is in a first-in-first-out queue to be friendly to graphics fence
  * 3. most functions in this class do not support multithread except recycle.
+ *    output is called by the decoder thread and getOutput by one client thread, they share a lock
+ *    free ring. surfaces live in slots, the state of a slot is changed atomically, only the free
+ *    queue is guarded by a lock since acquireWithWait has to wait on it.
  * 4. flush need called in decoder thread and it will make all following acuireWithWait return null surface.
  *    until all surface recycled.
+ * 5. with WANT_ASYNC_OUTPUT, getOutput returns a frame the hardware is still decoding only when
+ *    more than maxInFlightFrames frames wait, no surface is free or it is draining, and syncs
+ *    the surface before that.
+ * 6. a pool created with a previous one takes over the free surfaces of it which are big enough.
+ *    the previous pool keeps the rest until the client returned everything, its output queue
+ *    is drained before ours.
  *</pre>
 */
 
@@ -60,7 +70,11 @@ namespace YamiMediaCodec{
 class VaapiDecSurfacePool : public std::tr1::enable_shared_from_this<VaapiDecSurfacePool>
 {
 public:
-    static DecSurfacePoolPtr create(const DisplayPtr&, VideoConfigBuffer* config);
+    static DecSurfacePoolPtr create(const DisplayPtr&, VideoConfigBuffer* config,
+                                    const DecSurfacePoolPtr& previous = DecSurfacePoolPtr());
+    /// pool over the given surfaces, the display may be null if nothing but
+    /// the surface ids is used, tests/surfacepoolstress.cpp does that
+    static DecSurfacePoolPtr create(const DisplayPtr&, const std::vector<SurfacePtr>& surfaces);
     void getSurfaceIDs(std::vector<VASurfaceID>& ids);
     /// get a free surface,
     /// it always return null buffer if it's flushed.
@@ -68,8 +82,8 @@ public:
     /// push surface to output queue
     bool output(const SurfacePtr&, int64_t timetamp);
     /// get surface from output queue
-    VideoRenderBuffer* getOutput();
-    bool getOutput(VideoFrameRawData* frame);
+    VideoRenderBuffer* getOutput(bool draining = false);
+    bool getOutput(VideoFrameRawData* frame, bool draining = false);
     bool populateOutputHandles(VideoFrameRawData *frames, uint32_t &frameCount);
     /// recycle to surface pool
     void recycle(const VideoRenderBuffer * renderBuf);
@@ -97,35 +111,50 @@ private:
 
     VaapiDecSurfacePool(const DisplayPtr&, std::vector<SurfacePtr>);
 
-    void recycleLocked(VASurfaceID, SurfaceState);
-    void recycle(VASurfaceID, SurfaceState);
+    void recycle(uint32_t slot, SurfaceState);
+    uint32_t getSlot(VASurfaceID) const;
+    void takeFreeSurfaces(std::vector<SurfacePtr>&, size_t size, const VideoConfigBuffer*);
+    bool hasOutput() const;
+    VideoRenderBuffer* popOutput(bool draining);
+    bool isDrained();
+    DecSurfacePoolPtr getPrevious();
 
     //following member only change in constructor.
     DisplayPtr m_display;
+    // all indexed by slot
     std::vector<VideoRenderBuffer> m_renderBuffers;
     std::vector<SurfacePtr> m_surfaces;
-    typedef std::map<VASurfaceID, VideoRenderBuffer*> RenderMap;
-    RenderMap m_renderMap;
-    typedef std::map<VASurfaceID, VaapiSurface*> SurfaceMap;
-    SurfaceMap m_surfaceMap;
-
-    //free and allocted.
-    std::deque<VASurfaceID> m_freed;
-    typedef std::map<VASurfaceID, uint32_t> Allocated;
-    Allocated m_allocated;
-
-    /* output queue*/
-    typedef std::deque<VideoRenderBuffer*> OutputQueue;
-    OutputQueue m_output;
-
+    std::vector<uint32_t> m_states;
+    // VASurfaceID - m_minID to slot, ids from one vaCreateSurfaces call are mostly dense
+    VASurfaceID m_minID;
+    std::vector<uint32_t> m_slots;
+
+    //free slots, guarded by m_lock
+    std::deque<uint32_t> m_freed;
+    uint32_t m_allocated;
     Lock m_lock;
     Condition m_cond;
     bool m_flushing;
 
+    /* output queue, slots */
+    SpscRing<uint32_t> m_output;
+    //for flush(), which drains the output queue from the decoder thread
+    Lock m_outputLock;
+
+    /* WANT_ASYNC_OUTPUT */
+    bool m_async;
+    uint32_t m_maxInFlight;
+
+    //the pool before a resolution change, until it gets all surfaces back
+    DecSurfacePoolPtr m_previous;
+    Lock m_previousLock;
+
     struct SurfaceRecycler;
     struct SurfaceRecyclerRender;
 
     ImagePoolPtr m_imagePool;
+    //for VIDEO_DATA_MEMORY_TYPE_RAW_COPY, see VideoConfigBuffer::copyThreads
+    CopyThreadsPtr m_copyThreads;
 
     class ExportFrame {
       public:
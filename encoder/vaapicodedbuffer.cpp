@@ -37,6 +37,15 @@ CodedBufferPtr VaapiCodedBuffer::create(const ContextPtr& context, uint32_t bufS
     return coded;
 }
 
+void VaapiCodedBuffer::reset()
+{
+    if (m_segments) {
+        m_buf->unmap();
+        m_segments = NULL;
+    }
+    m_flags = 0;
+}
+
 bool VaapiCodedBuffer::map()
 {
     if (!m_segments)
@@ -72,4 +81,64 @@ bool VaapiCodedBuffer::copyInto(void* data)
     }
     return true;
 }
+
+CodedBufferPoolPtr VaapiCodedBufferPool::create(const ContextPtr& context, uint32_t bufSize, uint32_t maxFree)
+{
+    CodedBufferPoolPtr pool(new VaapiCodedBufferPool(context, bufSize, maxFree));
+    return pool;
+}
+
+VaapiCodedBufferPool::VaapiCodedBufferPool(const ContextPtr& context, uint32_t bufSize, uint32_t maxFree)
+    : m_context(context), m_bufSize(bufSize), m_maxFree(maxFree)
+{
+}
+
+struct VaapiCodedBufferPool::BufferRecycler
+{
+    BufferRecycler(const CodedBufferPoolPtr& pool, const CodedBufferPtr& buffer)
+        : m_pool(pool), m_buffer(buffer) {}
+    void operator()(VaapiCodedBuffer* buffer)
+    {
+        if (!buffer)
+            return;
+        m_pool->recycle(m_buffer);
+        m_buffer.reset();
+    }
+private:
+    CodedBufferPoolPtr m_pool;
+    CodedBufferPtr m_buffer;
+};
+
+bool VaapiCodedBufferPool::isCompatible(const ContextPtr& context, uint32_t bufSize)
+{
+    return m_context == context && m_bufSize == bufSize;
+}
+
+CodedBufferPtr VaapiCodedBufferPool::acquire(bool& reused)
+{
+    CodedBufferPtr buffer;
+    {
+        AutoLock lock(m_lock);
+        if (!m_free.empty()) {
+            buffer = m_free.back();
+            m_free.pop_back();
+        }
+    }
+    reused = buffer;
+    if (!buffer) {
+        buffer = VaapiCodedBuffer::create(m_context, m_bufSize);
+        if (!buffer)
+            return buffer;
+    }
+    CodedBufferPtr ret(buffer.get(), BufferRecycler(shared_from_this(), buffer));
+    return ret;
+}
+
+void VaapiCodedBufferPool::recycle(const CodedBufferPtr& buffer)
+{
+    buffer->reset();
+    AutoLock lock(m_lock);
+    if (m_free.size() < m_maxFree)
+        m_free.push_back(buffer);
+}
 }
@@ -25,7 +25,9 @@
 #include "vaapi/vaapibuffer.h"
 #include "vaapi/vaapiptrs.h"
 #include "vaapi/vaapitypes.h"
+#include "common/lock.h"
 #include <stdlib.h>
+#include <vector>
 
 namespace YamiMediaCodec{
 class VaapiCodedBuffer
@@ -43,11 +45,46 @@ public:
     uint32_t getFlags() { return m_flags; }
 
 private:
+    friend class VaapiCodedBufferPool;
     VaapiCodedBuffer(const BufObjectPtr& buf):m_buf(buf), m_segments(NULL), m_flags(0) {}
     bool map();
+    /// unmap and clear the flags, so the buffer can take the next frame
+    void reset();
     BufObjectPtr m_buf;
     VACodedBufferSegment* m_segments;
     uint32_t m_flags;
 };
+
+/**
+ * \class VaapiCodedBufferPool
+ * \brief coded buffers of one encoder, all of the same size
+ * <pre>
+ * acquire() hands out a free buffer, or creates one when all are still waiting for getOutput().
+ * a buffer comes back when the picture holding it is gone, at most @param maxFree are kept.
+ *</pre>
+ */
+class VaapiCodedBufferPool : public std::tr1::enable_shared_from_this<VaapiCodedBufferPool>
+{
+public:
+    static CodedBufferPoolPtr create(const ContextPtr&, uint32_t bufSize, uint32_t maxFree);
+
+    bool isCompatible(const ContextPtr&, uint32_t bufSize);
+    /// @param reused is false when a new buffer was created
+    CodedBufferPtr acquire(bool& reused);
+
+private:
+    VaapiCodedBufferPool(const ContextPtr&, uint32_t bufSize, uint32_t maxFree);
+    void recycle(const CodedBufferPtr&);
+
+    ContextPtr m_context;
+    uint32_t m_bufSize;
+    uint32_t m_maxFree;
+    Lock m_lock;
+    std::vector<CodedBufferPtr> m_free;
+
+    struct BufferRecycler;
+
+    DISALLOW_COPY_AND_ASSIGN(VaapiCodedBufferPool);
+};
 }
 #endif //vaapicodedbuffer_h
@@ -31,8 +31,10 @@
 #include "common/utils.h"
 #include "scopedlogger.h"
 #include "vaapicodedbuffer.h"
+#include "vaapiencsurfacepool.h"
 #include "vaapi/vaapidisplay.h"
 #include "vaapi/vaapicontext.h"
+#include "vaapi/vaapicopythreads.h"
 #include "vaapi/vaapiutils.h"
 
 const uint32_t MaxOutputBuffer=5;
@@ -40,7 +42,9 @@ namespace YamiMediaCodec{
 VaapiEncoderBase::VaapiEncoderBase():
     m_entrypoint(VAEntrypointEncSlice),
     m_maxOutputBuffer(MaxOutputBuffer),
-    m_maxCodedbufSize(0)
+    m_maxCodedbufSize(0),
+    m_codedBufferHits(0),
+    m_codedBufferMisses(0)
 {
     FUNC_ENTER();
     m_externalDisplay.handle = 0,
@@ -219,6 +223,14 @@ Encode_Status VaapiEncoderBase::setParameters(VideoParamConfigType type, Yami_PT
             ret = ENCODE_INVALID_PARAMS;
         }
         break;
+    case VideoConfigTypeCopyThreads: {
+        VideoConfigCopyThreads* copyThreads = (VideoConfigCopyThreads*)videoEncParams;
+        if (copyThreads->size == sizeof(VideoConfigCopyThreads)) {
+            m_copyThreads = VaapiCopyThreads::create(copyThreads->threads);
+        } else
+            ret = ENCODE_INVALID_PARAMS;
+        }
+        break;
     default:
         ret = ENCODE_INVALID_PARAMS;
         break;
@@ -285,30 +297,67 @@ SurfacePtr VaapiEncoderBase::createSurface(uint32_t fourcc)
 
 SurfacePtr VaapiEncoderBase::createSurface(VideoFrameRawData* frame)
 {
-    SurfacePtr surface = createSurface(frame->fourcc);
     SurfacePtr nil;
-    if (!surface)
-        return nil;
-
-    ImagePtr image = VaapiImage::derive(surface);
-    if (!image) {
-        ERROR("VaapiImage::derive() failed");
-        return nil;
-    }
-    ImageRawPtr raw = mapVaapiImage(image);
-    if (!raw) {
-        ERROR("image->map() failed");
-        return nil;
+    uint32_t width = m_videoParamCommon.resolution.width;
+    uint32_t height = m_videoParamCommon.resolution.height;
+    if (!m_inputPool || !m_inputPool->isCompatible(frame->fourcc, width, height))
+        m_inputPool = VaapiEncSurfacePool::create(frame->fourcc, width, height, m_maxOutputBuffer);
+
+    ImageRawPtr raw;
+    SurfacePtr surface = m_inputPool->acquire(raw);
+    if (!surface) {
+        surface = createSurface(frame->fourcc);
+        if (!surface)
+            return nil;
+
+        ImagePtr image = VaapiImage::derive(surface);
+        if (!image) {
+            ERROR("VaapiImage::derive() failed");
+            return nil;
+        }
+        raw = mapVaapiImage(image);
+        if (!raw) {
+            ERROR("image->map() failed");
+            return nil;
+        }
+        surface = m_inputPool->add(surface, raw);
     }
 
     uint8_t* src = reinterpret_cast<uint8_t*>(frame->handle);
-    if (!raw->copyFrom(src, frame->offset, frame->pitch)) {
+    if (!raw->copyFrom(src, frame->offset, frame->pitch, m_copyThreads)) {
         ERROR("copyfrom in buffer failed");
         return nil;
     }
     return surface;
 }
 
+CodedBufferPtr VaapiEncoderBase::createCodedBuffer()
+{
+    if (!m_codedBufferPool || !m_codedBufferPool->isCompatible(m_context, m_maxCodedbufSize))
+        m_codedBufferPool = VaapiCodedBufferPool::create(m_context, m_maxCodedbufSize, m_maxOutputBuffer);
+
+    bool reused;
+    CodedBufferPtr codedBuffer = m_codedBufferPool->acquire(reused);
+    if (codedBuffer) {
+        if (reused)
+            m_codedBufferHits++;
+        else
+            m_codedBufferMisses++;
+    }
+    return codedBuffer;
+}
+
+Encode_Status VaapiEncoderBase::getStatistics(VideoStatistics *videoStat)
+{
+    if (!videoStat)
+        return ENCODE_INVALID_PARAMS;
+    videoStat->coded_buffer_hits = m_codedBufferHits;
+    videoStat->coded_buffer_misses = m_codedBufferMisses;
+    videoStat->rendered_pictures = m_context ? m_context->getRenderedPictures() : 0;
+    videoStat->va_calls = m_context ? m_context->getVaCalls() : 0;
+    return ENCODE_SUCCESS;
+}
+
 struct SurfaceRecycler
 {
     SurfaceRecycler(const SharedPtr<VideoFrame>& frame): m_frame(frame){}
@@ -396,6 +445,8 @@ VaapiProfile VaapiEncoderBase::profile() const
 
 void VaapiEncoderBase::cleanupVA()
 {
+    m_inputPool.reset();
+    m_codedBufferPool.reset();
     m_context.reset();
     m_display.reset();
 }
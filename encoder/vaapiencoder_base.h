@@ -85,15 +85,15 @@ public:
     virtual void getPicture(PicturePtr &outPicture);
     virtual Encode_Status checkCodecData(VideoEncOutputBuffer * outBuffer);
     virtual Encode_Status checkEmpty(VideoEncOutputBuffer * outBuffer, bool *outEmpty);
-    virtual Encode_Status getStatistics(VideoStatistics *videoStat) {
-        return ENCODE_SUCCESS;
-    };
+    virtual Encode_Status getStatistics(VideoStatistics *videoStat);
 
 protected:
     //utils functions for derived class
     SurfacePtr createSurface(uint32_t fourcc = VA_FOURCC_NV12);
     SurfacePtr createSurface(VideoFrameRawData* frame);
     SurfacePtr createSurface(const SharedPtr<VideoFrame>& frame);
+    /// a coded buffer of m_maxCodedbufSize, recycled after getOutput
+    CodedBufferPtr createCodedBuffer();
 
     template <class Pic>
     bool output(const SharedPtr<Pic>&);
@@ -164,6 +164,13 @@ protected:
     VideoParamsCommon m_videoParamCommon;
     uint32_t m_maxOutputBuffer; // max count of frames are encoding in parallel, it hurts performance when m_maxOutputBuffer is too big.
     uint32_t m_maxCodedbufSize;
+    //for VideoFrameRawData input, see VideoConfigCopyThreads
+    CopyThreadsPtr m_copyThreads;
+    //surfaces for VideoFrameRawData input, recycled mapped
+    EncSurfacePoolPtr m_inputPool;
+    CodedBufferPoolPtr m_codedBufferPool;
+    uint32_t m_codedBufferHits;
+    uint32_t m_codedBufferMisses;
 
 private:
     bool initVA();
@@ -294,7 +294,7 @@ Encode_Status VaapiEncoderJpeg::doEncode(const SurfacePtr& surface, uint64_t tim
 {
     FUNC_ENTER();
     Encode_Status ret;
-    CodedBufferPtr codedBuffer = VaapiCodedBuffer::create(m_context, m_maxCodedbufSize);
+    CodedBufferPtr codedBuffer = createCodedBuffer();
     PicturePtr picture(new VaapiEncPictureJPEG(m_context, surface, timeStamp));
     picture->m_codedBuffer = codedBuffer;
     ret = encodePicture(picture);
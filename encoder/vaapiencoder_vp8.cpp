@@ -133,7 +133,7 @@ Encode_Status VaapiEncoderVP8::doEncode(const SurfacePtr& surface, uint64_t time
 
     m_qIndex = (initQP() > minQP() && initQP() < maxQP()) ? initQP() : VP8_DEFAULT_QP;
 
-    CodedBufferPtr codedBuffer = VaapiCodedBuffer::create(m_context, m_maxCodedbufSize);
+    CodedBufferPtr codedBuffer = createCodedBuffer();
     if (!codedBuffer)
         return ENCODE_NO_MEMORY;
     picture->m_codedBuffer = codedBuffer;
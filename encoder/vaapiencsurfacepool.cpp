@@ -0,0 +1,103 @@
+/*
+ *  vaapiencsurfacepool.cpp - recycled input surfaces for the encoders
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "vaapiencsurfacepool.h"
+
+#include "common/log.h"
+#include "vaapi/vaapiimage.h"
+#include "vaapi/vaapisurface.h"
+
+namespace YamiMediaCodec{
+
+EncSurfacePoolPtr VaapiEncSurfacePool::create(uint32_t fourcc, uint32_t width, uint32_t height, uint32_t size)
+{
+    EncSurfacePoolPtr pool(new VaapiEncSurfacePool(fourcc, width, height, size));
+    return pool;
+}
+
+VaapiEncSurfacePool::VaapiEncSurfacePool(uint32_t fourcc, uint32_t width, uint32_t height, uint32_t size)
+    : m_fourcc(fourcc), m_width(width), m_height(height), m_size(size)
+{
+}
+
+struct VaapiEncSurfacePool::SurfaceRecycler
+{
+    SurfaceRecycler(const EncSurfacePoolPtr& pool, const Item& item)
+        : m_pool(pool), m_item(item) {}
+    void operator()(VaapiSurface* surface)
+    {
+        if (!surface)
+            return;
+        m_pool->recycle(m_item);
+        m_item.raw.reset();
+        m_item.surface.reset();
+    }
+private:
+    EncSurfacePoolPtr m_pool;
+    Item m_item;
+};
+
+bool VaapiEncSurfacePool::isCompatible(uint32_t fourcc, uint32_t width, uint32_t height)
+{
+    return m_fourcc == fourcc && m_width == width && m_height == height;
+}
+
+SurfacePtr VaapiEncSurfacePool::wrap(const Item& item)
+{
+    SurfacePtr surface(item.surface.get(), SurfaceRecycler(shared_from_this(), item));
+    return surface;
+}
+
+SurfacePtr VaapiEncSurfacePool::acquire(ImageRawPtr& raw)
+{
+    SurfacePtr surface;
+    Item item;
+    {
+        AutoLock lock(m_lock);
+        if (m_free.empty())
+            return surface;
+        item = m_free.front();
+        m_free.pop_front();
+    }
+    raw = item.raw;
+    return wrap(item);
+}
+
+SurfacePtr VaapiEncSurfacePool::add(const SurfacePtr& surface, const ImageRawPtr& raw)
+{
+    Item item;
+    item.surface = surface;
+    item.raw = raw;
+    DEBUG("new input surface 0x%x", surface->getID());
+    return wrap(item);
+}
+
+void VaapiEncSurfacePool::recycle(const Item& item)
+{
+    AutoLock lock(m_lock);
+    if (m_free.size() < m_size)
+        m_free.push_back(item);
+}
+
+} //namespace YamiMediaCodec
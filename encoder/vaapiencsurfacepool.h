@@ -0,0 +1,79 @@
+/*
+ *  vaapiencsurfacepool.h - recycled input surfaces for the encoders
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef vaapiencsurfacepool_h
+#define vaapiencsurfacepool_h
+
+#include "common/common_def.h"
+#include "common/lock.h"
+#include "vaapi/vaapiptrs.h"
+#include "vaapi/vaapitypes.h"
+#include <deque>
+#include <stdint.h>
+
+namespace YamiMediaCodec{
+
+/**
+ * \class VaapiEncSurfacePool
+ * \brief input surfaces of one fourcc and size, with their derived images kept mapped
+ * <pre>
+ * the encoder copies a raw input frame into a surface from acquire(). when the encoder lets
+ * the surface go, it comes back here still mapped, ready for the next frame.
+ * the pool has no surface at first, a new one is add()ed when acquire() finds none free.
+ * at most @param size free surfaces are kept, the others are destroyed when they come back.
+ *</pre>
+ */
+class VaapiEncSurfacePool : public std::tr1::enable_shared_from_this<VaapiEncSurfacePool>
+{
+public:
+    static EncSurfacePoolPtr create(uint32_t fourcc, uint32_t width, uint32_t height, uint32_t size);
+
+    bool isCompatible(uint32_t fourcc, uint32_t width, uint32_t height);
+    /// a free surface and its mapped image in @param raw, NULL if none is free
+    SurfacePtr acquire(ImageRawPtr& raw);
+    /// start recycling @param surface, mapped in @param raw. returns it in use
+    SurfacePtr add(const SurfacePtr& surface, const ImageRawPtr& raw);
+
+private:
+    VaapiEncSurfacePool(uint32_t fourcc, uint32_t width, uint32_t height, uint32_t size);
+    struct Item {
+        SurfacePtr surface;
+        //destroyed first, it unmaps and drops the derived image
+        ImageRawPtr raw;
+    };
+    struct SurfaceRecycler;
+    SurfacePtr wrap(const Item&);
+    void recycle(const Item&);
+
+    uint32_t m_fourcc;
+    uint32_t m_width;
+    uint32_t m_height;
+    uint32_t m_size;
+
+    Lock m_lock;
+    std::deque<Item> m_free;
+
+    DISALLOW_COPY_AND_ASSIGN(VaapiEncSurfacePool);
+};
+
+} //namespace YamiMediaCodec
+
+#endif //vaapiencsurfacepool_h
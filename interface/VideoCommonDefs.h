@@ -154,6 +154,10 @@ typedef struct VideoFrame {
 
 #define YAMI_MIME_H264 "video/h264"
 #define YAMI_MIME_AVC  "video/avc"
+#define YAMI_MIME_H265 "video/h265"
+#define YAMI_MIME_HEVC "video/hevc"
+#define YAMI_MIME_MPEG2 "video/mpeg2"
+#define YAMI_MIME_VC1  "video/vc1"
 #define YAMI_MIME_VP8  "video/x-vnd.on2.vp8"
 #define YAMI_MIME_VP9  "video/x-vnd.on2.vp9"
 #define YAMI_MIME_JPEG "image/jpeg"
@@ -61,6 +61,7 @@ typedef enum {
     HAS_VA_PROFILE = 0x08,
 
     // indicate whether output order will be the same as decoder order
+    // h264 outputs pictures as soon as output order allows, see VideoConfigBuffer::maxReorderFrames
     WANT_LOW_DELAY = 0x10,      // make display order same as decoding order
 
     // indicates whether error concealment algorithm should be enabled to automatically conceal error.
@@ -99,6 +100,25 @@ typedef enum {
     // the input data is in avcC format (not byte stream)  for h264
     IS_AVCC = IS_NAL_UNIT << 1, // 0x20000
 
+    // the input data is an arbitrary chunk of a byte stream, NAL units may span buffers.
+    // the decoder consumes every chunk, do not send it again after DECODE_FORMAT_CHANGE:
+    // the data after the format change is kept and decoded with the next chunk or at EOS
+    IS_STREAM_CHUNK = IS_AVCC << 1, // 0x40000
+
+    // send all slices of a picture in one slice data and one slice parameter buffer
+    WANT_PACKED_SLICES = IS_STREAM_CHUNK << 1, // 0x80000
+
+    // do not wait for the hardware in getOutput while it is still decoding the frame,
+    // see VideoConfigBuffer::maxInFlightFrames
+    WANT_ASYNC_OUTPUT = WANT_PACKED_SLICES << 1, // 0x100000
+
+    // drop pictures nothing else refers to before they are parsed,
+    // nal_ref_idc == 0 for h264, frames refreshing no reference for vp8/vp9
+    WANT_SKIP_NON_REFERENCE = WANT_ASYNC_OUTPUT << 1, // 0x200000
+
+    // decode IDR/key frames only and drop everything in between, for thumbnails and trick play
+    WANT_KEY_FRAMES_ONLY = WANT_SKIP_NON_REFERENCE << 1, // 0x400000
+
 } VIDEO_BUFFER_FLAG;
 
 typedef struct {
@@ -136,6 +156,15 @@ typedef struct {
     uint32_t rotationDegrees;
 
     void *parser_handle;
+    /// pictures that may precede another one in output order, used with WANT_LOW_DELAY
+    /// when the stream does not signal it. 0 outputs every picture right after decoding
+    uint32_t maxReorderFrames;
+    /// decoded frames that may still be in the hardware before getOutput waits for the oldest one,
+    /// used with WANT_ASYNC_OUTPUT. getOutput also waits when the decoder has no free surface left
+    uint32_t maxInFlightFrames;
+    /// threads copying VIDEO_DATA_MEMORY_TYPE_RAW_COPY output, big planes are split in row bands.
+    /// 0 or 1 copies on the thread calling getOutput
+    uint32_t copyThreads;
 }VideoConfigBuffer;
 
 typedef struct {
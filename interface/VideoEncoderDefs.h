@@ -323,6 +323,9 @@ typedef enum {
     //format related
     VideoConfigTypeAVCStreamFormat,
 
+    //threads copying VideoFrameRawData input
+    VideoConfigTypeCopyThreads,
+
     VideoParamsConfigExtension
 }VideoParamConfigType;
 
@@ -446,6 +449,15 @@ typedef struct VideoConfigAVCStreamFormat {
     AVCStreamFormat streamFormat;
 } VideoConfigAVCStreamFormat;
 
+typedef struct VideoConfigCopyThreads {
+    uint32_t size;
+    //big planes are split in row bands over the threads, 0 or 1 copies on the thread calling encode
+    uint32_t threads;
+} VideoConfigCopyThreads;
+
+// getStatistics() fills the whole struct, new fields are only appended.
+// it grew after 0.2.5 (coded_buffer_*, rendered_pictures, va_calls),
+// clients built against older headers must be rebuilt.
 typedef struct {
     uint32_t total_frames;
     uint32_t skipped_frames;
@@ -454,6 +466,12 @@ typedef struct {
     uint32_t max_encode_frame;
     uint32_t min_encode_time;
     uint32_t min_encode_frame;
+    //coded buffers reused from the pool and newly created
+    uint32_t coded_buffer_hits;
+    uint32_t coded_buffer_misses;
+    //pictures sent to the driver and the va calls it took, va_calls / rendered_pictures per frame
+    uint32_t rendered_pictures;
+    uint32_t va_calls;
 } VideoStatistics;
 
 #ifdef __cplusplus
@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include "decodeinput.h"
 #include "common/log.h"
+#include "codecparsers/startcode.h"
 
 #ifdef __ENABLE_AVFORMAT__
 #include "decodeinputavformat.h"
@@ -73,7 +74,7 @@ public:
     ~DecodeInputRaw();
     bool init();
     bool ensureBufferData();
-    int32_t scanForStartCode(const uint8_t * data, uint32_t offset, uint32_t size);
+    virtual int32_t scanForStartCode(const uint8_t * data, uint32_t offset, uint32_t size);
     bool getNextDecodeUnit(VideoDecodeBuffer &inputBuffer);
     virtual bool isSyncWord(const uint8_t* buf) = 0;
 
@@ -89,9 +90,28 @@ public:
     DecodeInputH264();
     ~DecodeInputH264();
     const char * getMimeType();
+    int32_t scanForStartCode(const uint8_t * data, uint32_t offset, uint32_t size);
     bool isSyncWord(const uint8_t* buf);
 };
 
+class DecodeInputH265:public DecodeInputH264
+{
+public:
+    const char * getMimeType();
+};
+
+class DecodeInputMPEG2:public DecodeInputH264
+{
+public:
+    const char * getMimeType();
+};
+
+class DecodeInputVC1:public DecodeInputH264
+{
+public:
+    const char * getMimeType();
+};
+
 class DecodeInputJPEG:public DecodeInputRaw
 {
 public:
@@ -120,6 +140,18 @@ DecodeInput* DecodeInput::create(const char* fileName)
         strcasecmp(ext,"jvt")==0 ) {
             input = new DecodeInputH264();
         }
+    else if(strcasecmp(ext,"h265")==0 ||
+        strcasecmp(ext,"265")==0 ||
+        strcasecmp(ext,"hevc")==0) {
+            input = new DecodeInputH265();
+        }
+    else if(strcasecmp(ext,"m2v")==0 ||
+        strcasecmp(ext,"mpv")==0) {
+            input = new DecodeInputMPEG2();
+        }
+    else if(strcasecmp(ext,"vc1")==0) {
+            input = new DecodeInputVC1();
+        }
     else if((strcasecmp(ext,"ivf")==0) ||
             (strcasecmp(ext,"vp8")==0) ||
             (strcasecmp(ext,"vp9")==0)) {
@@ -355,11 +387,36 @@ const char *DecodeInputH264::getMimeType()
     return YAMI_MIME_H264;
 }
 
+int32_t DecodeInputH264::scanForStartCode(const uint8_t * data,
+                 uint32_t offset, uint32_t size)
+{
+    if (offset + StartCodeSize > size)
+        return -1;
+    return start_code_find(data + offset, size - offset);
+}
+
 bool DecodeInputH264::isSyncWord(const uint8_t* buf)
 {
     return buf[0] == 0 && buf[1] == 0 && buf[2] == 1;
 }
 
+const char *DecodeInputH265::getMimeType()
+{
+    return YAMI_MIME_H265;
+}
+
+// mpeg2 start codes share the 3-byte prefix of h264
+const char *DecodeInputMPEG2::getMimeType()
+{
+    return YAMI_MIME_MPEG2;
+}
+
+// only advanced profile elementary streams carry start codes
+const char *DecodeInputVC1::getMimeType()
+{
+    return YAMI_MIME_VC1;
+}
+
 DecodeInputJPEG::DecodeInputJPEG()
 {
     StartCodeSize = 2;
@@ -82,6 +82,13 @@ static const MimeEntry MimeEntrys[] = {
     AV_CODEC_ID_VP9, YAMI_MIME_VP9,
 #endif
 
+#if LIBAVCODEC_VERSION_INT > AV_VERSION_INT(55, 24, 0)
+    AV_CODEC_ID_HEVC, YAMI_MIME_H265,
+#endif
+
+    AV_CODEC_ID_MPEG2VIDEO, YAMI_MIME_MPEG2,
+    AV_CODEC_ID_VC1, YAMI_MIME_VC1,
+    AV_CODEC_ID_WMV3, YAMI_MIME_VC1,
     AV_CODEC_ID_H264, YAMI_MIME_H264
 };
 
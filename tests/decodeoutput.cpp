@@ -26,6 +26,7 @@
 #endif
 
 #include "decodeoutput.h"
+#include "common/colorconvert.h"
 #include "common/log.h"
 #include "common/utils.h"
 #include <sys/stat.h>
@@ -88,62 +89,27 @@ struct ColorConvert
             //pass through
             return frame;
         }
-        assert(m_destFourcc == VA_FOURCC_I420 && frame->fourcc == VA_FOURCC_NV12);
+        assert(isConvertSupported(frame->fourcc, m_destFourcc));
 
         uint32_t width[3];
         uint32_t height[3];
         uint32_t planes;
-        if (!getPlaneResolution(frame->fourcc, frame->width, frame->height, width, height, planes))
+        if (!getPlaneResolution(m_destFourcc, frame->width, frame->height, width, height, planes))
             return NULL;
-        return NV12ToI420(frame, width, height);
-    }
+        uint32_t size = 0;
+        for (uint32_t i = 0; i < planes; i++)
+            size += width[i] * height[i];
+        m_data.resize(size);
 
-private:
-    VideoFrameRawData* NV12ToI420(VideoFrameRawData* frame, uint32_t width[3], uint32_t height[3])
-    {
-        m_data.clear();
         memset(&m_converted, 0, sizeof(m_converted));
-        m_converted.memoryType = VIDEO_DATA_MEMORY_TYPE_RAW_POINTER;
-        m_converted.fourcc = m_destFourcc;
-        m_converted.width = frame->width;
-        m_converted.height = frame->height;
-        uint8_t* data = reinterpret_cast<uint8_t*>(frame->handle);
-        copyY(m_data, data, frame->offset[0], width[0], height[0], frame->pitch[0]);
-        m_converted.pitch[0] = width[0];
-        for (int i = 1; i < 3; i++) {
-            m_converted.offset[i] = m_data.size();
-            m_converted.pitch[i] = width[1]>>1;
-            copyUV(m_data, data, frame->offset[1] + (i - 1), width[1], height[1], frame->pitch[1]);
-        }
-        m_converted.handle = reinterpret_cast<intptr_t>(&m_data[0]);
+        if (!fillFrameRawData(&m_converted, m_destFourcc, frame->width, frame->height, &m_data[0]))
+            return NULL;
+        if (!convertFrame(&m_converted, frame))
+            return NULL;
         return &m_converted;
     }
-    static void copyY(std::vector<uint8_t>& v, uint8_t* data, uint32_t offset, uint32_t width,
-        uint32_t height, uint32_t pitch)
-    {
-        data += offset;
-        for (int h = 0; h < height; h++) {
-            v.insert(v.end(), data, data + width);
-            data += pitch;
-        }
-
-    }
-    static void copyUV(std::vector<uint8_t>& v, uint8_t* data, uint32_t offset, uint32_t width,
-        uint32_t height, uint32_t pitch)
-    {
-        data += offset;
-        for (int h = 0; h < height; h++) {
-            uint8_t* start = data;
-            uint8_t* end = data + width;
-            while (start < end) {
-                v.push_back(*start);
-                start += 2 ;
-            }
-            data += pitch;
-        }
-
-    }
 
+private:
     uint32_t m_destFourcc;
     VideoFrameRawData m_converted;
     std::vector<uint8_t> m_data;
@@ -0,0 +1,135 @@
+/*
+ *  h264dpbbench.cpp - time the h264 DPB on a synthetic IBBP stream
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#include "decoder/vaapidecoder_h264.h"
+
+using namespace YamiMediaCodec;
+
+typedef VaapiDecPictureH264::PicturePtr PicturePtr;
+
+static int32_t s_lastPoc;
+static uint32_t s_outputs;
+static bool s_inOrder = true;
+
+static bool outputFrame(const PicturePtr& picture)
+{
+    if (!picture || (s_outputs && picture->m_POC <= s_lastPoc))
+        s_inOrder = false;
+    else
+        s_lastPoc = picture->m_POC;
+    s_outputs++;
+    return true;
+}
+
+/* decoding order I0 P3 B1 B2 P6 B4 B5 ..., B pictures are not referenced */
+static void makeStream(std::vector<PicturePtr>& pictures, uint32_t numPictures)
+{
+    uint32_t i, display;
+
+    for (i = 0; i < numPictures; i++) {
+        if (!i)
+            display = 0;
+        else if (i % 3 == 1)
+            display = i + 2;
+        else
+            display = i - 1;
+        PicturePtr picture(new VaapiDecPictureH264(ContextPtr(), SurfacePtr(), display));
+        picture->m_structure = VAAPI_PICTURE_STRUCTURE_FRAME;
+        picture->m_picStructure = VAAPI_PICTURE_STRUCTURE_FRAME;
+        picture->m_POC = display * 2;
+        picture->m_frameNum = (i + 2) / 3;
+        picture->m_outputFlag = true;
+        if (i % 3 < 2)
+            VAAPI_PICTURE_FLAG_SET(picture, VAAPI_PICTURE_FLAG_SHORT_TERM_REFERENCE);
+        if (!i)
+            VAAPI_PICTURE_FLAG_SET(picture, VAAPI_PICTURE_FLAG_IDR);
+        pictures.push_back(picture);
+    }
+}
+
+/* what VaapiDecoderH264::markingPicture() and storeDecodedPicture() do
+ * for progressive frames with a sliding window of numRefs references */
+static bool decodeStream(const std::vector<PicturePtr>& pictures,
+                         uint32_t DPBSize, uint32_t numRefs)
+{
+    VaapiDPBManager dpb(outputFrame, DPBSize);
+    std::vector<VaapiDecPictureH264*> refs;
+    VaapiFrameStore* current = NULL;
+    uint32_t i;
+
+    for (i = 0; i < pictures.size(); i++) {
+        const PicturePtr& picture = pictures[i];
+        if (VAAPI_PICTURE_IS_REFERENCE(picture)) {
+            if (refs.size() == numRefs) {
+                VAAPI_PICTURE_FLAG_UNSET(refs.front(), VAAPI_PICTURE_FLAGS_REFERENCE);
+                refs.erase(refs.begin());
+            }
+            refs.push_back(picture.get());
+        }
+        if (current)
+            current->unuse(FRAME_STORE_CURRENT);
+        current = dpb.newFrameStore(picture);
+        if (!current)
+            return false;
+        current->use(FRAME_STORE_CURRENT);
+        if (!dpb.addDPB(current, picture))
+            return false;
+    }
+    if (current)
+        current->unuse(FRAME_STORE_CURRENT);
+    dpb.flushDPB();
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numPictures = argc > 1 ? atoi(argv[1]) : 300000;
+    const uint32_t DPBSize = 16, numRefs = 4;
+    std::vector<PicturePtr> pictures;
+    struct timespec start, end;
+    double ns;
+
+    makeStream(pictures, numPictures);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!decodeStream(pictures, DPBSize, numRefs)) {
+        fprintf(stderr, "dpb failed after %d outputs\n", s_outputs);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (!s_inOrder || s_outputs != numPictures) {
+        fprintf(stderr, "wrong output: %d of %d pictures, in order: %d\n",
+                s_outputs, numPictures, s_inOrder);
+        return 1;
+    }
+    ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("h264 dpb: %d pictures, dpb size %d, %d references, %.1f ns per picture\n",
+           numPictures, DPBSize, numRefs, ns / numPictures);
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ *  h265dpbtest.cpp - drive the h265 DPB with synthetic POC and RPS sequences
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "decoder/vaapidecoder_h265.h"
+
+using namespace YamiMediaCodec;
+
+typedef H265DPB::PicturePtr PicturePtr;
+
+static std::vector<int32_t> s_outputs;
+
+static bool outputPicture(const PicturePtr& picture)
+{
+    s_outputs.push_back(picture->m_poc);
+    return true;
+}
+
+struct TestPicture {
+    uint32_t nalType;
+    int32_t poc;
+    // delta POCs of the short term RPS, the pictures are all used by the current one
+    std::vector<int32_t> before;
+    std::vector<int32_t> after;
+};
+
+/* an IDR, then gops in the decoding order P4 B2 b1 b3 of a hierarchical B
+ * structure, POC 4 references POC 0, B2 references 0 and 4, b1 and b3 the
+ * pictures around them. with a 4 bit POC lsb the lsb wraps every 4 gops */
+static void makeGops(std::vector<TestPicture>& pictures, uint32_t numGops)
+{
+    static const int32_t order[] = { 4, 2, 1, 3 };
+    TestPicture idr;
+
+    idr.nalType = H265_NAL_SLICE_IDR_W_RADL;
+    idr.poc = 0;
+    pictures.push_back(idr);
+    for (uint32_t g = 0; g < numGops; g++) {
+        for (uint32_t k = 0; k < 4; k++) {
+            TestPicture picture;
+            picture.nalType = H265_NAL_SLICE_TRAIL_R;
+            picture.poc = g * 4 + order[k];
+            switch (order[k]) {
+            case 4:
+                picture.before.push_back(-4);
+                break;
+            case 2:
+                picture.before.push_back(-2);
+                picture.after.push_back(2);
+                break;
+            case 1:
+                picture.before.push_back(-1);
+                picture.after.push_back(1);
+                picture.after.push_back(3);
+                break;
+            default:
+                picture.before.push_back(-1);
+                picture.after.push_back(1);
+                break;
+            }
+            pictures.push_back(picture);
+        }
+    }
+}
+
+static bool decodeStream(const std::vector<TestPicture>& pictures)
+{
+    H265SPS sps;
+    H265PPS pps;
+    H265DPB dpb(outputPicture);
+    H265Picture* refPicList0[H265_MAX_REFERENCES];
+    H265Picture* refPicList1[H265_MAX_REFERENCES];
+    uint32_t i, j;
+
+    memset(&sps, 0, sizeof(sps));
+    memset(&pps, 0, sizeof(pps));
+    sps.log2_max_pic_order_cnt_lsb_minus4 = 0;
+    sps.max_num_reorder_pics[0] = 2;
+    sps.max_dec_pic_buffering_minus1[0] = 4;
+    pps.sps = &sps;
+
+    for (i = 0; i < pictures.size(); i++) {
+        const TestPicture& test = pictures[i];
+        H265NalUnit nalu;
+        H265SliceHdr slice;
+
+        memset(&nalu, 0, sizeof(nalu));
+        nalu.type = test.nalType;
+        nalu.temporal_id_plus1 = 1;
+        memset(&slice, 0, sizeof(slice));
+        slice.pps = &pps;
+        slice.type = H265_B_SLICE;
+        slice.pic_order_cnt_lsb = test.poc & 15;
+        slice.num_ref_idx_l0_active_minus1 = 1;
+        slice.num_ref_idx_l1_active_minus1 = 1;
+        H265ShortTermRefPicSet& rps = slice.short_term_ref_pic_sets;
+        rps.NumNegativePics = test.before.size();
+        rps.NumPositivePics = test.after.size();
+        for (j = 0; j < test.before.size(); j++) {
+            rps.DeltaPocS0[j] = test.before[j];
+            rps.UsedByCurrPicS0[j] = 1;
+        }
+        for (j = 0; j < test.after.size(); j++) {
+            rps.DeltaPocS1[j] = test.after[j];
+            rps.UsedByCurrPicS1[j] = 1;
+        }
+
+        PicturePtr picture(new H265Picture);
+        picture->m_outputNeeded = true;
+        if (!dpb.startPicture(picture, &nalu, &slice, H265_NAL_IS_IRAP(test.nalType)))
+            return false;
+        if (picture->m_poc != test.poc) {
+            fprintf(stderr, "picture %d: POC %d, expected %d\n", i, picture->m_poc, test.poc);
+            return false;
+        }
+        for (j = 0; j < dpb.m_stCurrBefore.size(); j++) {
+            if (!dpb.m_stCurrBefore[j] || dpb.m_stCurrBefore[j]->m_poc != test.poc + test.before[j]) {
+                fprintf(stderr, "picture %d: RefPicSetStCurrBefore[%d] is wrong\n", i, j);
+                return false;
+            }
+        }
+        for (j = 0; j < dpb.m_stCurrAfter.size(); j++) {
+            if (!dpb.m_stCurrAfter[j] || dpb.m_stCurrAfter[j]->m_poc != test.poc + test.after[j]) {
+                fprintf(stderr, "picture %d: RefPicSetStCurrAfter[%d] is wrong\n", i, j);
+                return false;
+            }
+        }
+
+        // 8.3.4, list 0 starts with the pictures before, list 1 with the ones after
+        dpb.initRefPicLists(&slice, refPicList0, refPicList1);
+        if (test.poc % 4 == 1) {
+            if (!refPicList0[0] || refPicList0[0]->m_poc != test.poc - 1
+                || !refPicList0[1] || refPicList0[1]->m_poc != test.poc + 1
+                || !refPicList1[0] || refPicList1[0]->m_poc != test.poc + 1
+                || !refPicList1[1] || refPicList1[1]->m_poc != test.poc + 3
+                || refPicList0[2] || refPicList1[2]) {
+                fprintf(stderr, "picture %d: wrong reference picture lists\n", i);
+                return false;
+            }
+        }
+        if (!dpb.finishPicture(picture))
+            return false;
+    }
+    dpb.flush();
+    return true;
+}
+
+/* the outputs of each coded video sequence come in POC order */
+static bool checkOutputs(uint32_t numSequences, uint32_t picturesPerSequence)
+{
+    uint32_t i;
+
+    if (s_outputs.size() != numSequences * picturesPerSequence) {
+        fprintf(stderr, "%d pictures out, expected %d\n",
+                (int)s_outputs.size(), numSequences * picturesPerSequence);
+        return false;
+    }
+    for (i = 0; i < s_outputs.size(); i++) {
+        if (s_outputs[i] != (int32_t)(i % picturesPerSequence)) {
+            fprintf(stderr, "output %d has POC %d\n", i, s_outputs[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numGops = argc > 1 ? atoi(argv[1]) : 50;
+    std::vector<TestPicture> pictures;
+
+    makeGops(pictures, numGops);
+    if (!decodeStream(pictures) || !checkOutputs(1, pictures.size()))
+        return 1;
+
+    // a second IDR flushes the first sequence and starts the POC again
+    s_outputs.clear();
+    makeGops(pictures, numGops);
+    if (!decodeStream(pictures) || !checkOutputs(2, pictures.size() / 2))
+        return 1;
+
+    printf("h265 dpb: %d gops with wrapping POC lsb, and two sequences, decoded in order\n",
+           numGops);
+    return 0;
+}
@@ -0,0 +1,313 @@
+/*
+ *  nalreaderbench.c - check NalReader against a plain bit reader and time
+ *                     slice header like parsing with both
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "codecparsers/nalutils.h"
+
+#define MAX_RBSP_SIZE 2048
+
+/* reads the rbsp one bit at a time, the way the spec describes it */
+typedef struct
+{
+  uint8_t rbsp[MAX_RBSP_SIZE];
+  uint32_t size;                /* in bits */
+  uint32_t pos;                 /* in bits */
+  uint32_t last_one;            /* position of the rbsp_stop_one_bit */
+} RefReader;
+
+static void
+ref_reader_init (RefReader * ref, const uint8_t * data, uint32_t size)
+{
+  uint32_t i, zeros = 0, n = 0;
+
+  for (i = 0; i < size; i++) {
+    if (zeros >= 2 && data[i] == 3) {
+      zeros = 0;
+      continue;
+    }
+    zeros = data[i] ? 0 : zeros + 1;
+    ref->rbsp[n++] = data[i];
+  }
+  ref->size = n * 8;
+  ref->pos = 0;
+  ref->last_one = 0;
+  while (n && !ref->rbsp[n - 1])
+    n--;
+  if (n) {
+    ref->last_one = n * 8 - 1;
+    while (!(ref->rbsp[n - 1] & (0x80 >> (ref->last_one % 8))))
+      ref->last_one--;
+  }
+}
+
+static bool
+ref_reader_get_bits (RefReader * ref, uint32_t * val, uint32_t nbits)
+{
+  uint32_t i;
+
+  if (ref->pos + nbits > ref->size)
+    return FALSE;
+  *val = 0;
+  for (i = 0; i < nbits; i++, ref->pos++)
+    *val = (*val << 1) | ((ref->rbsp[ref->pos / 8] >> (7 - ref->pos % 8)) & 1);
+  return TRUE;
+}
+
+/* returns FALSE on a short read, *defined is FALSE for prefixes past 31 */
+static bool
+ref_reader_get_ue (RefReader * ref, uint32_t * val, bool * defined)
+{
+  uint32_t bit, zeros = 0, value;
+
+  *defined = TRUE;
+  while (1) {
+    if (!ref_reader_get_bits (ref, &bit, 1))
+      return FALSE;
+    if (bit)
+      break;
+    zeros++;
+  }
+  if (zeros > 31) {
+    *defined = FALSE;
+    return FALSE;
+  }
+  if (!ref_reader_get_bits (ref, &value, zeros))
+    return FALSE;
+  *val = (1u << zeros) - 1 + value;
+  return TRUE;
+}
+
+static bool
+ref_reader_has_more_data (RefReader * ref)
+{
+  return ref->pos < ref->last_one;
+}
+
+/* adds emulation prevention bytes to the rbsp */
+static uint32_t
+escape (const uint8_t * rbsp, uint32_t size, uint8_t * data)
+{
+  uint32_t i, zeros = 0, n = 0;
+
+  for (i = 0; i < size; i++) {
+    if (zeros >= 2 && rbsp[i] <= 3) {
+      data[n++] = 3;
+      zeros = 0;
+    }
+    data[n++] = rbsp[i];
+    zeros = rbsp[i] ? 0 : zeros + 1;
+  }
+  return n;
+}
+
+static bool
+check_random (uint32_t rounds)
+{
+  uint8_t rbsp[MAX_RBSP_SIZE], data[MAX_RBSP_SIZE * 2];
+  static RefReader ref;
+  NalReader nr;
+  uint32_t i, j, step, size, nbits, val, ref_val;
+  int32_t sval;
+  bool ret, ref_ret, defined;
+
+  for (i = 0; i < rounds; i++) {
+    /* plenty of zeros, so emulation prevention bytes and long codes show up */
+    size = 1 + rand () % (MAX_RBSP_SIZE - 1);
+    for (j = 0; j < size; j++) {
+      uint32_t r = rand () % 6;
+      rbsp[j] = r < 2 ? 0 : (r == 2 ? 3 : (r == 3 ? 1 : rand ()));
+    }
+    /* NalReader counts emulation prevention bytes in zeros trailing the
+     * rbsp as data, a real rbsp ends with its stop bit */
+    rbsp[size - 1] |= 1;
+    size = escape (rbsp, size, data);
+    nal_reader_init (&nr, data, size);
+    ref_reader_init (&ref, data, size);
+
+    for (step = 0; step < 600; step++) {
+      uint32_t op = rand () % 5;
+
+      val = ref_val = 0;
+      nbits = rand () % 33;
+      defined = TRUE;
+      switch (op) {
+        case 0:
+          ret = nal_reader_get_bits_uint32 (&nr, &val, nbits);
+          ref_ret = ref_reader_get_bits (&ref, &ref_val, nbits);
+          break;
+        case 1:{
+          uint8_t v8 = 0;
+          nbits %= 9;
+          ret = nal_reader_get_bits_uint8 (&nr, &v8, nbits);
+          val = v8;
+          ref_ret = ref_reader_get_bits (&ref, &ref_val, nbits);
+          break;
+        }
+        case 2:
+          ref_ret = ref_reader_get_ue (&ref, &ref_val, &defined);
+          ret = defined ? nal_reader_get_ue (&nr, &val) : FALSE;
+          break;
+        case 3:
+          ref_ret = ref_reader_get_ue (&ref, &ref_val, &defined);
+          ret = defined ? nal_reader_get_se (&nr, &sval) : FALSE;
+          val = sval;
+          if (ref_ret)
+            ref_val = ref_val % 2 ? ref_val / 2 + 1 : -(ref_val / 2);
+          break;
+        default:
+          ret = nal_reader_has_more_data (&nr);
+          ref_ret = ref_reader_has_more_data (&ref);
+          break;
+      }
+      if (!defined)
+        break;
+      if (ret != ref_ret || (op < 4 && ret && val != ref_val)) {
+        fprintf (stderr, "mismatch in buffer %d, step %d, op %d, %d bits: "
+            "returned %d/%d, value %u/%u\n", i, step, op, nbits, ret, ref_ret,
+            val, ref_val);
+        return FALSE;
+      }
+      if (op < 4 && !ret)
+        break;
+      if (nal_reader_is_byte_aligned (&nr) != !(ref.pos % 8)) {
+        fprintf (stderr, "alignment mismatch in buffer %d, step %d\n", i, step);
+        return FALSE;
+      }
+    }
+  }
+  return TRUE;
+}
+
+static void
+put_bits (uint8_t * data, uint32_t * pos, uint32_t val, uint32_t nbits)
+{
+  while (nbits--) {
+    if ((val >> nbits) & 1)
+      data[*pos / 8] |= 0x80 >> (*pos % 8);
+    (*pos)++;
+  }
+}
+
+static void
+put_ue (uint8_t * data, uint32_t * pos, uint32_t val)
+{
+  uint32_t nbits = 0;
+
+  while ((val + 1) >> (nbits + 1))
+    nbits++;
+  put_bits (data, pos, 0, nbits);
+  put_bits (data, pos, val + 1, nbits + 1);
+}
+
+/* the field mix of a slice header: ue(0..3), u(1), ue(0..39), u(4), ue(0..299) */
+#define FIELDS_PER_GROUP 5
+#define NUM_GROUPS (MAX_RBSP_SIZE * 8 / 48)
+
+static uint32_t
+make_headers (uint8_t * data)
+{
+  static uint8_t rbsp[MAX_RBSP_SIZE];
+  uint32_t i, pos = 0;
+
+  for (i = 0; i < NUM_GROUPS; i++) {
+    put_ue (rbsp, &pos, rand () % 4);
+    put_bits (rbsp, &pos, rand () % 2, 1);
+    put_ue (rbsp, &pos, rand () % 40);
+    put_bits (rbsp, &pos, rand () % 16, 4);
+    put_ue (rbsp, &pos, rand () % 300);
+  }
+  put_bits (rbsp, &pos, 1, 1);
+  return escape (rbsp, (pos + 7) / 8, data);
+}
+
+static double
+seconds_since (const struct timespec *start)
+{
+  struct timespec end;
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int
+main (int argc, char **argv)
+{
+  uint32_t rounds = argc > 1 ? atoi (argv[1]) : 20000;
+  const uint32_t loops = 20000;
+  static uint8_t data[MAX_RBSP_SIZE * 2];
+  static RefReader ref;
+  NalReader nr;
+  uint32_t i, j, size, val, sum = 0, ref_sum = 0;
+  bool defined;
+  struct timespec start;
+  double seconds, ref_seconds;
+
+  srand (1);
+  if (!check_random (rounds))
+    return 1;
+
+  size = make_headers (data);
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < loops; i++) {
+    nal_reader_init (&nr, data, size);
+    for (j = 0; j < NUM_GROUPS * FIELDS_PER_GROUP; j++) {
+      if (j % FIELDS_PER_GROUP == 1)
+        nal_reader_get_bits_uint32 (&nr, &val, 1);
+      else if (j % FIELDS_PER_GROUP == 3)
+        nal_reader_get_bits_uint32 (&nr, &val, 4);
+      else
+        nal_reader_get_ue (&nr, &val);
+      sum += val;
+    }
+  }
+  seconds = seconds_since (&start);
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < loops; i++) {
+    ref_reader_init (&ref, data, size);
+    for (j = 0; j < NUM_GROUPS * FIELDS_PER_GROUP; j++) {
+      if (j % FIELDS_PER_GROUP == 1)
+        ref_reader_get_bits (&ref, &val, 1);
+      else if (j % FIELDS_PER_GROUP == 3)
+        ref_reader_get_bits (&ref, &val, 4);
+      else
+        ref_reader_get_ue (&ref, &val, &defined);
+      ref_sum += val;
+    }
+  }
+  ref_seconds = seconds_since (&start);
+
+  if (sum != ref_sum) {
+    fprintf (stderr, "header fields differ: sum %u/%u\n", sum, ref_sum);
+    return 1;
+  }
+  printf ("nal reader: %d random buffers match, NalReader %.0f MB/s, "
+      "bit by bit reader %.0f MB/s\n", rounds,
+      loops * (size / 1e6) / seconds, loops * (size / 1e6) / ref_seconds);
+  return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ *  planecopybench.cpp - check copyPlaneSSE4_1() against copyPlaneC() and
+ *                       time both
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "common/planecopy.h"
+
+using namespace YamiMediaCodec;
+
+typedef void (*CopyPlaneFunc)(uint8_t*, uint32_t, const uint8_t*, uint32_t, uint32_t, uint32_t);
+
+static void fillRandom(std::vector<uint8_t>& data)
+{
+    for (uint32_t i = 0; i < data.size(); i++)
+        data[i] = rand() >> 8;
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+/* unaligned heads and tails, odd pitches, and rows longer than the bounce buffer */
+static bool checkRandom(uint32_t rounds)
+{
+    std::vector<uint8_t> src(64 * 1024), dest(64 * 1024), expected(64 * 1024);
+    uint32_t i, srcOffset, destOffset, width, height, srcPitch, destPitch;
+
+    for (i = 0; i < rounds; i++) {
+        fillRandom(src);
+        srcOffset = rand() % 64;
+        destOffset = rand() % 64;
+        width = i % 8 ? rand() % 300 : rand() % 10000;
+        height = 1 + rand() % 5;
+        srcPitch = width + rand() % 40;
+        destPitch = width + rand() % 40;
+        if (srcOffset + srcPitch * height > src.size()
+            || destOffset + destPitch * height > dest.size())
+            continue;
+        // the bytes between the rows and after the plane must stay untouched
+        memset(&dest[0], 0xa5, dest.size());
+        memset(&expected[0], 0xa5, expected.size());
+        copyPlaneC(&expected[destOffset], destPitch, &src[srcOffset], srcPitch, width, height);
+        copyPlaneSSE4_1(&dest[destOffset], destPitch, &src[srcOffset], srcPitch, width, height);
+        if (dest != expected) {
+            fprintf(stderr, "plane copy mismatch: src offset %d, dest offset %d, "
+                    "%dx%d, src pitch %d, dest pitch %d\n", srcOffset, destOffset,
+                    width, height, srcPitch, destPitch);
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+/* the luma plane of a 1080p NV12 surface */
+static double timeCopy(CopyPlaneFunc copy, std::vector<uint8_t>& dest,
+                       const std::vector<uint8_t>& src, uint32_t pitch,
+                       uint32_t width, uint32_t height, uint32_t loops)
+{
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < loops; i++)
+        copy(&dest[0], width, &src[0], pitch, width, height);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    const uint32_t width = 1920, height = 1088, pitch = 2048, loops = 200;
+    std::vector<uint8_t> src(pitch * height), dest(width * height);
+    double seconds;
+
+    srand(1);
+    fillRandom(src);
+    seconds = timeCopy(copyPlaneC, dest, src, pitch, width, height, loops);
+    printf("plane copy: copyPlaneC %.1f GB/s\n", loops * (width * height / 1e9) / seconds);
+
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("sse4.1")) {
+        printf("plane copy: no SSE4.1, copyPlaneSSE4_1 not checked\n");
+        return 0;
+    }
+    if (!checkRandom(rounds))
+        return 1;
+    fillRandom(src);
+    seconds = timeCopy(copyPlaneSSE4_1, dest, src, pitch, width, height, loops);
+    printf("plane copy: %d random planes match, copyPlaneSSE4_1 %.1f GB/s\n",
+           rounds, loops * (width * height / 1e9) / seconds);
+#endif
+    return 0;
+}
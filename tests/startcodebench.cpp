@@ -0,0 +1,145 @@
+/*
+ *  startcodebench.cpp - check start_code_find() against the portable
+ *                       scanner and time both
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#include "codecparsers/startcode.h"
+
+typedef int32_t (*FindFunc)(const uint8_t* data, uint32_t size);
+
+/* the byte by byte loop the decoder used before the scanner */
+static int32_t findReference(const uint8_t* data, uint32_t size, uint8_t last)
+{
+    uint32_t i;
+
+    for (i = 0; i + 2 < size; i++) {
+        if (!data[i] && !data[i + 1] && data[i + 2] == last)
+            return i;
+    }
+    return -1;
+}
+
+/* zeros, start codes and emulation prevention bytes every few bytes */
+static void fillRandom(std::vector<uint8_t>& data, uint32_t sparseness)
+{
+    uint32_t i;
+
+    for (i = 0; i < data.size(); i++) {
+        uint32_t r = rand();
+        if (r % sparseness)
+            data[i] = (r >> 8) | 1;
+        else
+            data[i] = (r >> 8) % 4;
+    }
+}
+
+static bool checkRandom(uint32_t rounds)
+{
+    std::vector<uint8_t> data(4096);
+    uint32_t i, offset, size;
+    int32_t expected;
+
+    for (i = 0; i < rounds; i++) {
+        fillRandom(data, 1 + i % 64);
+        // unaligned heads and tails, down to the empty buffer
+        offset = rand() % 64;
+        size = rand() % (data.size() - offset);
+        expected = findReference(&data[offset], size, 1);
+        if (start_code_find(&data[offset], size) != expected
+            || start_code_find_c(&data[offset], size) != expected) {
+            fprintf(stderr, "start code mismatch: offset %d, size %d, expected %d, "
+                    "got %d and %d (portable)\n", offset, size, expected,
+                    start_code_find(&data[offset], size),
+                    start_code_find_c(&data[offset], size));
+            return false;
+        }
+        expected = findReference(&data[offset], size, 3);
+        if (start_code_find_epb(&data[offset], size) != expected) {
+            fprintf(stderr, "emulation prevention mismatch: offset %d, size %d, "
+                    "expected %d, got %d\n", offset, size, expected,
+                    start_code_find_epb(&data[offset], size));
+            return false;
+        }
+    }
+    return true;
+}
+
+/* scan a stream with one start code every 256KB, like big slices do */
+static double timeScan(FindFunc find, const std::vector<uint8_t>& stream,
+                       uint32_t loops, uint32_t& found)
+{
+    struct timespec start, end;
+    uint32_t i, pos;
+    int32_t off;
+
+    found = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < loops; i++) {
+        pos = 0;
+        while ((off = find(&stream[pos], stream.size() - pos)) >= 0) {
+            found++;
+            pos += off + 3;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t rounds = argc > 1 ? atoi(argv[1]) : 100000;
+    const uint32_t streamSize = 64 * 1024 * 1024, loops = 4;
+    std::vector<uint8_t> stream(streamSize);
+    uint32_t i, found, foundPortable;
+    double seconds, secondsPortable;
+
+    srand(1);
+    if (!checkRandom(rounds))
+        return 1;
+
+    fillRandom(stream, 64);
+    for (i = 0; i + 2 < streamSize; i++) {
+        if (!stream[i] && !stream[i + 1] && stream[i + 2] == 1)
+            stream[i + 2] = 2;
+    }
+    for (i = 0; i + 3 < streamSize; i += 256 * 1024) {
+        stream[i] = stream[i + 1] = 0;
+        stream[i + 2] = 1;
+    }
+    seconds = timeScan(start_code_find, stream, loops, found);
+    secondsPortable = timeScan(start_code_find_c, stream, loops, foundPortable);
+    if (found != foundPortable || found != loops * (streamSize / (256 * 1024))) {
+        fprintf(stderr, "found %d and %d (portable) start codes\n", found, foundPortable);
+        return 1;
+    }
+    printf("start codes: %d random buffers match, start_code_find %.1f GB/s, "
+           "start_code_find_c %.1f GB/s\n", rounds,
+           loops * (streamSize / 1e9) / seconds,
+           loops * (streamSize / 1e9) / secondsPortable);
+    return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ *  surfacepoolstress.cpp - run the decoder surface pool between a decoder
+ *                          and a client thread with fake surface ids
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <deque>
+#include <vector>
+
+#include "decoder/vaapidecsurfacepool.h"
+#include "vaapi/vaapisurface.h"
+
+using namespace YamiMediaCodec;
+
+static const uint32_t NUM_SURFACES = 8;
+// sparse and unordered, like ids of surfaces from several vaCreateSurfaces calls
+static const VASurfaceID FIRST_ID = 0x4000;
+static const uint32_t ID_STRIDE = 5;
+
+struct Stress {
+    DecSurfacePoolPtr pool;
+    uint32_t numFrames;
+    // 1 while the surface is between acquireWithWait() and recycle()
+    uint32_t inUse[NUM_SURFACES];
+    bool failed;
+};
+
+static uint32_t surfaceIndex(VASurfaceID id)
+{
+    return (id - FIRST_ID) / ID_STRIDE;
+}
+
+/* takes the frames in output order and returns them late, a few at a time */
+static void* client(void* arg)
+{
+    Stress* stress = (Stress*)arg;
+    std::deque<VideoRenderBuffer*> held;
+    int64_t expected = 0;
+    uint32_t seed = 1;
+
+    while (expected < (int64_t)stress->numFrames || !held.empty()) {
+        VideoRenderBuffer* buffer = NULL;
+        if (expected < (int64_t)stress->numFrames)
+            buffer = stress->pool->getOutput();
+        if (buffer) {
+            if (buffer->timeStamp != expected++) {
+                fprintf(stderr, "frame %ld came out as %ld\n", (long)expected - 1, (long)buffer->timeStamp);
+                stress->failed = true;
+            }
+            held.push_back(buffer);
+        } else {
+            sched_yield();
+        }
+        seed = seed * 1103515245 + 12345;
+        if (!held.empty() && (!buffer || (seed >> 16) % 4 == 0 || held.size() == NUM_SURFACES)) {
+            buffer = held.front();
+            held.pop_front();
+            __sync_fetch_and_sub(&stress->inUse[surfaceIndex(buffer->surface)], 1);
+            stress->pool->recycle(buffer);
+        }
+    }
+    return NULL;
+}
+
+static void* acquireOne(void* arg)
+{
+    Stress* stress = (Stress*)arg;
+    SurfacePtr surface = stress->pool->acquireWithWait();
+    if (surface) {
+        fprintf(stderr, "acquireWithWait() returned a surface of an empty pool\n");
+        stress->failed = true;
+    }
+    return NULL;
+}
+
+/* the decoder thread */
+static bool decode(Stress* stress)
+{
+    uint32_t i, index;
+    pthread_t thread;
+
+    if (pthread_create(&thread, NULL, client, stress))
+        return false;
+    for (i = 0; i < stress->numFrames; i++) {
+        SurfacePtr surface = stress->pool->acquireWithWait();
+        if (!surface) {
+            fprintf(stderr, "no surface for frame %d\n", i);
+            stress->failed = true;
+            break;
+        }
+        index = surfaceIndex(surface->getID());
+        if (__sync_fetch_and_add(&stress->inUse[index], 1)) {
+            fprintf(stderr, "surface 0x%x handed out twice\n", surface->getID());
+            stress->failed = true;
+        }
+        if (!stress->pool->output(surface, i)) {
+            fprintf(stderr, "output of frame %d failed\n", i);
+            stress->failed = true;
+        }
+    }
+    pthread_join(thread, NULL);
+    return !stress->failed;
+}
+
+/* every surface must be back, and setWaitable(false) must wake a waiting decoder */
+static bool checkWakeUp(Stress* stress)
+{
+    std::vector<SurfacePtr> surfaces;
+    pthread_t thread;
+    uint32_t i;
+
+    for (i = 0; i < NUM_SURFACES; i++)
+        surfaces.push_back(stress->pool->acquireWithWait());
+    if (pthread_create(&thread, NULL, acquireOne, stress))
+        return false;
+    usleep(10000);
+    stress->pool->setWaitable(false);
+    pthread_join(thread, NULL);
+    stress->pool->setWaitable(true);
+    return !stress->failed;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<SurfacePtr> surfaces;
+    Stress stress;
+    struct timespec start, end;
+    double seconds;
+    uint32_t i;
+
+    stress.numFrames = argc > 1 ? atoi(argv[1]) : 200000;
+    stress.failed = false;
+    for (i = 0; i < NUM_SURFACES; i++) {
+        VASurfaceID id = FIRST_ID + ((i * 3) % NUM_SURFACES) * ID_STRIDE;
+        surfaces.push_back(SurfacePtr(new VaapiSurface(DisplayPtr(), id)));
+        stress.inUse[i] = 0;
+    }
+    stress.pool = VaapiDecSurfacePool::create(DisplayPtr(), surfaces);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!decode(&stress))
+        return 1;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (!checkWakeUp(&stress))
+        return 1;
+
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("surface pool: %d frames through %d surfaces, %.0f ns per frame\n",
+           stress.numFrames, NUM_SURFACES, seconds * 1e9 / stress.numFrames);
+    return 0;
+}
@@ -36,8 +36,10 @@
 
 namespace YamiMediaCodec{
 VaapiBufObject::VaapiBufObject(const DisplayPtr& display,
-                               VABufferID bufID, void *buf, uint32_t size)
-:m_display(display), m_bufID(bufID), m_buf(buf), m_size(size)
+                               VABufferID bufID, void *buf, uint32_t size,
+                               uint32_t numElements)
+:m_display(display), m_bufID(bufID), m_buf(buf), m_size(size),
+m_numElements(numElements)
 {
 
 }
@@ -58,6 +60,11 @@ uint32_t VaapiBufObject::getSize()
     return m_size;
 }
 
+uint32_t VaapiBufObject::getNumElements() const
+{
+    return m_numElements;
+}
+
 void *VaapiBufObject::map()
 {
     if (m_buf)
@@ -83,11 +90,12 @@ bool VaapiBufObject::isMapped() const
 BufObjectPtr VaapiBufObject::create(const ContextPtr& context,
                                     VABufferType bufType,
                                     uint32_t size,
-                                    const void *data, void **mapped_data)
+                                    const void *data, void **mapped_data,
+                                    uint32_t numElements)
 {
     BufObjectPtr buf;
 
-    if (size == 0) {
+    if (size == 0 || numElements == 0) {
         ERROR("buffer size is zero");
         return buf;
     }
@@ -95,13 +103,13 @@ BufObjectPtr VaapiBufObject::create(const ContextPtr& context,
     DisplayPtr display = context->getDisplay();
     VABufferID bufID;
     if (!vaapiCreateBuffer(display->getID(), context->getID(),
-                           bufType, size, data, &bufID, mapped_data)) {
+                           bufType, size, data, &bufID, mapped_data, numElements)) {
         ERROR("create buffer failed");
         return buf;
     }
 
     void *mapped = mapped_data ? *mapped_data : NULL;
-    buf.reset(new VaapiBufObject(display, bufID, mapped, size));
+    buf.reset(new VaapiBufObject(display, bufID, mapped, size, numElements));
     return buf;
 }
 }
@@ -40,6 +40,7 @@ class VaapiBufObject {
     ~VaapiBufObject();
     VABufferID getID() const;
     uint32_t getSize();
+    uint32_t getNumElements() const;
     void *map();
     void unmap();
     bool isMapped() const;
@@ -47,14 +48,18 @@ class VaapiBufObject {
                                VABufferType bufType,
                                uint32_t size,
                                const void *data = 0,
-                               void **mapped_data = 0);
+                               void **mapped_data = 0,
+                               uint32_t numElements = 1);
 
   private:
-    VaapiBufObject(const DisplayPtr&, VABufferID, void *buf, uint32_t size);
+    VaapiBufObject(const DisplayPtr&, VABufferID, void *buf, uint32_t size,
+                   uint32_t numElements);
     DisplayPtr m_display;
     VABufferID m_bufID;
     void *m_buf;
+    // size of one element, arrays such as packed slice parameters have more
     uint32_t m_size;
+    uint32_t m_numElements;
 };
 }
 #endif                          /* VAAPIBUFFER_H */
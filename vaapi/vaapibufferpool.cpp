@@ -0,0 +1,140 @@
+/*
+ *  vaapibufferpool.cpp - va buffer pool
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "vaapibufferpool.h"
+
+#include "common/log.h"
+#include "vaapi/vaapibuffer.h"
+#include <string.h>
+
+namespace YamiMediaCodec{
+
+// free buffers kept for one type and size class, the rest are destroyed
+static const uint32_t BUFFER_POOL_MAX_FREE = 64;
+// free buffers kept for all keys together
+static const uint32_t BUFFER_POOL_MAX_TOTAL_FREE = 256;
+// free buffers of a key which are not reused yet. the hardware may still read the
+// last ones released, mapping them would wait for it
+static const uint32_t BUFFER_POOL_MIN_HELD = 3;
+static const uint32_t BUFFER_POOL_MIN_DATA_SIZE = 4096;
+
+BufferPoolPtr VaapiBufferPool::create()
+{
+    BufferPoolPtr pool(new VaapiBufferPool());
+    return pool;
+}
+
+VaapiBufferPool::VaapiBufferPool()
+    : m_freeCount(0)
+{
+}
+
+struct VaapiBufferPool::BufferRecycler
+{
+    BufferRecycler(const BufferPoolPtr& pool, const BufObjectPtr& buffer, VABufferType type)
+        : m_pool(pool), m_buffer(buffer), m_type(type) {}
+    void operator()(VaapiBufObject* buffer)
+    {
+        if (!buffer)
+            return;
+        m_pool->recycle(m_buffer, m_type);
+        m_buffer.reset();
+    }
+private:
+    BufferPoolPtr m_pool;
+    BufObjectPtr m_buffer;
+    VABufferType m_type;
+};
+
+uint32_t VaapiBufferPool::getSizeClass(VABufferType type, uint32_t size)
+{
+    uint32_t sizeClass = BUFFER_POOL_MIN_DATA_SIZE;
+
+    // the driver takes the used size of these from their parameters
+    if (type != VASliceDataBufferType && type != VAEncPackedHeaderDataBufferType)
+        return size;
+    while (sizeClass < size)
+        sizeClass <<= 1;
+    return sizeClass;
+}
+
+BufObjectPtr VaapiBufferPool::acquire(const ContextPtr& context, VABufferType type,
+                                      uint32_t size, const void* data, void** mappedData,
+                                      uint32_t numElements)
+{
+    BufObjectPtr buffer;
+    const uint32_t sizeClass = getSizeClass(type, size);
+
+    if (!size || !numElements) {
+        ERROR("buffer size is zero");
+        return buffer;
+    }
+
+    {
+        AutoLock lock(m_lock);
+        FreeBuffers::iterator it = m_free.find(Key(type, std::make_pair(sizeClass, numElements)));
+        // oldest first
+        if (it != m_free.end() && it->second.size() > BUFFER_POOL_MIN_HELD) {
+            buffer = it->second.front();
+            it->second.pop_front();
+            m_freeCount--;
+        }
+    }
+    if (!buffer) {
+        buffer = VaapiBufObject::create(context, type, sizeClass, 0, 0, numElements);
+        if (!buffer)
+            return buffer;
+    }
+
+    void* mapped = buffer->map();
+    if (!mapped) {
+        ERROR("map buffer failed");
+        buffer.reset();
+        return buffer;
+    }
+    if (data)
+        memcpy(mapped, data, size * numElements);
+    if (mappedData)
+        *mappedData = mapped;
+
+    BufObjectPtr ret(buffer.get(), BufferRecycler(shared_from_this(), buffer, type));
+    return ret;
+}
+
+void VaapiBufferPool::recycle(const BufObjectPtr& buffer, VABufferType type)
+{
+    AutoLock lock(m_lock);
+    if (m_freeCount >= BUFFER_POOL_MAX_TOTAL_FREE) {
+        DEBUG("buffer pool is full, destroy buffer of type %d", type);
+        return;
+    }
+    std::deque<BufObjectPtr>& buffers =
+        m_free[Key(type, std::make_pair(buffer->getSize(), buffer->getNumElements()))];
+    if (buffers.size() < BUFFER_POOL_MAX_FREE) {
+        buffers.push_back(buffer);
+        m_freeCount++;
+    }
+}
+
+} //namespace YamiMediaCodec
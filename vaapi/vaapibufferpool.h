@@ -0,0 +1,79 @@
+/*
+ *  vaapibufferpool.h - va buffer pool
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef vaapibufferpool_h
+#define vaapibufferpool_h
+
+#include "common/common_def.h"
+#include "common/lock.h"
+#include "vaapi/vaapiptrs.h"
+#include "vaapi/vaapitypes.h"
+#include <deque>
+#include <map>
+#include <utility>
+#include <va/va.h>
+
+namespace YamiMediaCodec{
+
+/**
+ * \class VaapiBufferPool
+ * \brief recycles the va buffers of one context
+ * <pre>
+ * pictures create their parameter and slice buffers for every frame, the pool keeps
+ * them when the last reference goes away and hands them out again instead of calling
+ * vaCreateBuffer/vaDestroyBuffer.
+ * buffers are grouped by type, size class and element count, slice data and packed headers
+ * are rounded up to a power of 2, all other types keep their exact size since drivers may
+ * check it. a buffer acquired from the pool is mapped, it is unmapped before it goes to the driver.
+ * free buffers are reused oldest first, and only when a few newer ones are free too, so
+ * a picture does not map a buffer the hardware still reads for the previous one.
+ *</pre>
+ */
+class VaapiBufferPool : public std::tr1::enable_shared_from_this<VaapiBufferPool>
+{
+public:
+    static BufferPoolPtr create();
+
+    /// same as VaapiBufObject::create, but reuses a free buffer when there is one
+    BufObjectPtr acquire(const ContextPtr&, VABufferType, uint32_t size,
+                         const void* data = 0, void** mappedData = 0,
+                         uint32_t numElements = 1);
+
+private:
+    VaapiBufferPool();
+    void recycle(const BufObjectPtr&, VABufferType);
+    static uint32_t getSizeClass(VABufferType, uint32_t size);
+
+    // buffer type, (size class, number of elements)
+    typedef std::pair<VABufferType, std::pair<uint32_t, uint32_t> > Key;
+    typedef std::map<Key, std::deque<BufObjectPtr> > FreeBuffers;
+    FreeBuffers m_free;
+    uint32_t m_freeCount;
+    Lock m_lock;
+
+    struct BufferRecycler;
+
+    DISALLOW_COPY_AND_ASSIGN(VaapiBufferPool);
+};
+
+} //namespace YamiMediaCodec
+
+#endif //vaapibufferpool_h
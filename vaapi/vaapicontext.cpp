@@ -25,6 +25,7 @@
 #include "vaapi/vaapicontext.h"
 
 #include "common/log.h"
+#include "vaapi/vaapibufferpool.h"
 #include "vaapi/vaapidisplay.h"
 #include "vaapi/vaapiutils.h"
 
@@ -87,12 +88,15 @@ ContextPtr VaapiContext::create(const ConfigPtr& config,
 }
 
 VaapiContext::VaapiContext(const ConfigPtr& config, VAContextID context)
-:m_config(config), m_context(context)
+:m_config(config), m_context(context), m_bufferPool(VaapiBufferPool::create()),
+m_renderedPictures(0), m_vaCalls(0)
 {
 }
 
 VaapiContext::~VaapiContext()
 {
+    // pictures hold the context, so all buffers are back and freed here
+    m_bufferPool.reset();
     vaDestroyContext(m_config->m_display->getID(), m_context);
 }
 }
@@ -51,12 +51,25 @@ public:
                       int num_render_targets);
     VAContextID getID() const { return m_context; }
     DisplayPtr getDisplay() const { return m_config->m_display; }
+    // recycles the parameter and slice buffers of this context
+    BufferPoolPtr getBufferPool() const { return m_bufferPool; }
+    // driver calls of all pictures rendered on this context, begin and end picture included
+    void addRenderedPicture(uint32_t vaCalls)
+    {
+        __sync_fetch_and_add(&m_renderedPictures, 1);
+        __sync_fetch_and_add(&m_vaCalls, vaCalls);
+    }
+    uint32_t getRenderedPictures() const { return m_renderedPictures; }
+    uint32_t getVaCalls() const { return m_vaCalls; }
 
     ~VaapiContext();
 private:
     VaapiContext(const ConfigPtr&,  VAContextID);
     ConfigPtr m_config;
     VAContextID m_context;
+    BufferPoolPtr m_bufferPool;
+    uint32_t m_renderedPictures;
+    uint32_t m_vaCalls;
     DISALLOW_COPY_AND_ASSIGN(VaapiContext);
 };
 }
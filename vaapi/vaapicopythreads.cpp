@@ -0,0 +1,179 @@
+/*
+ *  vaapicopythreads.cpp - copy image planes on several threads
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "vaapicopythreads.h"
+
+#include "common/log.h"
+#include "common/planecopy.h"
+#include <string.h>
+
+namespace YamiMediaCodec{
+
+// below this a band costs more in wake ups than it saves
+static const uint32_t MIN_BAND_SIZE = 256 * 1024;
+static const uint32_t MAX_COPY_THREADS = 16;
+
+CopyThreadsPtr VaapiCopyThreads::create(uint32_t threads)
+{
+    CopyThreadsPtr copyThreads;
+    if (threads < 2)
+        return copyThreads;
+    threads = clampThreads(threads);
+    copyThreads.reset(new VaapiCopyThreads());
+    if (!copyThreads->init(threads))
+        copyThreads.reset();
+    return copyThreads;
+}
+
+uint32_t VaapiCopyThreads::clampThreads(uint32_t threads)
+{
+    return threads > MAX_COPY_THREADS ? MAX_COPY_THREADS : threads;
+}
+
+VaapiCopyThreads::VaapiCopyThreads()
+    : m_start(m_lock), m_done(m_lock), m_quit(false), m_generation(0),
+      m_busy(0), m_nextBand(0), m_pending(0)
+{
+    memset(&m_job, 0, sizeof(m_job));
+}
+
+bool VaapiCopyThreads::init(uint32_t threads)
+{
+    //the calling thread is one of them
+    for (uint32_t i = 0; i < threads - 1; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, start, this)) {
+            ERROR("create copy thread failed");
+            return false;
+        }
+        m_threads.push_back(thread);
+    }
+    return true;
+}
+
+VaapiCopyThreads::~VaapiCopyThreads()
+{
+    {
+        AutoLock lock(m_lock);
+        m_quit = true;
+        m_start.broadcast();
+    }
+    for (size_t i = 0; i < m_threads.size(); i++)
+        pthread_join(m_threads[i], NULL);
+}
+
+uint32_t VaapiCopyThreads::getThreads()
+{
+    return m_threads.size() + 1;
+}
+
+void* VaapiCopyThreads::start(void* threads)
+{
+    static_cast<VaapiCopyThreads*>(threads)->loop();
+    return NULL;
+}
+
+void VaapiCopyThreads::loop()
+{
+    uint32_t generation = 0;
+
+    AutoLock lock(m_lock);
+    while (1) {
+        while (!m_quit && m_generation == generation)
+            m_start.wait();
+        if (m_quit)
+            break;
+        generation = m_generation;
+        m_busy++;
+        m_lock.release();
+        copyBands();
+        m_lock.acquire();
+        if (!--m_busy)
+            m_done.signal();
+    }
+}
+
+void VaapiCopyThreads::copyBands()
+{
+    while (1) {
+        uint32_t band = __sync_fetch_and_add(&m_nextBand, 1);
+        if (band >= m_job.bands)
+            return;
+        uint32_t first = band * m_job.bandRows;
+        uint32_t rows = m_job.bandRows;
+        if (first + rows > m_job.height)
+            rows = m_job.height - first;
+        YamiMediaCodec::copyPlane(m_job.dest + first * m_job.destPitch, m_job.destPitch,
+            m_job.src + first * m_job.srcPitch, m_job.srcPitch,
+            m_job.width, rows);
+
+        if (!__sync_sub_and_fetch(&m_pending, 1)) {
+            AutoLock lock(m_lock);
+            m_done.signal();
+        }
+    }
+}
+
+void VaapiCopyThreads::copyPlane(uint8_t* dest, uint32_t destPitch,
+                                 const uint8_t* src, uint32_t srcPitch,
+                                 uint32_t width, uint32_t height)
+{
+    uint64_t size = (uint64_t)width * height;
+    uint32_t bands = getThreads();
+    if (size / bands < MIN_BAND_SIZE)
+        bands = size / MIN_BAND_SIZE;
+    if (bands > height)
+        bands = height;
+    if (bands < 2) {
+        YamiMediaCodec::copyPlane(dest, destPitch, src, srcPitch, width, height);
+        return;
+    }
+
+    AutoLock copyLock(m_copyLock);
+    {
+        AutoLock lock(m_lock);
+        //a worker woken late for the last job may still look at m_job
+        while (m_busy)
+            m_done.wait();
+        m_job.dest = dest;
+        m_job.destPitch = destPitch;
+        m_job.src = src;
+        m_job.srcPitch = srcPitch;
+        m_job.width = width;
+        m_job.height = height;
+        m_job.bandRows = (height + bands - 1) / bands;
+        m_job.bands = (height + m_job.bandRows - 1) / m_job.bandRows;
+        m_pending = m_job.bands;
+        m_nextBand = 0;
+        m_generation++;
+        m_start.broadcast();
+    }
+    copyBands();
+
+    AutoLock lock(m_lock);
+    while (m_pending)
+        m_done.wait();
+}
+
+} //namespace YamiMediaCodec
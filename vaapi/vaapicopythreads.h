@@ -0,0 +1,99 @@
+/*
+ *  vaapicopythreads.h - copy image planes on several threads
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef vaapicopythreads_h
+#define vaapicopythreads_h
+
+#include "common/common_def.h"
+#include "common/condition.h"
+#include "common/lock.h"
+#include "vaapi/vaapiptrs.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+namespace YamiMediaCodec{
+
+/**
+ * \class VaapiCopyThreads
+ * \brief worker threads for big plane copies
+ * <pre>
+ * copyPlane() splits the plane in bands of rows, the workers and the calling thread copy one
+ * band each with YamiMediaCodec::copyPlane() until all are done. the bands do not overlap, so the
+ * result is the same as one copyPlane() on the calling thread.
+ * small planes are copied on the calling thread only.
+ *</pre>
+ */
+class VaapiCopyThreads
+{
+public:
+    /// @param threads copying threads, the calling one included. returns NULL for less than 2
+    static CopyThreadsPtr create(uint32_t threads);
+    /// the threads create() starts for @param threads, at most MAX_COPY_THREADS
+    static uint32_t clampThreads(uint32_t threads);
+    ~VaapiCopyThreads();
+
+    uint32_t getThreads();
+    void copyPlane(uint8_t* dest, uint32_t destPitch,
+                   const uint8_t* src, uint32_t srcPitch,
+                   uint32_t width, uint32_t height);
+
+private:
+    VaapiCopyThreads();
+    bool init(uint32_t threads);
+    static void* start(void* threads);
+    void loop();
+    void copyBands();
+
+    struct Job {
+        uint8_t* dest;
+        uint32_t destPitch;
+        const uint8_t* src;
+        uint32_t srcPitch;
+        uint32_t width;
+        uint32_t height;
+        uint32_t bandRows;
+        uint32_t bands;
+    };
+
+    //one copy at a time
+    Lock m_copyLock;
+
+    Lock m_lock;
+    Condition m_start;
+    Condition m_done;
+    std::vector<pthread_t> m_threads;
+    bool m_quit;
+    uint32_t m_generation;
+    //workers in copyBands(), m_job is only written when there is none
+    uint32_t m_busy;
+    Job m_job;
+
+    //taken and finished bands of the current job, atomic
+    volatile uint32_t m_nextBand;
+    volatile uint32_t m_pending;
+
+    DISALLOW_COPY_AND_ASSIGN(VaapiCopyThreads);
+};
+
+} //namespace YamiMediaCodec
+
+#endif //vaapicopythreads_h
@@ -29,8 +29,10 @@
 
 #include "vaapiimage.h"
 #include "common/log.h"
+#include "common/planecopy.h"
 #include "common/utils.h"
 #include "vaapiutils.h"
+#include "vaapicopythreads.h"
 #include "vaapisurface.h"
 #include <stdlib.h>
 #include <string.h>
@@ -91,23 +93,25 @@ bool VaapiImageRaw::getHandle(intptr_t& handle, uint32_t offsets[3], uint32_t pi
     return true;
 }
 
-bool VaapiImageRaw::copyTo(uint8_t* dest, const uint32_t offsets[3], const uint32_t pitches[3])
+bool VaapiImageRaw::copyTo(uint8_t* dest, const uint32_t offsets[3], const uint32_t pitches[3],
+    const CopyThreadsPtr& threads)
 {
     if (!dest)
         return false;
     VAImagePtr& image =  m_image->m_image;
     return copy((uint8_t*)dest, offsets, pitches,
-        (uint8_t*)m_handle, image->offsets, image->pitches);
+        (uint8_t*)m_handle, image->offsets, image->pitches, threads);
 }
 
-bool VaapiImageRaw::copyFrom(const uint8_t* src, const uint32_t offsets[3], const uint32_t pitches[3])
+bool VaapiImageRaw::copyFrom(const uint8_t* src, const uint32_t offsets[3], const uint32_t pitches[3],
+    const CopyThreadsPtr& threads)
 {
     if (!src)
         return false;
     VAImagePtr& image =  m_image->m_image;
     uint8_t* dest = reinterpret_cast<uint8_t*>(m_handle);
     return copy(dest, image->offsets, image->pitches,
-        src, offsets, pitches);
+        src, offsets, pitches, threads);
 }
 
 bool VaapiImageRaw::copyFrom(const uint8_t* src, uint32_t size)
@@ -144,7 +148,8 @@ bool VaapiImageRaw::copy(uint8_t* destBase,
               const uint32_t destOffsets[3], const uint32_t destPitches[3],
               const uint8_t* srcBase,
               const uint32_t srcOffsets[3], const uint32_t srcPitches[3],
-              const uint32_t width[3], const uint32_t height[3], uint32_t planes)
+              const uint32_t width[3], const uint32_t height[3], uint32_t planes,
+              const CopyThreadsPtr& threads)
 {
     for (int i = 0; i < planes; i++) {
         uint32_t w = width[i];
@@ -157,19 +162,18 @@ bool VaapiImageRaw::copy(uint8_t* destBase,
         const uint8_t* src = srcBase + srcOffsets[i];
         uint8_t* dest = destBase + destOffsets[i];
 
-
-        for (int j = 0; j < h; j++) {
-            memcpy(dest, src, w);
-            src += srcPitches[i];
-            dest += destPitches[i];
-        }
+        if (threads)
+            threads->copyPlane(dest, destPitches[i], src, srcPitches[i], w, h);
+        else
+            copyPlane(dest, destPitches[i], src, srcPitches[i], w, h);
     }
     return true;
 
 }
 
 bool VaapiImageRaw::copy(uint8_t* destBase, const uint32_t destOffsets[3], const uint32_t destPitches[3],
-    const uint8_t* srcBase, const uint32_t srcOffsets[3], const uint32_t srcPitches[3])
+    const uint8_t* srcBase, const uint32_t srcOffsets[3], const uint32_t srcPitches[3],
+    const CopyThreadsPtr& threads)
 {
     ASSERT(srcBase && destBase);
     if (m_memoryType != VIDEO_DATA_MEMORY_TYPE_RAW_COPY)
@@ -179,7 +183,7 @@ bool VaapiImageRaw::copy(uint8_t* destBase, const uint32_t destOffsets[3], const
     uint32_t height[3];
     uint32_t planes;
     getPlaneResolution(width,height, planes);
-    return copy(destBase, destOffsets, destPitches, srcBase, srcOffsets, srcPitches, width, height, planes);
+    return copy(destBase, destOffsets, destPitches, srcBase, srcOffsets, srcPitches, width, height, planes, threads);
 }
 
 VaapiImageRaw::~VaapiImageRaw()
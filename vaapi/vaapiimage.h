@@ -84,8 +84,11 @@ private:
 public:
     static ImageRawPtr create(const DisplayPtr&, const ImagePtr&, VideoDataMemoryType);
     VideoDataMemoryType getMemoryType();
-    bool copyTo(uint8_t* dest, const uint32_t offsets[3], const uint32_t pitches[3]);
-    bool copyFrom(const uint8_t* src, const uint32_t offsets[3], const uint32_t pitches[3]);
+    /// @param threads split big planes over these threads, NULL copies on the calling thread
+    bool copyTo(uint8_t* dest, const uint32_t offsets[3], const uint32_t pitches[3],
+                const CopyThreadsPtr& threads = CopyThreadsPtr());
+    bool copyFrom(const uint8_t* src, const uint32_t offsets[3], const uint32_t pitches[3],
+                  const CopyThreadsPtr& threads = CopyThreadsPtr());
     bool copyFrom(const uint8_t* src, uint32_t size);
     bool getHandle(intptr_t& handle, uint32_t offsets[3], uint32_t pitches[3]);
     ~VaapiImageRaw();
@@ -96,12 +99,14 @@ private:
     bool copy(uint8_t* destBase,
               const uint32_t destOffsets[3], const uint32_t destPitches[3],
               const uint8_t* srcBase,
-              const uint32_t srcOffsets[3], const uint32_t srcPitches[3]);
+              const uint32_t srcOffsets[3], const uint32_t srcPitches[3],
+              const CopyThreadsPtr& threads);
     static bool copy(uint8_t* destBase,
               const uint32_t destOffsets[3], const uint32_t destPitches[3],
               const uint8_t* srcBase,
               const uint32_t srcOffsets[3], const uint32_t srcPitches[3],
-              const uint32_t width[3], const uint32_t height[3], uint32_t planes);
+              const uint32_t width[3], const uint32_t height[3], uint32_t planes,
+              const CopyThreadsPtr& threads = CopyThreadsPtr());
 
     DisplayPtr m_display;
     ImagePtr m_image;
@@ -35,8 +35,8 @@
 namespace YamiMediaCodec{
 VaapiPicture::VaapiPicture(const ContextPtr& context,
                            const SurfacePtr& surface, int64_t timeStamp)
-:m_display(context->getDisplay()), m_context(context), m_surface(surface),
-m_timeStamp(timeStamp), m_type(VAAPI_PICTURE_TYPE_NONE)
+:m_display(context ? context->getDisplay() : DisplayPtr()), m_context(context), m_surface(surface),
+m_timeStamp(timeStamp), m_type(VAAPI_PICTURE_TYPE_NONE), m_vaCalls(0)
 {
 
 }
@@ -49,37 +49,56 @@ bool VaapiPicture::render()
     }
 
     VAStatus status;
+    m_vaCalls = 1;
     status = vaBeginPicture(m_display->getID(), m_context->getID(), m_surface->getID());
     if (!checkVaapiStatus(status, "vaBeginPicture()"))
         return false;
 
     bool ret = doRender();
+    if (ret)
+        ret = renderPending();
 
+    m_vaCalls++;
     status = vaEndPicture(m_display->getID(), m_context->getID());
+    // the driver owns the picture now, the buffers may go back to the pool
+    m_pending.clear();
     if (!checkVaapiStatus(status, "vaEndPicture()"))
         return false;
+    DEBUG("surface 0x%x rendered in %d va calls", m_surface->getID(), m_vaCalls);
+    m_context->addRenderedPicture(m_vaCalls);
     return ret;
 }
 
-bool VaapiPicture::render(BufObjectPtr& buffer)
+bool VaapiPicture::renderPending()
 {
-    VAStatus status = VA_STATUS_SUCCESS;
-    VABufferID bufferID = VA_INVALID_ID;
+    VAStatus status;
+
+    if (m_pending.empty())
+        return true;
+
+    m_pendingIDs.clear();
+    for (size_t i = 0; i < m_pending.size(); i++)
+        m_pendingIDs.push_back(m_pending[i]->getID());
 
+    m_vaCalls++;
+    status = vaRenderPicture(m_display->getID(), m_context->getID(),
+                             &m_pendingIDs[0], m_pendingIDs.size());
+    return checkVaapiStatus(status, "vaRenderPicture failed");
+}
+
+bool VaapiPicture::render(BufObjectPtr& buffer)
+{
     if (!buffer)
         return true;
 
     if (buffer->isMapped())
         buffer->unmap();
 
-    bufferID = buffer->getID();
-    if (bufferID == VA_INVALID_ID)
-        return false;
-
-    status = vaRenderPicture(m_display->getID(), m_context->getID(), &bufferID, 1);
-    if (!checkVaapiStatus(status, "vaRenderPicture failed"))
+    if (buffer->getID() == VA_INVALID_ID)
         return false;
 
+    // queued in doRender() order, renderPending() submits them
+    m_pending.push_back(buffer);
     buffer.reset();             // silently work  arouond for psb
     return true;
 }
@@ -24,6 +24,8 @@
 #define vaapipicture_h
 
 #include "vaapibuffer.h"
+#include "vaapibufferpool.h"
+#include "vaapicontext.h"
 #include "vaapiptrs.h"
 #include "vaapipicturetypes.h"
 #include "vaapisurface.h"
@@ -56,6 +58,7 @@ public:
 protected:
     virtual bool doRender() = 0;
 
+    // doRender() only queues the buffers, they go to the driver in one call
     bool render();
     bool render(BufObjectPtr& buffer);
     bool render(std::pair<BufObjectPtr, BufObjectPtr>& paramAndData);
@@ -73,6 +76,18 @@ protected:
     BufObjectPtr createBufferObject(VABufferType, T*& bufPtr);
     inline BufObjectPtr createBufferObject(VABufferType bufType,
                                            uint32_t size,const void *data, void **mapped_data);
+    // one buffer holding count elements of size bytes, such as packed slice parameters
+    inline BufObjectPtr createArrayObject(VABufferType bufType, uint32_t size,
+                                          uint32_t count, void **mapped_data);
+
+private:
+    bool renderPending();
+
+    // buffers queued by doRender(), kept alive until they are rendered
+    std::vector<BufObjectPtr> m_pending;
+    std::vector<VABufferID>   m_pendingIDs;
+    // va calls made by the last render(), added to the context's total
+    uint32_t                  m_vaCalls;
 };
 
 template<class T>
@@ -87,7 +102,13 @@ BufObjectPtr VaapiPicture::createBufferObject(VABufferType  bufType, T*& bufPtr)
 BufObjectPtr VaapiPicture::createBufferObject(VABufferType bufType,
                                           uint32_t size,const void *data, void **mapped_data)
 {
-    return VaapiBufObject::create(m_context, bufType, size, data, mapped_data);
+    return m_context->getBufferPool()->acquire(m_context, bufType, size, data, mapped_data);
+}
+
+BufObjectPtr VaapiPicture::createArrayObject(VABufferType bufType, uint32_t size,
+                                             uint32_t count, void **mapped_data)
+{
+    return m_context->getBufferPool()->acquire(m_context, bufType, size, NULL, mapped_data, count);
 }
 
 template<class T>
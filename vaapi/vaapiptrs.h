@@ -37,6 +37,9 @@ typedef SharedPtr < VaapiImageRaw > ImageRawPtr;
 class VaapiCodedBuffer;
 typedef SharedPtr < VaapiCodedBuffer > CodedBufferPtr;
 
+class VaapiCodedBufferPool;
+typedef SharedPtr < VaapiCodedBufferPool > CodedBufferPoolPtr;
+
 class VaapiBufObject;
 typedef SharedPtr < VaapiBufObject > BufObjectPtr;
 
@@ -52,8 +55,20 @@ typedef SharedPtr < VaapiContext > ContextPtr;
 class VaapiDecSurfacePool;
 typedef SharedPtr < VaapiDecSurfacePool > DecSurfacePoolPtr;
 
+class VaapiEncSurfacePool;
+typedef SharedPtr < VaapiEncSurfacePool > EncSurfacePoolPtr;
+
 class VaapiImagePool;
 typedef SharedPtr < VaapiImagePool > ImagePoolPtr;
+
+class VaapiBufferPool;
+typedef SharedPtr < VaapiBufferPool > BufferPoolPtr;
+
+class VaapiSurfaceArena;
+typedef SharedPtr < VaapiSurfaceArena > SurfaceArenaPtr;
+
+class VaapiCopyThreads;
+typedef SharedPtr < VaapiCopyThreads > CopyThreadsPtr;
 } //namespace YamiMediaCodec
 
 #endif                          /* vaapiptr_h */
@@ -0,0 +1,184 @@
+/*
+ *  vaapisurfacearena.cpp - surfaces shared by all decoders of a display
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "vaapisurfacearena.h"
+
+#include "common/log.h"
+#include <stdlib.h>
+
+namespace YamiMediaCodec{
+
+//all arenas, one per display
+static Lock s_arenasLock;
+static std::list<std::tr1::weak_ptr<VaapiSurfaceArena> > s_arenas;
+
+SurfaceArenaPtr VaapiSurfaceArena::get(const DisplayPtr& display)
+{
+    SurfaceArenaPtr arena;
+    AutoLock lock(s_arenasLock);
+
+    std::list<std::tr1::weak_ptr<VaapiSurfaceArena> >::iterator it = s_arenas.begin();
+    while (it != s_arenas.end()) {
+        arena = it->lock();
+        if (!arena) {
+            it = s_arenas.erase(it);
+            continue;
+        }
+        if (arena->m_display == display)
+            return arena;
+        ++it;
+    }
+    arena.reset(new VaapiSurfaceArena(display));
+    s_arenas.push_back(arena);
+    return arena;
+}
+
+VaapiSurfaceArena::VaapiSurfaceArena(const DisplayPtr& display)
+    : m_display(display), m_budget(0), m_used(0), m_idleSize(0)
+{
+    const char* budget = getenv("LIBYAMI_SURFACE_BUDGET");
+    if (budget)
+        setBudget(strtoull(budget, NULL, 10) << 20);
+}
+
+struct VaapiSurfaceArena::SurfaceReturner
+{
+    SurfaceReturner(const SurfaceArenaPtr& arena, const Idle& idle)
+        : m_arena(arena), m_idle(idle) {}
+    void operator()(VaapiSurface* surface)
+    {
+        if (!surface)
+            return;
+        m_arena->giveBack(m_idle);
+        m_idle.surface.reset();
+    }
+private:
+    SurfaceArenaPtr m_arena;
+    Idle m_idle;
+};
+
+uint64_t VaapiSurfaceArena::getSurfaceSize(VaapiChromaType chroma, uint32_t width, uint32_t height)
+{
+    uint64_t size = (uint64_t)width * height;
+
+    switch (chroma) {
+    case VAAPI_CHROMA_TYPE_YUV400:
+        return size;
+    case VAAPI_CHROMA_TYPE_YUV422:
+        return size * 2;
+    case VAAPI_CHROMA_TYPE_YUV444:
+        return size * 3;
+    default:
+        return size * 3 / 2;
+    }
+}
+
+SurfacePtr VaapiSurfaceArena::borrow(VaapiChromaType chroma, uint32_t width, uint32_t height)
+{
+    SurfacePtr surface;
+    const uint64_t size = getSurfaceSize(chroma, width, height);
+    //destroyed after the lock is released
+    std::list<Idle> evicted;
+
+    {
+        AutoLock lock(m_lock);
+        std::list<Idle>::iterator it;
+        for (it = m_idle.begin(); it != m_idle.end(); ++it) {
+            if (it->chroma == chroma && it->width == width && it->height == height) {
+                surface = it->surface;
+                m_idleSize -= size;
+                m_idle.erase(it);
+                break;
+            }
+        }
+        if (!surface) {
+            if (m_budget && m_used + size > m_budget && !evictIdle(size, evicted)) {
+                ERROR("surface budget %dM is used up", (int)(m_budget >> 20));
+                return surface;
+            }
+            // reserved before vaCreateSurfaces, so others see it in the budget
+            m_used += size;
+        }
+    }
+    if (!surface) {
+        surface = VaapiSurface::create(m_display, chroma, width, height, NULL, 0);
+        if (!surface) {
+            AutoLock lock(m_lock);
+            m_used -= size;
+            return surface;
+        }
+    }
+
+    Idle idle = { chroma, width, height, surface };
+    SurfacePtr borrowed(surface.get(), SurfaceReturner(shared_from_this(), idle));
+    return borrowed;
+}
+
+void VaapiSurfaceArena::giveBack(const Idle& idle)
+{
+    //destroyed after the lock is released
+    std::list<Idle> evicted;
+
+    // the pool may have cropped it
+    idle.surface->resize(idle.width, idle.height);
+
+    AutoLock lock(m_lock);
+    m_idle.push_back(idle);
+    m_idleSize += getSurfaceSize(idle.chroma, idle.width, idle.height);
+    // idle surfaces never take more memory than the borrowed ones,
+    // so they all go once nobody on the display decodes
+    while (m_idleSize > m_used - m_idleSize)
+        evictOldest(evicted);
+}
+
+void VaapiSurfaceArena::evictOldest(std::list<Idle>& evicted)
+{
+    const Idle& oldest = m_idle.front();
+    const uint64_t size = getSurfaceSize(oldest.chroma, oldest.width, oldest.height);
+    m_used -= size;
+    m_idleSize -= size;
+    evicted.splice(evicted.end(), m_idle, m_idle.begin());
+}
+
+bool VaapiSurfaceArena::evictIdle(uint64_t size, std::list<Idle>& evicted)
+{
+    while (!m_idle.empty() && m_used + size > m_budget)
+        evictOldest(evicted);
+    return m_used + size <= m_budget;
+}
+
+void VaapiSurfaceArena::setBudget(uint64_t bytes)
+{
+    AutoLock lock(m_lock);
+    m_budget = bytes;
+    INFO("surface budget %dM", (int)(m_budget >> 20));
+}
+
+uint64_t VaapiSurfaceArena::getUsedSize()
+{
+    AutoLock lock(m_lock);
+    return m_used;
+}
+
+} //namespace YamiMediaCodec
@@ -0,0 +1,89 @@
+/*
+ *  vaapisurfacearena.h - surfaces shared by all decoders of a display
+ *
+ *  Copyright (C) 2015 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef vaapisurfacearena_h
+#define vaapisurfacearena_h
+
+#include "common/common_def.h"
+#include "common/lock.h"
+#include "vaapi/vaapiptrs.h"
+#include "vaapi/vaapisurface.h"
+#include "vaapi/vaapitypes.h"
+#include <list>
+#include <va/va.h>
+
+namespace YamiMediaCodec{
+
+/**
+ * \class VaapiSurfaceArena
+ * \brief surfaces of one display, shared by all surface pools on it
+ * <pre>
+ * a pool borrows its surfaces here instead of creating them. when the pool lets a surface go,
+ * it becomes idle in the arena, and the next pool asking for the same chroma type and size
+ * gets it back without vaCreateSurfaces.
+ * all surfaces of the arena, borrowed and idle, count against a memory budget. it is taken from
+ * LIBYAMI_SURFACE_BUDGET (in MB) when the arena is created, 0 or unset means no budget.
+ * idle surfaces are destroyed, the oldest first, when a new one would not fit in the budget
+ * or they take more memory than the borrowed surfaces, so none stay once all pools are gone.
+ * they are destroyed after the arena lock is released.
+ * borrow() fails if the budget is used up by borrowed surfaces.
+ *</pre>
+ */
+class VaapiSurfaceArena : public std::tr1::enable_shared_from_this<VaapiSurfaceArena>
+{
+public:
+    /// the arena of @param display, created on first use and gone with its last user
+    static SurfaceArenaPtr get(const DisplayPtr& display);
+
+    SurfacePtr borrow(VaapiChromaType, uint32_t width, uint32_t height);
+
+    void setBudget(uint64_t bytes);
+    uint64_t getUsedSize();
+
+private:
+    VaapiSurfaceArena(const DisplayPtr&);
+    struct Idle {
+        VaapiChromaType chroma;
+        uint32_t width;
+        uint32_t height;
+        SurfacePtr surface;
+    };
+    struct SurfaceReturner;
+    void giveBack(const Idle&);
+    void evictOldest(std::list<Idle>& evicted);
+    bool evictIdle(uint64_t size, std::list<Idle>& evicted);
+    static uint64_t getSurfaceSize(VaapiChromaType, uint32_t width, uint32_t height);
+
+    DisplayPtr m_display;
+    Lock m_lock;
+    // oldest first
+    std::list<Idle> m_idle;
+    uint64_t m_budget;
+    // borrowed and idle surfaces
+    uint64_t m_used;
+    uint64_t m_idleSize;
+
+    DISALLOW_COPY_AND_ASSIGN(VaapiSurfaceArena);
+};
+
+} //namespace YamiMediaCodec
+
+#endif //vaapisurfacearena_h
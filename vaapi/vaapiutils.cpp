@@ -78,14 +78,15 @@ vaapiCreateBuffer(VADisplay dpy,
                   int type,
                   uint32_t size,
                   const void *buf,
-                  VABufferID * bufIdPtr, void **mappedData)
+                  VABufferID * bufIdPtr, void **mappedData,
+                  uint32_t numElements)
 {
     VABufferID bufId;
     VAStatus status;
     void *data = (void *) buf;
 
     status =
-        vaCreateBuffer(dpy, ctx, (VABufferType) type, size, 1, data,
+        vaCreateBuffer(dpy, ctx, (VABufferType) type, size, numElements, data,
                        &bufId);
     if (!checkVaapiStatus(status, "vaCreateBuffer()"))
         return false;
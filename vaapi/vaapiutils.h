@@ -40,7 +40,8 @@ vaapiCreateBuffer(VADisplay dpy,
                   VAContextID ctx,
                   int type,
                   unsigned int size,
-                  const void *data, VABufferID * bufId, void **mappedData);
+                  const void *data, VABufferID * bufId, void **mappedData,
+                  unsigned int numElements = 1);
 
 void vaapiDestroyBuffer(VADisplay dpy, VABufferID * bufId);
 